@@ -0,0 +1,52 @@
+// File: Twinkle.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// An example pattern plugin (see emuPlugin.c).  Stars light up in random
+// colors and fade away.  From the build directory:
+//
+//   gcc -shared -fPIC -DEMULATE -I../src -o ../plugins/.Twinkle.so ../plugins/Twinkle.c
+//   mv ../plugins/.Twinkle.so ../plugins/Twinkle.so
+//   bin/galaxyEmulator --plugins ../plugins
+//
+// Then change it and build it again, with the emulator still running.
+
+// Includes
+#include "display.h"
+#include "patternSupport.h"
+#include "galaxyConfig.h"
+#include "pattern.h"
+
+// Coefficients - Pattern adjustments
+#define COEF_TWINKLE_FADE 12      // How fast the stars fade.
+#define COEF_TWINKLE_STARS 2      // Stars lit each step.
+#define COEF_TWINKLE_HOLD 30000   // How long each step shows (us).
+
+typedef struct {
+  cMode_e colorMode;
+} twinkleState_t;
+
+
+// Twinkle - Fade everything a little, and light a few stars.
+static long int Twinkle(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  twinkleState_t *s = state;
+  int i;
+
+  if (initial) {
+    *map = MAP_FULL;
+    s->colorMode = PatternRand() % CMODE_COUNT;
+    ColorAll(galaxy, PIXEL_BLACK);
+  }
+
+  for (i = 0; i < CHANNEL_COUNT; i++) {
+    FadeChannel(galaxy, i, -COEF_TWINKLE_FADE, MODE_CONSTRAINED);
+  }
+  for (i = 0; i < COEF_TWINKLE_STARS; i++) {
+    *galaxy->pixels[PatternRand() % galaxy->size] = GetRandomColor(s->colorMode);
+  }
+  return COEF_TWINKLE_HOLD;
+}
+
+
+// What the emulator looks for (see emuPlugin.h).
+const pattern_t galaxyPattern = { Twinkle, 500, "Twinkle", sizeof(twinkleState_t) };
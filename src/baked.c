@@ -0,0 +1,121 @@
+// File: baked.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Baked pattern playback.  A pattern run is deterministic from the seed, so
+// the emulator can render it once (--bake, see emuBake.c) into a table of
+// frames, each stored as its changes from the one before (see baked.h).  The
+// tables are const, so on the PIC they sit in flash, and playing one back
+// costs a few bytes of RAM for the place in the table.  The frames are
+// decoded straight into the galaxy's pixels, which still hold the frame
+// before, so no frame buffer is needed.  That puts patterns too slow for the
+// PIC to run live on the wire at full speed.
+//
+// Each baked run gets a pattern function of its own, generated along with
+// its table, that calls BakedPlay().
+
+// Includes
+#include "baked.h"
+#include <stdlib.h>  // NULL
+
+
+// Play the next frame of run into galaxy, and return its hold.  The run starts
+// over on the initial frame, and after its last.  A run baked for more pixels
+// than the galaxy has, or without a state block (see BAKED_PATTERNS in
+// pattern.h), is left alone.
+long int BakedPlay(galaxyData_t *galaxy, void *state, const bakedRun_t *run,
+                   unsigned char initial, outputMapping_e *map) {
+
+  // Vars
+  bakedState_t *s = state;
+  long int hold;
+
+  if (s == NULL) {
+    return 0;
+  }
+  if (initial || (s->frame >= run->frames)) {
+    s->offset = 0;
+    s->frame = 0;
+    *map = run->map;
+  }
+  if (run->pixels > galaxy->size) {
+    return 0;
+  }
+
+  s->offset = BakedDecode(galaxy, run->pixels, run->data + s->offset, &hold) -
+              run->data;
+  s->frame++;
+  return hold;
+}
+
+
+// Decode a frame of data into the first pixels of galaxy, over the frame
+// before.  Returns where the next frame starts, and the frame's hold in hold.
+// The bytes are walked a channel at a time (see baked.h), keeping count of
+// the pixel and channel rather than dividing, which the PIC is slow at.
+const unsigned char *BakedDecode(galaxyData_t *galaxy, unsigned int pixels,
+                                 const unsigned char *data, long int *hold) {
+
+  // Vars
+  unsigned char *bytes = galaxy->pixels[0]->chan, *at;
+  unsigned int count, remaining = pixels * BYTES_PER_PIXEL;
+  int pixel, channel;
+  unsigned char op, kind, value = 0, backward, shift = 0;
+  unsigned long int header = 0;
+
+  do {
+    header |= (unsigned long int) (*data & 0x7F) << shift;
+    shift += 7;
+  } while (*data++ & 0x80);
+  *hold = (long int) (header >> 1);
+  backward = (unsigned char) (header & BAKED_BACKWARD);
+
+  pixel = backward ? (int) pixels - 1 : 0;
+  channel = backward ? BYTES_PER_PIXEL - 1 : 0;
+  while (remaining > 0) {
+    op = *data++;
+    kind = op & BAKED_KIND_MASK;
+    if (kind == BAKED_END) {
+      break;
+    }
+    count = (op & ~BAKED_KIND_MASK) + 1;
+    if ((kind == BAKED_RUN) || (kind == BAKED_ADD)) {
+      value = *data++;
+    }
+    remaining -= count;
+
+    while (count-- > 0) {
+      at = &bytes[(pixel * BYTES_PER_PIXEL) + channel];
+
+      // On to the next byte.
+      if (backward) {
+        if (--pixel < 0) {
+          pixel = pixels - 1;
+          channel--;
+        }
+      } else if (++pixel >= (int) pixels) {
+        pixel = 0;
+        channel++;
+      }
+
+      switch (kind) {
+        case BAKED_LITERAL:
+          *at = *data++;
+          break;
+        case BAKED_RUN:
+          *at = value;
+          break;
+        case BAKED_ADD:
+          *at += value;
+          break;
+        case BAKED_COPY:
+          *at = bytes[(pixel * BYTES_PER_PIXEL) + channel];
+          break;
+        case BAKED_SKIP:
+        default:
+          break;
+      }
+    }
+  }
+  return data;
+}
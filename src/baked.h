@@ -0,0 +1,62 @@
+// File:   baked.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Baked patterns.  Pattern runs rendered ahead of time into tables of frames
+// (see --bake), and played back from them.
+
+#ifndef BAKED_H
+#define	BAKED_H
+
+  #include "galaxyConfig.h"
+  #include "display.h"
+
+  // Frame data.  A frame's bytes are taken a channel at a time: the red of
+  // each pixel in turn, then the green, then the blue.  Each frame starts with
+  // its hold (us) times 2, plus 1 if it's decoded backwards (from the last
+  // byte to the first), 7 bits a byte, low bits first, with the top bit set
+  // on all but the last.  Then come ops that rebuild the frame from the frame
+  // before, in the order it's decoded.  Each op is a byte, the kind in the top
+  // 3 bits and (count - 1) in the rest:
+  // BAKED_SKIP - The next count bytes are unchanged.
+  // BAKED_LITERAL - The next count bytes follow.
+  // BAKED_RUN - The next count bytes are all the byte that follows.
+  // BAKED_ADD - The byte that follows is added to each of the next count.
+  // BAKED_COPY - Each of the next count bytes takes the old value of the byte
+  //   after it (in the order the frame's decoded).  That's how a shift along
+  //   the arms comes out.
+  // BAKED_END - The rest of the frame is unchanged.  The count is unused.
+  // The first frame only uses BAKED_LITERAL and BAKED_RUN, so it can be played
+  // over anything.
+  #define BAKED_SKIP 0x00
+  #define BAKED_LITERAL 0x20
+  #define BAKED_RUN 0x40
+  #define BAKED_ADD 0x60
+  #define BAKED_COPY 0x80
+  #define BAKED_END 0xE0
+  #define BAKED_KIND_MASK 0xE0
+  #define BAKED_COUNT_MAX 32
+  #define BAKED_BACKWARD 0x01
+
+  // A baked run.  Plays over and over.  The pixels it's played into must be
+  // one contiguous array, like a layer's (see composite.h).
+  typedef struct {
+    unsigned int frames;
+    unsigned int pixels;        // Pixels in a frame: an arm if it's mirrored.
+    outputMapping_e map;
+    const unsigned char *data;  // The frames, one after another.
+  } bakedRun_t;
+
+  // A baked pattern's state block.
+  typedef struct {
+    unsigned long int offset;   // The next frame's data.
+    unsigned int frame;
+  } bakedState_t;
+
+  // Prototypes
+  long int BakedPlay(galaxyData_t *galaxy, void *state, const bakedRun_t *run,
+                     unsigned char initial, outputMapping_e *map);
+  const unsigned char *BakedDecode(galaxyData_t *galaxy, unsigned int pixels,
+                                   const unsigned char *data, long int *hold);
+
+#endif	/* BAKED_H */
@@ -0,0 +1,307 @@
+// File: composite.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Layer compositor.  The bottom layer is copied to the output, and each layer
+// above it is blended on in turn (see blendMode_e in composite.h).
+//
+// The blends treat the pixels as one long run of bytes, since every channel is
+// blended the same way and color_t is just BYTES_PER_PIXEL bytes.  Products
+// are scaled back to 0 - 255 by dividing by 255, rounded, which is done as
+// (x + 128 + ((x + 128) >> 8)) >> 8.  That's exact for any product of two
+// bytes, and fits in 16 bits, so the PIC can do it with unsigned ints and the
+// emulator 8 or 16 pixels at a time with SIMD: AVX2 if it's built for a CPU
+// that has it (see the GALAXY_NATIVE option in CMakeLists.txt), SSE2 on any
+// other x86-64, and the same scalar code as the PIC anywhere else.  They all
+// give exactly the same results.
+
+// Includes
+#include "composite.h"
+#include "topology.h"
+#include <stdlib.h>  // NULL
+#if defined(EMULATE) && defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(EMULATE) && defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+// Defines
+#define DIV255(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
+// Prototypes
+#if defined(EMULATE) && defined(__AVX2__)
+static int BlendAVX2(unsigned char *dst, const unsigned char *src, int bytes,
+                     blendMode_e mode, unsigned char alpha);
+#elif defined(EMULATE) && defined(__SSE2__)
+static int BlendSSE2(unsigned char *dst, const unsigned char *src, int bytes,
+                     blendMode_e mode, unsigned char alpha);
+#endif
+
+
+// Blend count layers into out, bottom layer first, and return the output map
+// to send it with.  The output is mirrored only if every layer is, in which
+// case only the first arm is blended.  Otherwise mirrored layers are unfolded
+// onto all the arms first, in scratch, which must hold a frame of pixels.
+// Without scratch (the PIC can't spare it), they're blended a pixel at a time
+// instead.  out's pixels must be contiguous, like the layers', and may be the
+// bottom layer's own.
+outputMapping_e CompositeLayers(galaxyData_t *out, const layer_t *layers,
+                                int count, color_t *scratch) {
+
+  // Vars
+  int i, p, size;
+  unsigned char unfold;
+  outputMapping_e map = MAP_MIRROR;
+  color_t *dst = out->pixels[0];
+  const color_t *src;
+
+  for (i = 0; i < count; i++) {
+    if (layers[i].map == MAP_FULL) {
+      map = MAP_FULL;
+    }
+  }
+  size = (map == MAP_MIRROR) ? out->topology->pixelsPerArm : out->size;
+
+  for (i = 0; i < count; i++) {
+    src = layers[i].galaxy.pixels[0];
+    unfold = (map == MAP_FULL) && (layers[i].map == MAP_MIRROR);
+    if (unfold && (scratch != NULL)) {
+      for (p = 0; p < size; p++) {
+        scratch[p] = src[GetTipDistance(out->topology, p)];
+      }
+      src = scratch;
+      unfold = FALSE;
+    }
+
+    if (unfold) {
+      // The first arm maps onto itself, so this works in place, too.
+      for (p = 0; p < size; p++) {
+        if (i == 0) {
+          dst[p] = src[GetTipDistance(out->topology, p)];
+        } else {
+          BlendPixels(&dst[p], &src[GetTipDistance(out->topology, p)], 1,
+                      layers[i].mode, layers[i].alpha);
+        }
+      }
+    } else if (i == 0) {
+      if (dst != src) {
+        for (p = 0; p < size; p++) {
+          dst[p] = src[p];
+        }
+      }
+    } else {
+      BlendPixels(dst, src, size, layers[i].mode, layers[i].alpha);
+    }
+  }
+
+  return map;
+}
+
+
+// Blend count pixels of src onto dst.
+void BlendPixels(color_t *dst, const color_t *src, int count,
+                 blendMode_e mode, unsigned char alpha) {
+
+  // Vars
+  unsigned char *d = (unsigned char *) dst;
+  const unsigned char *s = (const unsigned char *) src;
+  int bytes = count * BYTES_PER_PIXEL;
+  int done = 0;
+
+#if defined(EMULATE) && defined(__AVX2__)
+  done = BlendAVX2(d, s, bytes, mode, alpha);
+#elif defined(EMULATE) && defined(__SSE2__)
+  done = BlendSSE2(d, s, bytes, mode, alpha);
+#endif
+
+  // Whatever's left over (or all of it, without SIMD).
+  BlendScalar(d + done, s + done, bytes - done, mode, alpha);
+}
+
+
+// Blend bytes of src onto dst, one at a time.
+void BlendScalar(unsigned char *dst, const unsigned char *src, int bytes,
+                 blendMode_e mode, unsigned char alpha) {
+
+  // Vars
+  int i;
+  unsigned int d, s, f;
+
+  for (i = 0; i < bytes; i++) {
+    d = dst[i];
+    s = src[i];
+    switch (mode) {
+      case BLEND_ADD:
+        f = d + s;
+        if (f > 255) {
+          f = 255;
+        }
+        break;
+      case BLEND_MULTIPLY:
+        f = DIV255(d * s);
+        break;
+      case BLEND_SCREEN:
+        f = 255 - DIV255((255 - d) * (255 - s));
+        break;
+      case BLEND_MAX:
+        f = (s > d) ? s : d;
+        break;
+      case BLEND_ALPHA:
+      default:
+        f = s;
+        break;
+    }
+    if (alpha != 255) {
+      f = DIV255((f * alpha) + (d * (255 - alpha)));
+    }
+    dst[i] = (unsigned char) f;
+  }
+}
+
+
+#if defined(EMULATE) && defined(__AVX2__)
+
+// Divide each 16 bit lane by 255, rounded.
+static inline __m256i Div255x16(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+
+// a * b / 255 for each byte.
+static inline __m256i Mul255(__m256i a, __m256i b) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = Div255x16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero),
+                                            _mm256_unpacklo_epi8(b, zero)));
+  __m256i hi = Div255x16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero),
+                                            _mm256_unpackhi_epi8(b, zero)));
+  return _mm256_packus_epi16(lo, hi);
+}
+
+
+// (f * alpha + d * (255 - alpha)) / 255 for each byte.
+static inline __m256i Mix(__m256i d, __m256i f, __m256i a, __m256i ia) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = Div255x16(_mm256_add_epi16(
+      _mm256_mullo_epi16(_mm256_unpacklo_epi8(f, zero), a),
+      _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), ia)));
+  __m256i hi = Div255x16(_mm256_add_epi16(
+      _mm256_mullo_epi16(_mm256_unpackhi_epi8(f, zero), a),
+      _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), ia)));
+  return _mm256_packus_epi16(lo, hi);
+}
+
+
+// Blend 32 bytes at a time.  Returns how many bytes were done.  (The unpacks
+// and packs work within each 128 bit half, so the bytes come back in order.)
+static int BlendAVX2(unsigned char *dst, const unsigned char *src, int bytes,
+                     blendMode_e mode, unsigned char alpha) {
+  int i;
+  __m256i d, s, f;
+  __m256i ones = _mm256_set1_epi8((char) 0xFF);
+  __m256i a = _mm256_set1_epi16(alpha);
+  __m256i ia = _mm256_set1_epi16(255 - alpha);
+
+  for (i = 0; i + 32 <= bytes; i += 32) {
+    d = _mm256_loadu_si256((const __m256i *) (dst + i));
+    s = _mm256_loadu_si256((const __m256i *) (src + i));
+    switch (mode) {
+      case BLEND_ADD:
+        f = _mm256_adds_epu8(d, s);
+        break;
+      case BLEND_MULTIPLY:
+        f = Mul255(d, s);
+        break;
+      case BLEND_SCREEN:
+        f = _mm256_xor_si256(Mul255(_mm256_xor_si256(d, ones),
+                                    _mm256_xor_si256(s, ones)), ones);
+        break;
+      case BLEND_MAX:
+        f = _mm256_max_epu8(d, s);
+        break;
+      case BLEND_ALPHA:
+      default:
+        f = s;
+        break;
+    }
+    if (alpha != 255) {
+      f = Mix(d, f, a, ia);
+    }
+    _mm256_storeu_si256((__m256i *) (dst + i), f);
+  }
+  return i;
+}
+
+#elif defined(EMULATE) && defined(__SSE2__)
+
+// Divide each 16 bit lane by 255, rounded.
+static inline __m128i Div255x16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+
+// a * b / 255 for each byte.
+static inline __m128i Mul255(__m128i a, __m128i b) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = Div255x16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+                                         _mm_unpacklo_epi8(b, zero)));
+  __m128i hi = Div255x16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+                                         _mm_unpackhi_epi8(b, zero)));
+  return _mm_packus_epi16(lo, hi);
+}
+
+
+// (f * alpha + d * (255 - alpha)) / 255 for each byte.
+static inline __m128i Mix(__m128i d, __m128i f, __m128i a, __m128i ia) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = Div255x16(_mm_add_epi16(
+      _mm_mullo_epi16(_mm_unpacklo_epi8(f, zero), a),
+      _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia)));
+  __m128i hi = Div255x16(_mm_add_epi16(
+      _mm_mullo_epi16(_mm_unpackhi_epi8(f, zero), a),
+      _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia)));
+  return _mm_packus_epi16(lo, hi);
+}
+
+
+// Blend 16 bytes at a time.  Returns how many bytes were done.
+static int BlendSSE2(unsigned char *dst, const unsigned char *src, int bytes,
+                     blendMode_e mode, unsigned char alpha) {
+  int i;
+  __m128i d, s, f;
+  __m128i ones = _mm_set1_epi8((char) 0xFF);
+  __m128i a = _mm_set1_epi16(alpha);
+  __m128i ia = _mm_set1_epi16(255 - alpha);
+
+  for (i = 0; i + 16 <= bytes; i += 16) {
+    d = _mm_loadu_si128((const __m128i *) (dst + i));
+    s = _mm_loadu_si128((const __m128i *) (src + i));
+    switch (mode) {
+      case BLEND_ADD:
+        f = _mm_adds_epu8(d, s);
+        break;
+      case BLEND_MULTIPLY:
+        f = Mul255(d, s);
+        break;
+      case BLEND_SCREEN:
+        f = _mm_xor_si128(Mul255(_mm_xor_si128(d, ones),
+                                 _mm_xor_si128(s, ones)), ones);
+        break;
+      case BLEND_MAX:
+        f = _mm_max_epu8(d, s);
+        break;
+      case BLEND_ALPHA:
+      default:
+        f = s;
+        break;
+    }
+    if (alpha != 255) {
+      f = Mix(d, f, a, ia);
+    }
+    _mm_storeu_si128((__m128i *) (dst + i), f);
+  }
+  return i;
+}
+
+#endif
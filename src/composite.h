@@ -0,0 +1,52 @@
+// File:   composite.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Layer compositor.  Several patterns, each drawing into a layer of its own,
+// blended together into the frame that goes out to the galaxy.
+
+#ifndef COMPOSITE_H
+#define	COMPOSITE_H
+
+  #include "galaxyConfig.h"
+  #include "display.h"
+
+  // Layers run by the PIC (see GeneratePattern() in master.c).  Each one
+  // costs a copy of the pixels and of the pattern state.  The emulator can
+  // run up to MAX_LAYERS, picked on the command line.
+  #define PATTERN_LAYERS 1
+  #define MAX_LAYERS 4
+
+  // How a layer goes onto the layers below it (the destination).  Each works
+  // a byte at a time, and the result is then mixed with the destination by
+  // the layer's alpha.
+  // BLEND_ALPHA - The layer, so alpha alone decides the mix.
+  // BLEND_ADD - The sum, stopping at 255.
+  // BLEND_MULTIPLY - The product, scaled back to 0 - 255.  Only ever darkens.
+  // BLEND_SCREEN - The inverse of the product of the inverses.  Only ever
+  //   lightens.
+  // BLEND_MAX - The brighter of the two.
+  typedef enum {
+    BLEND_ALPHA, BLEND_ADD, BLEND_MULTIPLY, BLEND_SCREEN, BLEND_MAX,
+    BLEND_COUNT // Must be last.
+  } blendMode_e;
+
+  // A layer.  The pixels a pattern draws into, which must be one contiguous
+  // array (galaxy.pixels[i] == galaxy.pixels[0] + i), the output map the
+  // pattern chose, and how to blend it.
+  typedef struct {
+    galaxyData_t galaxy;
+    outputMapping_e map;
+    blendMode_e mode;
+    unsigned char alpha;
+  } layer_t;
+
+  // Prototypes
+  outputMapping_e CompositeLayers(galaxyData_t *out, const layer_t *layers,
+                                  int count, color_t *scratch);
+  void BlendPixels(color_t *dst, const color_t *src, int count,
+                   blendMode_e mode, unsigned char alpha);
+  void BlendScalar(unsigned char *dst, const unsigned char *src, int bytes,
+                   blendMode_e mode, unsigned char alpha);
+
+#endif	/* COMPOSITE_H */
@@ -59,6 +59,7 @@
 
     // Other includes
     #include <plib/usart.h>  // PIC18 peripheral library for the serial port.
+    #include <plib/timers.h> // And for the frame hold timer.
 
   #endif /* EMULATE NOT DEFINED */
 
@@ -70,6 +71,16 @@
   #define FINSTR (FOSC / 4)  // Instruction clock frequency
   #define INSTRUCTION_TIME (1.0 / FINSTR) // Time to execute 1 instruction (s)
 
+  // Frame hold timer - Timer0, 16 bit, counting instructions / 64.  A tick is
+  // 21.3us at FOSC = 12MHz, so the longest hold is about 1.4s.  HOLD_TICKS()
+  // converts a hold in us to ticks, and is good up to HOLD_MAX_US.  HOLD_US()
+  // converts back.
+  #define HOLD_PRESCALE 64
+  #define HOLD_MAX_US 700000L
+  #define HOLD_TICKS(us) (((us) * (FINSTR / 1000L)) / (HOLD_PRESCALE * 1000L))
+  #define HOLD_US(ticks) ((long int) (((unsigned long int) (ticks) * \
+                          (HOLD_PRESCALE * 1000UL)) / (FINSTR / 1000UL)))
+
   // I/O Ports - Harmless enough on the x86 target.
   #define DEBUG_LED (PORTAbits.RA2)
   #define LED_ON 0    // Debug LEDs are sinked, so their port sense is switched.
@@ -7,178 +7,624 @@
 // Includes
 #include "deviceConfig.h"
 #include "display.h"
+#include "patternSupport.h"  // colors[] for the palette.
+#include <stdlib.h>          // NULL
+#ifdef EMULATE
+  #include "emuUart.h"
+  #include <stdio.h>
+#endif
+
+// Each link_t (see display.h) carries the state of one link from packet to
+// packet:
+// - The wire table is the galaxy's topology (see topology.c) compiled down to
+//   one pointer per packet byte, in transmission order (source[]).  Address
+//   slots point at the slave address and data slots point straight at the
+//   pixel channel that goes in that spot, so building a packet is a single
+//   copy loop with no mapping decisions left in it.  The table is bound to a
+//   particular galaxy and output map, and is recompiled if either changes
+//   (which only happens when a new pattern starts).  It costs 2 bytes of RAM
+//   per packet byte on the PIC, which we can afford.  The emulator sizes it to
+//   the topology.  blockStart[] holds the index of each slave's address byte,
+//   with one extra entry marking the end of the last block.
+// - link->slaveShadow[] is what the slaves are currently showing, in wire order, as
+//   of the last packet built.  Slave blocks that match it are left out of the
+//   next packet.  Every FULL_REFRESH_INTERVAL packets, all the blocks are sent
+//   regardless, so a slave that missed some bytes doesn't stay wrong for long.
+// - Slave blocks are sent compressed when that's shorter, unless turned off.
+//   Likewise broadcast commands in place of slave blocks.  Both are off unless
+//   the slaves can take them (see SLAVE_EXTENSIONS in galaxyConfig.h).
+// - A change to the global brightness is sent with the next packet.
+
+// Broadcast opportunities found by comparing a frame to slaveShadow, for one
+// color channel.  A channel that changed by the same amount in every triplet
+// can be sent as an OP_FADE.  A channel that has the same value in every
+// triplet can be sent as part of an OP_FILL.
+typedef struct {
+  unsigned char changed;      // Any triplet changed in this channel.
+  unsigned char uniform;      // All triplets hold the same value...
+  unsigned char value;        // ... which is this.
+  unsigned char modular;      // All triplets rolled over by the same amount...
+  unsigned char delta;        // ... which is this.
+  unsigned char constrained;  // All triplets moved by amount, stopping at the limits.
+  unsigned char exact;        // One of them didn't hit a limit, so we know amount.
+  int amount, low, high;      // amount, or if not exact, the range it lies in.
+} broadcastCheck_t;
+
+// Packet double buffer.  One packet is built while the other is going out the
+// serial port in the background.
+static packet_t packetBuffer[2];
+static unsigned char backBuffer = 0;
+#ifdef EMULATE
+static const topology_t *packetTopology = NULL;  // What packetBuffer is sized for.
+#endif
+
+#ifndef EMULATE
+// Transmit interrupt state.  The interrupt owns these while txBusy is set.
+static const packet_t * volatile txPacket;
+static volatile int txIndex;
+static volatile unsigned char txBusy = FALSE;
+#endif
 
 // Prototypes
-void TransmitAddress(unsigned char value);
-void TransmitData(unsigned char value);
+void CompileWireTable(link_t *link, galaxyData_t *gData, outputMapping_e mapType);
+void CheckForBroadcast(link_t *link, const unsigned char *frame, broadcastCheck_t *check);
+int PackBroadcast(packet_t *packet, broadcastCheck_t *check, int limit);
+void AddByte(packet_t *packet, unsigned char value, unsigned char isAddress);
+int EncodeBlock(const unsigned char *block, const slave_t *slave, unsigned char *out, int limit);
+int PaletteIndex(const unsigned char *triplet, const colorChannel_e *byteOrder);
+unsigned char SameTriplet(const unsigned char *a, const unsigned char *b);
+
 
 // Write out a whole set of instructions to the slaves to set the lights.
-// Note, we mirror the output to each arm, making all patterns symmetrical.
-// This wasn't required... It was lazy.
-// Including all data bytes and address byte transmissions, we are writing out
-// 135 bytes in the code below.  A byte consists of 1 start bit, 8 data bits,
-// 1 address bit, 1 stop bit, for a total of 11 bits per byte.  This makes a
-// total of 1485 bits written out by this blocking code.  This is our rate
-// limiting step.  At 69.4 kbps (transmission baud rate), this means a full
-// update to all the lights takes 21.3 ms.  This translates to a maximum
-// galactic frame rate of 46.8 FPS (1 / 21.3ms).  This code could be re-written
-// to take advantage of interrupts, as well as adding special control codes for
-// common operations (like full galactic blanking or all light color update,
-// partial frame updates, sync signals, etc), which would allow for a
-// significantly faster frame rate and more time to do number crunching, but
-// we aren't there yet.  A change like that would significantly change the way
-// all patterns are written.  For now, the emulation will set a timer to wait
-// for the transmission time so that the output more closely matches the PIC
-// target output.
-void WriteLights(galaxyData_t *gData, outputMapping_e mapType) {
-  int i;
-  // Variable chipAddressMap is a map of the slave chip addresses.  These values
-  // were originally chosen because the initial pattern generation platform did
-  // not properly support 9 bit serial addressing or switching on the fly between
-  // MARK and SPACE parity.  I had to use ODD parity with 8 data bits to emulate
-  // the 9 bit serial scheme that the PIC slaves use to distinguish data bytes
-  // from address bytes in serial communications.  The addresses below, therefore,
-  // all have the same parity to indicate that they are addresses.  The data
-  // bytes (at the time) had to be constrained to avoid this parity (effectively
-  // eliminating 1/2 the available intensity values. Thankfully, this is no longer
-  // the case, however, the addresses remain as an artifact of the earlier
-  // situation.
-  const unsigned char chipAddressMap[] = {0x03, 0x05, 0x06, 0x09, 0x0a, 0x12, 0x11, 0x0f, 0x0c};
-
-  // First 15 leds. (5 triplets) - 16 bytes.
-  TransmitAddress(chipAddressMap[0]);
-  for (i = 20; i > 15; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
-  }
-
-  // Next 15 leds. (5 triplets) - 16 bytes
-  TransmitAddress(chipAddressMap[1]);
-  for (i = 15; i > 10; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
-  }
-
-  // third 15 leds. (5 triplets) - 16 bytes
-  TransmitAddress(chipAddressMap[2]);
-  for (i = 10; i > 5; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
-  }
-
-  // fourth 15 leds.  (5 triplets) - 16 bytes
-  TransmitAddress(chipAddressMap[3]);
-  for (i = 5; i > 0; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
-  }
- 
-  // Chip #4 -> 0x0a is the end cap / shared chip (slave #9 in the original galaxy)
-  // It controls the last LED TRIPLET on each arm.
-  TransmitAddress(chipAddressMap[4]); //  - 7 bytes
-    TransmitData(gData->pixels[0]->g);
-    TransmitData(gData->pixels[0]->b);
-    TransmitData(gData->pixels[0]->r);
-
-  if (mapType == MAP_MIRROR) {
-    TransmitData(gData->pixels[0]->g);
-    TransmitData(gData->pixels[0]->b);
-    TransmitData(gData->pixels[0]->r);
-  } else {
-    TransmitData(gData->pixels[41]->g);
-    TransmitData(gData->pixels[41]->b);
-    TransmitData(gData->pixels[41]->r);
+// Note, in MAP_MIRROR we mirror the output to each arm, making all patterns
+// symmetrical.  This wasn't required... It was lazy.
+// Including all data bytes and address byte transmissions, a full frame is
+// 135 bytes on the galaxy.  A byte consists of 1 start bit, 8 data bits, 1 address bit, 1
+// stop bit, for a total of 11 bits per byte.  This makes a total of 1485 bits.
+// This is our rate limiting step.  At 69.4 kbps (transmission baud rate), this
+// means a full update to all the lights takes 21.3 ms.  This translates to a
+// maximum galactic frame rate of 46.8 FPS (1 / 21.3ms).  We do better than
+// that in three ways:
+// - The bytes are shifted out by the transmit interrupt, so WriteLights()
+//   returns as soon as the packet is handed over, and the pattern code gets the
+//   whole transmission time to crunch numbers for the next frame.  It only
+//   waits if it comes back with the next frame before the last one is out.
+// - Frames are sent partially.  A slave whose pixels haven't changed since the
+//   last frame is skipped entirely.
+// - Frames that can be described as a change to the whole galaxy at once
+//   (all one color, all off, one channel faded up or down) are sent as a
+//   broadcast control code of a few bytes instead.
+// See BuildPacket() for the details.  The emulation models the serial port with
+// a thread that holds each packet for its transmission time so that the output
+// more closely matches the PIC target output.
+// link is the galaxy's (see LinkInit()).  Returns the number of bytes sent.
+int WriteLights(link_t *link, galaxyData_t *gData, outputMapping_e mapType) {
+  packet_t *packet = &packetBuffer[backBuffer];
+
+#ifdef EMULATE
+  // Size the packets for the galaxy.  This happens once, before anything is
+  // on the wire - a run drives one topology.
+  if (packetTopology != gData->topology) {
+    AllocatePacket(&packetBuffer[0], gData->topology);
+    AllocatePacket(&packetBuffer[1], gData->topology);
+    packetTopology = gData->topology;
+  }
+#endif
+
+  // Build into the buffer that isn't on the wire, then swap.
+  BuildPacket(link, gData, mapType, packet);
+  TransmitPacket(packet);
+  backBuffer ^= 1;
+  return packet->length;
+}
+
+
+// Pack the galaxy's pixels into a packet in wire order.  The packet contains
+// the shortest of:
+// - The blocks for the slaves whose pixels have changed since the last packet,
+//   each one raw or compressed, whichever is shorter.
+// - Broadcast commands that turn what the slaves are showing into the new frame.
+// Every FULL_REFRESH_INTERVAL packets, all the slave blocks are sent instead.
+// A pending global brightness change goes on the end.  What the slaves were
+// showing, and what the packet may use, come from link, which is brought up
+// to date.
+void BuildPacket(link_t *link, galaxyData_t *gData, outputMapping_e mapType,
+                 packet_t *packet) {
+  int i, slave, slaveCount, out, blockOut, end;
+  unsigned char changed, fullRefresh;
+  broadcastCheck_t check[BYTES_PER_PIXEL];
+
+  // (Re)compile the wire table if the galaxy or the map has changed.  The
+  // slaves get a full frame after a map change.
+  if (!link->compiled || (link->galaxy != gData) ||
+      (link->topology != gData->topology) || (link->map != mapType)) {
+    CompileWireTable(link, gData, mapType);
+    link->refreshCountdown = 0;
+  }
+
+  // Time for a full refresh?
+  fullRefresh = FALSE;
+  if (link->refreshCountdown <= 0) {
+    fullRefresh = TRUE;
+    link->refreshCountdown = FULL_REFRESH_INTERVAL;
+  }
+  link->refreshCountdown--;
+
+  // Pack the whole frame.
+  slaveCount = link->topology->slaveCount;
+  end = link->blockStart[slaveCount];
+  for (i = 0; i < end; i++) {
+    packet->bytes[i] = *link->source[i];
+  }
+  for (i = 0; i < ((end + 7) >> 3); i++) {
+    packet->addressMask[i] = 0;
   }
 
-  // First 15 leds. (5 triplets)  - 16 bytes
-  if (mapType == MAP_MIRROR) {
-  TransmitAddress(chipAddressMap[8]);
-  for (i = 20; i > 15; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  // Could a broadcast do the job?
+  if (link->broadcast && !fullRefresh) {
+    CheckForBroadcast(link, packet->bytes, check);
   }
 
-  // Next 15 leds. (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[7]);
-  for (i = 15; i > 10; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  // Squeeze out the unchanged slave blocks, updating the shadow as we go.
+  out = 0;
+  for (slave = 0; slave < slaveCount; slave++) {
+    blockOut = out;
+    changed = fullRefresh;
+    for (i = link->blockStart[slave]; i < link->blockStart[slave + 1]; i++) {
+      changed |= (packet->bytes[i] ^ link->slaveShadow[i]);
+      link->slaveShadow[i] = packet->bytes[i];
+      packet->bytes[out++] = packet->bytes[i];
+    }
+
+    if (changed) {
+      packet->addressMask[blockOut >> 3] |= 1 << (blockOut & 0x07);
+
+      // Compress the block if that's shorter.  This works from the shadow
+      // (which now holds the new block), so it can't trip over itself.
+      if (link->compression) {
+        i = link->blockStart[slave];
+        out = blockOut + EncodeBlock(&link->slaveShadow[i], &link->topology->slaves[slave],
+                                     &packet->bytes[blockOut], out - blockOut);
+      }
+    } else {
+      out = blockOut;
+    }
   }
+  packet->length = out;
 
-  // third 15 leds. (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[6]);
-  for (i = 10; i > 5; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  // If the broadcast version is shorter, send it instead.
+  if (link->broadcast && !fullRefresh && (out > 0)) {
+    PackBroadcast(packet, check, out);
   }
 
-  // fourth 15 leds.  (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[5]);
-  for (i = 5; i > 0; i--) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  // Brightness, which is a broadcast command too.
+  if (link->brightnessChanged && link->broadcast) {
+    AddByte(packet, BROADCAST_ADDRESS, TRUE);
+    AddByte(packet, OP_SCALE, FALSE);
+    AddByte(packet, link->brightness, FALSE);
+    link->brightnessChanged = FALSE;
   }
+}
+
+
+// Compare a full frame in wire order against what the slaves on link are
+// showing, and fill in a broadcastCheck_t for each color channel.
+void CheckForBroadcast(link_t *link, const unsigned char *frame, broadcastCheck_t *check) {
+  int i, slave, end, diff;
+  unsigned char c, value, old;
+  broadcastCheck_t *p;
+  const colorChannel_e *byteOrder;
+
+  byteOrder = link->topology->slaves[0].byteOrder;
+  for (c = 0; c < BYTES_PER_PIXEL; c++) {
+    p = &check[byteOrder[c]];
+    p->changed = FALSE;
+    p->uniform = TRUE;
+    p->value = frame[link->blockStart[0] + 1 + c];
+    p->modular = TRUE;
+    p->delta = p->value - link->slaveShadow[link->blockStart[0] + 1 + c];
+    p->constrained = TRUE;
+    p->exact = FALSE;
+    p->low = -255;
+    p->high = 255;
+  }
+
+  for (slave = 0; slave < link->topology->slaveCount; slave++) {
+    byteOrder = link->topology->slaves[slave].byteOrder;
+    end = link->blockStart[slave + 1];
+    c = 0;
+    for (i = link->blockStart[slave] + 1; i < end; i++) {
+      p = &check[byteOrder[c]];
+      value = frame[i];
+      old = link->slaveShadow[i];
+      diff = (int) value - (int) old;
+
+      p->changed |= (value != old);
+      p->uniform &= (value == p->value);
+      p->modular &= ((unsigned char) (value - old) == p->delta);
+
+      // Constrained - a value at a limit only tells us how far it was pushed
+      // at least.  Anything else tells us the amount exactly.
+      if (value == 255) {
+        if (diff > p->low) p->low = diff;
+      } else if (value == 0) {
+        if (diff < p->high) p->high = diff;
+      } else if (!p->exact) {
+        p->exact = TRUE;
+        p->amount = diff;
+      } else if (p->amount != diff) {
+        p->constrained = FALSE;
+      }
+
+      if (++c >= BYTES_PER_PIXEL) c = 0;
+    }
+  }
+
+  // Settle on the constrained amount.
+  for (c = 0; c < BYTES_PER_PIXEL; c++) {
+    p = &check[c];
+    if (!p->exact) {
+      p->amount = (p->low > 0) ? p->low : p->high;
+    }
+    if ((p->amount < p->low) || (p->amount > p->high)) {
+      p->constrained = FALSE;
+    }
+  }
+}
+
+
+// Replace the contents of a packet with broadcast commands if they would be
+// shorter than limit bytes.  Returns TRUE if it did.
+int PackBroadcast(packet_t *packet, broadcastCheck_t *check, int limit) {
+  unsigned char c, uniform, black, canFade;
+  int length;
+
+  uniform = TRUE;
+  black = TRUE;
+  canFade = TRUE;
+  length = 0;
+  for (c = 0; c < BYTES_PER_PIXEL; c++) {
+    uniform &= check[c].uniform;
+    black &= (check[c].value == 0);
+    if (check[c].changed) {
+      canFade &= (check[c].modular || check[c].constrained);
+      length += 2 + OPERAND_COUNT(OP_FADE);
+    }
+  }
+
+  // A whole galaxy of one color.
+  if (uniform) {
+    if (black && ((2 + OPERAND_COUNT(OP_BLANK)) < limit)) {
+      packet->length = 0;
+      AddByte(packet, BROADCAST_ADDRESS, TRUE);
+      AddByte(packet, OP_BLANK, FALSE);
+      return TRUE;
+    }
+    if ((2 + OPERAND_COUNT(OP_FILL)) < limit) {
+      packet->length = 0;
+      AddByte(packet, BROADCAST_ADDRESS, TRUE);
+      AddByte(packet, OP_FILL, FALSE);
+      for (c = 0; c < BYTES_PER_PIXEL; c++) {
+        AddByte(packet, check[c].value, FALSE);
+      }
+      return TRUE;
+    }
+  }
+
+  // Fades, one per channel that changed.
+  if (canFade && (length < limit)) {
+    packet->length = 0;
+    for (c = 0; c < BYTES_PER_PIXEL; c++) {
+      if (!check[c].changed) continue;
+      AddByte(packet, BROADCAST_ADDRESS, TRUE);
+      AddByte(packet, OP_FADE, FALSE);
+      AddByte(packet, c, FALSE);
+      if (check[c].modular) {
+        AddByte(packet, check[c].delta, FALSE);
+        AddByte(packet, FADE_MODULAR, FALSE);
+      } else if (check[c].amount >= 0) {
+        AddByte(packet, check[c].amount, FALSE);
+        AddByte(packet, FADE_RAISE, FALSE);
+      } else {
+        AddByte(packet, -check[c].amount, FALSE);
+        AddByte(packet, FADE_LOWER, FALSE);
+      }
+    }
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+// Append a byte to a packet.
+void AddByte(packet_t *packet, unsigned char value, unsigned char isAddress) {
+  int i = packet->length;
+
+  if (isAddress) {
+    packet->addressMask[i >> 3] |= 1 << (i & 0x07);
   } else {
-  // 21 - 25. (5 triplets) - 16 bytes
-  TransmitAddress(chipAddressMap[8]);
-  for (i = 21; i < 26; i++) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+    packet->addressMask[i >> 3] &= ~(1 << (i & 0x07));
+  }
+  packet->bytes[i] = value;
+  packet->length = i + 1;
+}
+
+
+// Walk the slave topology and record where each byte of the packet comes from.
+void CompileWireTable(link_t *link, galaxyData_t *gData, outputMapping_e mapType) {
+  int i, slave, triplet, pixel, c;
+  const topology_t *topology = gData->topology;
+  const slave_t *s;
+
+#ifdef EMULATE
+  // Size the tables (and the shadow) for the topology.
+  if (link->topology != topology) {
+    i = GetFrameBytes(topology);
+    link->source = realloc(link->source, i * sizeof(*link->source));
+    link->blockStart = realloc(link->blockStart,
+                               (topology->slaveCount + 1) * sizeof(int));
+    link->slaveShadow = realloc(link->slaveShadow, i);
+    if ((link->source == NULL) || (link->blockStart == NULL) ||
+        (link->slaveShadow == NULL)) {
+      fprintf(stderr, "Unable to allocate the wire table!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+#endif
+
+  i = 0;
+  for (slave = 0; slave < topology->slaveCount; slave++) {
+    s = &topology->slaves[slave];
+
+    // Address byte.
+    link->blockStart[slave] = i;
+    link->source[i++] = &s->address;
+
+    // Data bytes, one triplet at a time.
+    for (triplet = 0; triplet < s->count; triplet++) {
+      pixel = s->first + (triplet * s->step);
+
+      // Mirrored output folds every arm back onto the first.
+      if (mapType == MAP_MIRROR) {
+        pixel = GetTipDistance(topology, pixel);
+      }
+
+      for (c = 0; c < BYTES_PER_PIXEL; c++) {
+        link->source[i++] = &gData->pixels[pixel]->chan[s->byteOrder[c]];
+      }
+    }
   }
 
-  // 26 - 30. (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[7]);
-  for (i = 26; i < 31; i++) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  link->blockStart[topology->slaveCount] = i;
+  link->galaxy = gData;
+  link->topology = topology;
+  link->map = mapType;
+  link->compiled = TRUE;
+}
+
+
+// Try to compress a slave block (starting with its address byte).  If the
+// compressed block is shorter than limit bytes, write it to out and return its
+// length, otherwise leave out alone and return limit.
+int EncodeBlock(const unsigned char *block, const slave_t *slave, unsigned char *out, int limit) {
+  int t, tripletCount, rleLength, rleRun, paletteLength, paletteRun, index;
+  const unsigned char *triplet;
+  unsigned char same;
+
+  tripletCount = slave->count;
+
+  // Work out how long each encoding would be.
+  rleLength = 2;
+  rleRun = 0;
+  paletteLength = 2;
+  paletteRun = 0;
+  for (t = 0; t < tripletCount; t++) {
+    triplet = &block[1 + (t * BYTES_PER_PIXEL)];
+    same = (t > 0) && SameTriplet(triplet, triplet - BYTES_PER_PIXEL);
+
+    if (same && (rleRun < 255)) {
+      rleRun++;
+    } else {
+      rleLength += 1 + BYTES_PER_PIXEL;
+      rleRun = 1;
+    }
+
+    if (paletteLength > 0) {
+      if (same && (paletteRun < PALETTE_RUN_MAX)) {
+        paletteRun++;
+      } else if (!same && (PaletteIndex(triplet, slave->byteOrder) < 0)) {
+        paletteLength = 0;  // Not a named color, no palette encoding.
+      } else {
+        paletteLength++;
+        paletteRun = 1;
+      }
+    }
   }
 
-  // 31 - 35. (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[6]);
-  for (i = 31; i < 36; i++) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  // Pick one and write it out.
+  out[0] = block[0] | ENCODED_BLOCK;
+  index = 2;
+  if ((paletteLength > 0) && (paletteLength < limit) && (paletteLength <= rleLength)) {
+    out[1] = ENC_PALETTE;
+    for (t = 0; t < tripletCount; t++) {
+      triplet = &block[1 + (t * BYTES_PER_PIXEL)];
+      same = (t > 0) && SameTriplet(triplet, triplet - BYTES_PER_PIXEL);
+      if (same && ((out[index - 1] >> PALETTE_RUN_SHIFT) < (PALETTE_RUN_MAX - 1))) {
+        out[index - 1] += 1 << PALETTE_RUN_SHIFT;
+      } else {
+        out[index++] = PaletteIndex(triplet, slave->byteOrder);
+      }
+    }
+  } else if (rleLength < limit) {
+    out[1] = ENC_RLE;
+    for (t = 0; t < tripletCount; t++) {
+      triplet = &block[1 + (t * BYTES_PER_PIXEL)];
+      same = (t > 0) && SameTriplet(triplet, triplet - BYTES_PER_PIXEL);
+      if (same && (out[index - 1 - BYTES_PER_PIXEL] < 255)) {
+        out[index - 1 - BYTES_PER_PIXEL]++;
+      } else {
+        out[index++] = 1;
+        out[index++] = triplet[0];
+        out[index++] = triplet[1];
+        out[index++] = triplet[2];
+      }
+    }
+  } else {
+    out[0] = block[0];  // Raw is shortest, put the address back.
+    index = limit;
   }
 
-  // 36 - 40.  (5 triplets)  - 16 bytes
-  TransmitAddress(chipAddressMap[5]);
-  for (i = 36; i < 41; i++) {
-    TransmitData(gData->pixels[i]->g);
-    TransmitData(gData->pixels[i]->b);
-    TransmitData(gData->pixels[i]->r);
+  return index;
+}
+
+
+// Compare two triplets.
+unsigned char SameTriplet(const unsigned char *a, const unsigned char *b) {
+  return (a[0] == b[0]) && (a[1] == b[1]) && (a[2] == b[2]);
+}
+
+
+// Find a triplet (in a slave's byte order) in the palette.  Returns -1 if it
+// isn't there.
+int PaletteIndex(const unsigned char *triplet, const colorChannel_e *byteOrder) {
+  int i, c;
+  const color_t *color;
+
+  for (i = 0; i < PALETTE_SIZE; i++) {
+    color = PaletteColor(i);
+    for (c = 0; c < BYTES_PER_PIXEL; c++) {
+      if (triplet[c] != color->chan[byteOrder[c]]) break;
+    }
+    if (c == BYTES_PER_PIXEL) return i;
   }
+  return -1;
+}
+
+
+// The palette the slaves know - the named colors, then the greys.
+const color_t *PaletteColor(int index) {
+  if (index < COLOR_COUNT) {
+    return colors[index];
   }
+  return colorsMono[index - COLOR_COUNT];
 }
 
 
-// Transmit a data byte on the serial port.
-void TransmitData(unsigned char value) {
-#ifndef EMULATE
-  while (BusyUSART());  // Wait to make sure the last byte is done transmitting.
-  TXSTAbits.TX9D = BYTETYPE_DATA;  // Set the next as a data byte.
-  TXREG = value;  // Write the next byte to be shifted out.
+#ifdef EMULATE
+// Size a packet's buffers for a topology - a full frame plus a brightness
+// command.  Any old buffers are left alone, as the transmitter may still have
+// them.
+void AllocatePacket(packet_t *packet, const topology_t *topology) {
+  int size = GetFrameBytes(topology) + SCALE_BYTES;
+
+  packet->bytes = calloc(size, 1);
+  packet->addressMask = calloc((size + 7) / 8, 1);
+  packet->length = 0;
+  if ((packet->bytes == NULL) || (packet->addressMask == NULL)) {
+    fprintf(stderr, "Unable to allocate a packet!\n");
+    exit(EXIT_FAILURE);
+  }
+}
 #endif
+
+
+// Set up a link to a galaxy's slaves, which haven't been sent anything yet.
+// Compression and broadcast commands are on, if the slaves can take them.
+void LinkInit(link_t *link) {
+#ifdef EMULATE
+  link->source = NULL;
+  link->blockStart = NULL;
+  link->slaveShadow = NULL;
+#endif
+  link->galaxy = NULL;
+  link->topology = NULL;
+  link->map = MAP_FULL;
+  link->compiled = FALSE;
+  link->refreshCountdown = 0;
+  link->compression = SLAVE_EXTENSIONS;
+  link->broadcast = SLAVE_EXTENSIONS;
+  link->brightness = 255;
+  link->brightnessChanged = FALSE;
+}
+
+
+// Turn slave block compression on or off.
+void SetCompression(link_t *link, unsigned char enable) {
+  link->compression = enable && SLAVE_EXTENSIONS;
+}
+
+
+// Turn broadcast commands on or off, both in place of slave blocks and for the
+// global brightness.  A brightness change made while they're off waits until
+// they're back on.  They can't be turned on without SLAVE_EXTENSIONS.
+void SetBroadcast(link_t *link, unsigned char enable) {
+  link->broadcast = enable && SLAVE_EXTENSIONS;
+}
+
+
+// Force the next packet to include every slave.
+void RefreshAllSlaves(link_t *link) {
+  link->refreshCountdown = 0;
 }
 
 
-// Transmit an address to the serial port.
-void TransmitAddress(unsigned char value) {
+// Set the global brightness of the galaxy (255 is full).  The slaves do the
+// scaling, so this doesn't touch the pixel data.
+void SetBrightness(link_t *link, unsigned char level) {
+  if (level != link->brightness) {
+    link->brightness = level;
+    link->brightnessChanged = TRUE;
+  }
+}
+
+
+// Start a packet out the serial port.  Waits for the previous packet to
+// finish first, then returns as soon as the new one is underway.  The packet
+// belongs to the transmitter until the next call, so don't touch it until then.
+// An empty packet waits too, since WriteLights() swaps buffers regardless, and
+// the next frame goes into the one the interrupt may still be sending.
+void TransmitPacket(const packet_t *packet) {
 #ifndef EMULATE
-  DEBUG_LED = LED_ON;  // Debugging
-  while (BusyUSART());  // Wait for the last byte to transmit.
+  DEBUG_LED = LED_ON;  // Debugging - lit while we wait on the transmitter.
+  while (txBusy);
   DEBUG_LED = LED_OFF;  // Debugging
-  TXSTAbits.TX9D = BYTETYPE_ADDRESS;  // Set the next as an address.
-  TXREG = value;  // Write the address to be shifted out.
+
+  // Nothing changed, nothing to send.
+  if (packet->length == 0) {
+    return;
+  }
+
+  // Hand the packet to the interrupt and enable it.  TXIF is set whenever
+  // TXREG is empty, so the interrupt fires right away for the first byte.
+  txPacket = packet;
+  txIndex = 0;
+  txBusy = TRUE;
+  PIE1bits.TXIE = 1;
+#else
+  EmuUartSend(packet);
 #endif
 }
+
+
+#ifndef EMULATE
+// Interrupt service routine.  The only interrupt source we use is the USART
+// transmitter.  Each time TXREG empties, load the next byte with its 9th bit.
+// When the packet is exhausted, disable the interrupt (TXIF stays set while
+// TXREG is empty, so it would otherwise fire forever) and release the packet.
+void interrupt SerialISR(void) {
+  unsigned char i;
+
+  if (PIE1bits.TXIE && PIR1bits.TXIF) {
+    i = txIndex;
+    TXSTAbits.TX9D = PACKET_IS_ADDRESS(txPacket, i) ? BYTETYPE_ADDRESS : BYTETYPE_DATA;
+    TXREG = txPacket->bytes[i];
+    i++;
+    txIndex = i;
+    if (i >= txPacket->length) {
+      PIE1bits.TXIE = 0;
+      txBusy = FALSE;
+    }
+  }
+}
+#endif /* EMULATE */
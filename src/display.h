@@ -7,17 +7,132 @@
 
   // Include
   #include "galaxyConfig.h"
+  #include "topology.h"
 
   // These are the available output maps for writing to the galaxy.
-  // MAP_MIRROR results in the first 1/2 of the pixel array being written
-  // symmetrically to each arm.  Zero pixel is the outermost tip of both arms.
-  // ((max_pixel + ) / 2) - 1 is the innermost point.
+  // MAP_MIRROR results in the first arm of the pixel array being written
+  // symmetrically to each arm.  Zero pixel is the outermost tip of every arm.
+  // pixelsPerArm - 1 is the innermost point.
   // MAP_FULL results in the whole map being written to the galaxy.  Zero pixel
-  // is the outermost tip of one arm, max_pixel is the outermost tip of the
-  // other arm.  max_pixel / 2 is the center of the galaxy.
+  // is the outermost tip of the first arm, and the array runs in to the center
+  // and back out along the next arm (see topology_t).  On the galaxy,
+  // max_pixel is the outermost tip of the other arm, and max_pixel / 2 is the
+  // center.
   typedef enum { MAP_MIRROR, MAP_FULL } outputMapping_e;
 
+  // Broadcast control codes.  Every slave listens to BROADCAST_ADDRESS.  The
+  // data bytes that follow it are an opcode and its operands, and act on all
+  // of the galaxy's LEDs at once.  A few bytes here can stand in for a whole
+  // 135 byte frame.  Colors and channels are given red, green, blue, and each
+  // slave puts them in its own byte order.
+  #define BROADCAST_ADDRESS 0x00
+  typedef enum {
+    OP_BLANK = 0x01,  // No operands. Turn off every LED.
+    OP_FILL = 0x02,   // 3 operands, the color. Every LED to one color.
+    OP_SCALE = 0x04,  // 1 operand, level. Global brightness, 255 is full.
+    OP_FADE = 0x07    // 3 operands, channel, amount, mode. Add amount to one
+                      // channel of every triplet.
+  } opcode_e;
+
+  // Modes for OP_FADE.  FADE_MODULAR rolls over like FadeChannel()'s
+  // MODE_MODULAR.  FADE_RAISE and FADE_LOWER stop at the limits like
+  // MODE_CONSTRAINED, adding or subtracting the amount respectively.
+  typedef enum { FADE_MODULAR, FADE_RAISE, FADE_LOWER } fadeMode_e;
+
+  // Number of operand bytes that follow each opcode.
+  #define OPERAND_COUNT(op) (((op) == OP_FILL) || ((op) == OP_FADE) ? 3 : \
+                             ((op) == OP_SCALE) ? 1 : 0)
+
+  // Compressed slave blocks.  A slave address with ENCODED_BLOCK added is
+  // followed by an encoding byte, then the slave's triplets in that encoding
+  // rather than raw.  ENCODED_BLOCK is two bits so the address keeps its parity.
+  // ENC_RLE - Runs of one color, 4 bytes each: run length, then the color in
+  //   the slave's byte order.
+  // ENC_PALETTE - Runs of a named color, 1 byte each: (run length - 1) in the
+  //   top 3 bits, index into the palette (colors[], then colorsMono[]) in the
+  //   bottom 5.
+  #define ENCODED_BLOCK 0xc0
+  typedef enum { ENC_RLE = 0x01, ENC_PALETTE = 0x02 } encoding_e;
+  #define PALETTE_SIZE (COLOR_COUNT + MONO_COUNT)
+  #define PALETTE_RUN_MAX 8
+  #define PALETTE_INDEX_MASK 0x1f
+  #define PALETTE_RUN_SHIFT 5
+
+  // A global brightness command is tacked on to the end of a frame.
+  #define SCALE_BYTES 3
+
+  // Packets normally carry only the slaves that changed since the last packet.
+  // Every FULL_REFRESH_INTERVAL packets, all of them are sent anyway in case
+  // any bytes were lost.  At 46.8 FPS, 47 is about once a second.
+  #define FULL_REFRESH_INTERVAL 47
+
+  // The 9th bit mask needs one bit per packet byte.
+  #define PACKET_MASK_BYTES ((PACKET_BYTES + SCALE_BYTES + 7) / 8)
+
+  // A packet is the wire image of one galactic frame - the address and data
+  // bytes for each slave being updated, or the broadcast commands that replace
+  // them, in the order they go out the serial port.  addressMask holds
+  // the 9th (address/data) bit for each byte, 1 for an address byte, 0 for a
+  // data byte.  Anything that wants to know what the slaves were told (the
+  // transmitter, the emulator, a recorder) can read the same packet.  What
+  // goes into it depends on what went before, which is kept in a link_t.
+  // The PIC only drives the galaxy, so its packets are sized for it.  The
+  // emulator's are sized for the topology by AllocatePacket().
+  typedef struct {
+  #ifdef EMULATE
+    unsigned char *bytes;
+    unsigned char *addressMask;
+  #else
+    unsigned char bytes[PACKET_BYTES + SCALE_BYTES];
+    unsigned char addressMask[PACKET_MASK_BYTES];
+  #endif
+    int length;
+  } packet_t;
+
+  // Test the 9th bit of byte i in a packet.
+  #define PACKET_IS_ADDRESS(packet, i) \
+    ((packet)->addressMask[(i) >> 3] & (1 << ((i) & 0x07)))
+
+  // One galaxy's link to its slaves, as far as the packet builder is
+  // concerned: the wire table (see display.c), what the slaves are showing
+  // (only changes are sent), and what the packets may use.  Each string of
+  // slaves being driven needs a link of its own, set up with LinkInit().  The
+  // PIC drives one, and the emulator one for every galaxy it builds packets
+  // for.
+  typedef struct {
+  #ifdef EMULATE
+    const unsigned char **source;
+    int *blockStart;
+    unsigned char *slaveShadow;
+  #else
+    const unsigned char *source[PACKET_BYTES];
+    int blockStart[SLAVE_COUNT + 1];
+    unsigned char slaveShadow[PACKET_BYTES];
+  #endif
+    galaxyData_t *galaxy;           // What the wire table was compiled for.
+    const topology_t *topology;
+    outputMapping_e map;
+    unsigned char compiled;
+    int refreshCountdown;           // Packets to the next full refresh.
+    unsigned char compression;      // Compressed slave blocks allowed.
+    unsigned char broadcast;        // Broadcast commands allowed.
+    unsigned char brightness;       // Global brightness, and whether it's
+    unsigned char brightnessChanged;  // still to be sent.
+  } link_t;
+
   // Public prototypes
-  void WriteLights(galaxyData_t *galaxyData, outputMapping_e mapType);
+  void LinkInit(link_t *link);
+  int WriteLights(link_t *link, galaxyData_t *galaxyData, outputMapping_e mapType);
+  void BuildPacket(link_t *link, galaxyData_t *galaxyData, outputMapping_e mapType,
+                   packet_t *packet);
+  void TransmitPacket(const packet_t *packet);
+  void RefreshAllSlaves(link_t *link);
+  void SetBrightness(link_t *link, unsigned char level);
+  void SetCompression(link_t *link, unsigned char enable);
+  void SetBroadcast(link_t *link, unsigned char enable);
+  const color_t *PaletteColor(int index);
+#ifdef EMULATE
+  void AllocatePacket(packet_t *packet, const topology_t *topology);
+#endif
 
 #endif	/* DISPLAY_H */
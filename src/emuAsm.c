@@ -0,0 +1,554 @@
+// File: emuAsm.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Pattern assembler.  Reads a pattern program written in the VM's assembly
+// language and turns it into bytecode (see vm.h), for the emulator to run
+// (--vm) or to write out as a C table for the PIC (--assemble).  The six
+// patterns in pattern.c are in the vm directory, written this way.
+//
+// A line holds an instruction, a label, or both, and anything after a ';' is
+// a comment:
+//
+//   ; Fill the arm with color r4.
+//         arm     r1              ; r1 - pixels in an arm.
+//         movi    r2, 0
+//   next: pixel   r2, r4
+//         addi    r2, 1
+//         jlt     r2, r1, next
+//         holdi   1000            ; 100 ms.
+//
+// The mnemonics are the opcode names in vm.h, in lower case without the VM_,
+// and the operands go in the same order.  Registers are r0 to r15.  Values
+// can be numbers (decimal, or hex with 0x), the names of the pattern enums
+// (MAP_MIRROR, SHIFT_NEGATIVE, MODE_MODULAR, RED, CMODE_TERTIARY_W and so on),
+// or names given values with ".equ NAME, value".  Jumps go to labels, which
+// may come before or after.  Every error found is reported, with its line.
+
+#ifdef EMULATE
+
+// Includes
+#include "emuAsm.h"
+#include "vm.h"
+#include "patternSupport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Defines
+#define LINE_LENGTH 256
+#define NAME_LENGTH 32
+#define OPERANDS_MAX 3
+#define PROGRAM_MAX 0xFFFF
+
+// Types
+// Operands an instruction takes: registers (a, b, c), values (a byte or 16
+// bits) and jump addresses, in the order they're written.
+typedef enum {
+  FORM_NONE, FORM_A, FORM_AB, FORM_ABC, FORM_A_IMM, FORM_IMM, FORM_ADDR,
+  FORM_A_ADDR, FORM_AB_ADDR, FORM_BYTE, FORM_AB_BYTE
+} form_e;
+
+typedef struct {
+  const char *mnemonic;
+  unsigned char opcode;
+  form_e form;
+  unsigned char color;   // Operand (from 1) that's a color, if any.
+} instruction_t;
+
+typedef struct {
+  char name[NAME_LENGTH];
+  long int value;
+} symbol_t;
+
+// A jump to a label, filled in once all the labels are known.
+typedef struct {
+  char name[NAME_LENGTH];
+  unsigned int at;
+  int line;
+} fixup_t;
+
+// Globals
+static const instruction_t instructions[] = {
+  { "end", VM_END, FORM_NONE, 0 },
+  { "hold", VM_HOLD, FORM_A, 0 },
+  { "holdi", VM_HOLDI, FORM_IMM, 0 },
+  { "movi", VM_MOVI, FORM_A_IMM, 0 },
+  { "mov", VM_MOV, FORM_AB, 0 },
+  { "add", VM_ADD, FORM_AB, 0 },
+  { "addi", VM_ADDI, FORM_A_IMM, 0 },
+  { "sub", VM_SUB, FORM_AB, 0 },
+  { "mul", VM_MUL, FORM_AB, 0 },
+  { "mod", VM_MOD, FORM_AB, 0 },
+  { "neg", VM_NEG, FORM_A, 0 },
+  { "rand", VM_RAND, FORM_AB, 0 },
+  { "jmp", VM_JMP, FORM_ADDR, 0 },
+  { "jz", VM_JZ, FORM_A_ADDR, 0 },
+  { "jnz", VM_JNZ, FORM_A_ADDR, 0 },
+  { "jlt", VM_JLT, FORM_AB_ADDR, 0 },
+  { "jinit", VM_JINIT, FORM_ADDR, 0 },
+  { "map", VM_MAP, FORM_BYTE, 0 },
+  { "size", VM_SIZE, FORM_A, 0 },
+  { "arm", VM_ARM, FORM_A, 0 },
+  { "get", VM_GET, FORM_ABC, 0 },
+  { "put", VM_PUT, FORM_ABC, 0 },
+  { "pixel", VM_PIXEL, FORM_AB, 2 },
+  { "fade", VM_FADE, FORM_AB_BYTE, 0 },
+  { "shift", VM_SHIFT, FORM_A, 0 },
+  { "fill", VM_FILL, FORM_A, 1 },
+  { "color", VM_COLOR, FORM_AB, 1 },
+  { "hsv", VM_HSV, FORM_AB, 1 }
+};
+#define INSTRUCTION_COUNT ((int) (sizeof(instructions) / sizeof(instruction_t)))
+
+// Values every program knows.
+static const symbol_t builtins[] = {
+  { "MAP_MIRROR", MAP_MIRROR }, { "MAP_FULL", MAP_FULL },
+  { "SHIFT_POSITIVE", SHIFT_POSITIVE }, { "SHIFT_NEGATIVE", SHIFT_NEGATIVE },
+  { "MODE_MODULAR", MODE_MODULAR }, { "MODE_CONSTRAINED", MODE_CONSTRAINED },
+  { "RED", RED }, { "GREEN", GREEN }, { "BLUE", BLUE },
+  { "CMODE_PRIMARY", CMODE_PRIMARY }, { "CMODE_PRIMARY_W", CMODE_PRIMARY_W },
+  { "CMODE_SECONDARY", CMODE_SECONDARY }, { "CMODE_SECONDARY_W", CMODE_SECONDARY_W },
+  { "CMODE_TERTIARY", CMODE_TERTIARY }, { "CMODE_TERTIARY_W", CMODE_TERTIARY_W },
+  { "CMODE_GREY", CMODE_GREY }, { "CMODE_GREY_B", CMODE_GREY_B },
+  { "CMODE_ANY_GREY", CMODE_ANY_GREY }, { "CMODE_ANY", CMODE_ANY },
+  { "CMODE_COUNT", CMODE_COUNT }
+};
+#define BUILTIN_COUNT ((int) (sizeof(builtins) / sizeof(symbol_t)))
+
+// The program being assembled.
+static const char *asmPath;
+static int asmLine, asmErrors;
+static unsigned char *code;
+static unsigned int codeBytes, codeSize;
+static symbol_t *labels, *equates;
+static int labelCount, equateCount;
+static fixup_t *fixups;
+static int fixupCount;
+
+// Prototypes
+static void Assemble(char *text);
+static int Register(const char *text, unsigned char color);
+static int Value(const char *text, long int low, long int high, long int *value);
+static void Address(const char *text);
+static void Emit(unsigned char byte);
+static int AddSymbol(symbol_t **symbols, int *count, const char *name, long int value);
+static const symbol_t *FindSymbol(const symbol_t *symbols, int count, const char *name);
+static char *Trim(char *text);
+static void Error(const char *message, const char *text);
+
+
+// Assemble the program in path.  The bytecode goes in *program (to be freed),
+// and its length in *length.  Returns 0 if successful.
+int EmuAsmLoad(const char *path, unsigned char **program, unsigned int *length) {
+  FILE *file;
+  char line[LINE_LENGTH];
+  const symbol_t *label;
+  int i;
+
+  file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to open pattern program \"%s\"!\n", path);
+    return -1;
+  }
+
+  asmPath = path;
+  asmLine = 0;
+  asmErrors = 0;
+  code = NULL;
+  codeBytes = codeSize = 0;
+  labels = equates = NULL;
+  labelCount = equateCount = 0;
+  fixups = NULL;
+  fixupCount = 0;
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    asmLine++;
+    Assemble(line);
+  }
+  fclose(file);
+
+  // Now the labels are all known, fill in the jumps.
+  for (i = 0; i < fixupCount; i++) {
+    label = FindSymbol(labels, labelCount, fixups[i].name);
+    if (label == NULL) {
+      asmLine = fixups[i].line;
+      Error("No such label", fixups[i].name);
+    } else {
+      code[fixups[i].at] = label->value & 0xFF;
+      code[fixups[i].at + 1] = (label->value >> 8) & 0xFF;
+    }
+  }
+  if (codeBytes == 0) {
+    asmLine = 0;
+    Error("The program is empty", "");
+  }
+
+  // An end on the end, so a program that runs off its last instruction, or
+  // jumps to a label after it, stops there rather than running on into
+  // whatever follows it in memory.
+  Emit(VM_END);
+
+  free(labels);
+  free(equates);
+  free(fixups);
+  if (asmErrors > 0) {
+    free(code);
+    return -1;
+  }
+  *program = code;
+  *length = codeBytes;
+  return 0;
+}
+
+
+// Write length bytes of program, assembled from source, out as C to path.
+// The pattern function is named after the source file.  Returns 0 if
+// successful.
+int EmuAsmWriteC(const char *path, const char *source,
+                 const unsigned char *program, unsigned int length) {
+  FILE *file;
+  char name[NAME_LENGTH];
+  const char *base = strrchr(source, '/') ? strrchr(source, '/') + 1 : source;
+  unsigned int i;
+  int result = 0;
+
+  // The name, up to the extension.
+  for (i = 0; (i < sizeof(name) - 1) && (base[i] != '\0') && (base[i] != '.'); i++) {
+    name[i] = isalnum((unsigned char) base[i]) ? base[i] : '_';
+  }
+  name[i] = '\0';
+  name[0] = toupper((unsigned char) name[0]);
+
+  file = fopen(path, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to write \"%s\"!\n", path);
+    return -1;
+  }
+  fprintf(file, "// File: %s\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+  fprintf(file, "// Assembled by the galaxy emulator (--assemble) from %s.  Don't edit.\n", base);
+  fprintf(file, "// To play it, declare Vm%s() in pattern.h, add it to patternList:\n", name);
+  fprintf(file, "//   { Vm%s, 600, \"Vm%s\", sizeof(vmState_t) },\n", name, name);
+  fprintf(file, "// count it in PATTERN_COUNT and VM_PATTERNS there (the latter sets aside\n");
+  fprintf(file, "// its registers), and give it a playlist entry.\n\n");
+  fprintf(file, "// Includes\n#include \"vm.h\"\n\n");
+  fprintf(file, "static const unsigned char vm%sProgram[] = {", name);
+  for (i = 0; i < length; i++) {
+    fprintf(file, "%s0x%02x%s", (i % 16) ? " " : "\n  ", program[i],
+            (i + 1 < length) ? "," : "");
+  }
+  fprintf(file, "\n};\n\n");
+  fprintf(file, "long int Vm%s(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {\n",
+          name);
+  fprintf(file, "  return VmRun(galaxy, state, vm%sProgram, initial, map);\n}\n", name);
+  if (fclose(file) != 0) {
+    result = -1;
+  }
+  if (result == 0) {
+    printf("Assembled %s to %s: Vm%s(), %u bytes.\n", source, path, name, length);
+  } else {
+    fprintf(stderr, "Unable to finish \"%s\"!\n", path);
+  }
+  return result;
+}
+
+
+// Assemble a line of text.
+static void Assemble(char *text) {
+  char *colon, *mnemonic, *rest, *operand[OPERANDS_MAX];
+  const instruction_t *instruction = NULL;
+  int i, count = 0, a, b, c, wanted;
+  long int value;
+
+  // Comments.
+  if (strchr(text, ';') != NULL) {
+    *strchr(text, ';') = '\0';
+  }
+  text = Trim(text);
+
+  // A label.
+  colon = strchr(text, ':');
+  if (colon != NULL) {
+    *colon = '\0';
+    if (AddSymbol(&labels, &labelCount, Trim(text), codeBytes) != 0) {
+      return;
+    }
+    text = Trim(colon + 1);
+  }
+  if (*text == '\0') {
+    return;
+  }
+
+  // The mnemonic, and the operands, separated by commas.
+  mnemonic = text;
+  rest = text;
+  while ((*rest != '\0') && !isspace((unsigned char) *rest)) {
+    rest++;
+  }
+  if (*rest != '\0') {
+    *rest++ = '\0';
+    rest = Trim(rest);
+    while (*rest != '\0') {
+      if (count == OPERANDS_MAX) {
+        Error("Too many operands", mnemonic);
+        return;
+      }
+      operand[count++] = rest;
+      rest = strchr(rest, ',');
+      if (rest == NULL) {
+        break;
+      }
+      *rest++ = '\0';
+    }
+    for (i = 0; i < count; i++) {
+      operand[i] = Trim(operand[i]);
+    }
+  }
+
+  // Constants.
+  if (strcmp(mnemonic, ".equ") == 0) {
+    if (count != 2) {
+      Error("Should be .equ NAME, value", "");
+    } else if (Value(operand[1], -32768L, 65535L, &value) == 0) {
+      AddSymbol(&equates, &equateCount, operand[0], value);
+    }
+    return;
+  }
+
+  for (i = 0; i < INSTRUCTION_COUNT; i++) {
+    if (strcmp(mnemonic, instructions[i].mnemonic) == 0) {
+      instruction = &instructions[i];
+      break;
+    }
+  }
+  if (instruction == NULL) {
+    Error("Unknown instruction", mnemonic);
+    return;
+  }
+  switch (instruction->form) {
+    case FORM_NONE: wanted = 0; break;
+    case FORM_A: case FORM_IMM: case FORM_ADDR: case FORM_BYTE: wanted = 1; break;
+    case FORM_AB: case FORM_A_IMM: case FORM_A_ADDR: wanted = 2; break;
+    default: wanted = 3; break;
+  }
+  if (count != wanted) {
+    Error("Wrong number of operands for", mnemonic);
+    return;
+  }
+
+  Emit(instruction->opcode);
+  switch (instruction->form) {
+    case FORM_NONE:
+      break;
+    case FORM_A:
+      Emit(Register(operand[0], instruction->color == 1));
+      break;
+    case FORM_AB:
+      a = Register(operand[0], instruction->color == 1);
+      b = Register(operand[1], instruction->color == 2);
+      Emit((a << 4) | b);
+      break;
+    case FORM_ABC:
+      a = Register(operand[0], FALSE);
+      b = Register(operand[1], FALSE);
+      c = Register(operand[2], FALSE);
+      Emit((a << 4) | b);
+      Emit(c);
+      break;
+    case FORM_A_IMM:
+      Emit(Register(operand[0], FALSE));
+      value = 0;
+      Value(operand[1], -32768L, 65535L, &value);
+      Emit(value & 0xFF);
+      Emit((value >> 8) & 0xFF);
+      break;
+    case FORM_IMM:
+      value = 0;
+      Value(operand[0], -32768L, 65535L, &value);
+      Emit(value & 0xFF);
+      Emit((value >> 8) & 0xFF);
+      break;
+    case FORM_ADDR:
+      Address(operand[0]);
+      break;
+    case FORM_A_ADDR:
+      Emit(Register(operand[0], FALSE));
+      Address(operand[1]);
+      break;
+    case FORM_AB_ADDR:
+      a = Register(operand[0], FALSE);
+      b = Register(operand[1], FALSE);
+      Emit((a << 4) | b);
+      Address(operand[2]);
+      break;
+    case FORM_BYTE:
+      value = 0;
+      Value(operand[0], 0, 255, &value);
+      Emit(value);
+      break;
+    case FORM_AB_BYTE:
+      a = Register(operand[0], FALSE);
+      b = Register(operand[1], FALSE);
+      Emit((a << 4) | b);
+      value = 0;
+      Value(operand[2], 0, 255, &value);
+      Emit(value);
+      break;
+  }
+}
+
+
+// The number of the register named by text (0 if it isn't one).  A color
+// takes 3 registers, so it can't start past r13.
+static int Register(const char *text, unsigned char color) {
+  char *end;
+  long int n;
+
+  if ((text[0] == 'r') && isdigit((unsigned char) text[1])) {
+    n = strtol(text + 1, &end, 10);
+    if ((*end == '\0') && (n < VM_REGISTERS - (color ? 2 : 0))) {
+      return n;
+    }
+  }
+  Error(color ? "Not a color register (r0 to r13)" : "Not a register", text);
+  return 0;
+}
+
+
+// Put the value of text, a number or a name, from low to high, in *value.
+// Returns 0 if successful.
+static int Value(const char *text, long int low, long int high, long int *value) {
+  const symbol_t *symbol;
+  char *end;
+
+  symbol = FindSymbol(equates, equateCount, text);
+  if (symbol == NULL) {
+    symbol = FindSymbol(builtins, BUILTIN_COUNT, text);
+  }
+  if (symbol != NULL) {
+    *value = symbol->value;
+  } else {
+    *value = strtol(text, &end, 0);
+    if ((*text == '\0') || (*end != '\0')) {
+      Error("Not a value", text);
+      return -1;
+    }
+  }
+  if ((*value < low) || (*value > high)) {
+    Error("Out of range", text);
+    return -1;
+  }
+  return 0;
+}
+
+
+// Leave room for the address of a label, to fill in later.
+static void Address(const char *text) {
+  fixup_t *more;
+
+  more = realloc(fixups, (fixupCount + 1) * sizeof(fixup_t));
+  if (more == NULL) {
+    fprintf(stderr, "Unable to allocate the jumps!\n");
+    exit(EXIT_FAILURE);
+  }
+  fixups = more;
+  snprintf(fixups[fixupCount].name, NAME_LENGTH, "%s", text);
+  fixups[fixupCount].at = codeBytes;
+  fixups[fixupCount].line = asmLine;
+  fixupCount++;
+  Emit(0);
+  Emit(0);
+}
+
+
+// Add a byte to the program.
+static void Emit(unsigned char byte) {
+  if (codeBytes == PROGRAM_MAX) {
+    if (asmErrors == 0) {
+      Error("The program is too long", "");
+    }
+    return;
+  }
+  if (codeBytes == codeSize) {
+    codeSize = codeSize ? codeSize * 2 : 256;
+    code = realloc(code, codeSize);
+    if (code == NULL) {
+      fprintf(stderr, "Unable to allocate the program!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  code[codeBytes++] = byte;
+}
+
+
+// Give name a value.  Returns 0 if successful.
+static int AddSymbol(symbol_t **symbols, int *count, const char *name, long int value) {
+  symbol_t *more;
+  int i;
+
+  if ((name[0] == '\0') || (strlen(name) >= NAME_LENGTH) ||
+      !(isalpha((unsigned char) name[0]) || (name[0] == '_'))) {
+    Error("Not a usable name", name);
+    return -1;
+  }
+  for (i = 1; name[i] != '\0'; i++) {
+    if (!isalnum((unsigned char) name[i]) && (name[i] != '_')) {
+      Error("Not a usable name", name);
+      return -1;
+    }
+  }
+  if (FindSymbol(*symbols, *count, name) != NULL) {
+    Error("Already defined", name);
+    return -1;
+  }
+
+  more = realloc(*symbols, (*count + 1) * sizeof(symbol_t));
+  if (more == NULL) {
+    fprintf(stderr, "Unable to allocate the names!\n");
+    exit(EXIT_FAILURE);
+  }
+  *symbols = more;
+  strcpy((*symbols)[*count].name, name);
+  (*symbols)[*count].value = value;
+  (*count)++;
+  return 0;
+}
+
+
+// The symbol called name, or NULL.
+static const symbol_t *FindSymbol(const symbol_t *symbols, int count, const char *name) {
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if (strcmp(symbols[i].name, name) == 0) {
+      return &symbols[i];
+    }
+  }
+  return NULL;
+}
+
+
+// Text without the white space around it.
+static char *Trim(char *text) {
+  char *end;
+
+  while (isspace((unsigned char) *text)) {
+    text++;
+  }
+  end = text + strlen(text);
+  while ((end > text) && isspace((unsigned char) end[-1])) {
+    *--end = '\0';
+  }
+  return text;
+}
+
+
+// Report an error on the current line.
+static void Error(const char *message, const char *text) {
+  fprintf(stderr, "%s:%i: %s%s%s\n", asmPath, asmLine, message,
+          (*text != '\0') ? ": " : "", text);
+  asmErrors++;
+}
+
+#endif /* EMULATE */
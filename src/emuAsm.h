@@ -0,0 +1,16 @@
+// File:   emuAsm.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Pattern assembler for the EMULATE target.  Turns pattern programs into
+// bytecode for the pattern VM (see vm.h).
+
+#ifndef EMUASM_H
+#define	EMUASM_H
+
+  // Prototypes
+  int EmuAsmLoad(const char *path, unsigned char **program, unsigned int *length);
+  int EmuAsmWriteC(const char *path, const char *source,
+                   const unsigned char *program, unsigned int length);
+
+#endif	/* EMUASM_H */
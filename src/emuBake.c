@@ -0,0 +1,425 @@
+// File: emuBake.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Pattern baker.  Takes the frames of pattern runs (see Bake() in emuModes.c),
+// encodes each one as its changes from the one before (see baked.h), and
+// writes the lot out as C: a const table and a pattern function for each run
+// in NAME.c, and their declarations in NAME.h.  Built into the PIC's code, the
+// tables go in flash.  Built into the emulator, they play the same way.
+//
+// The encoding is greedy.  Unchanged bytes are skipped, or the rest of the
+// frame ended.  Otherwise whichever of a copy (2 bytes or more), an add or a
+// run (3 or more) covers the most is used, and failing those, the bytes are
+// sent literally, up to where one of them would do.  Each frame is encoded
+// forwards and backwards, and the shorter kept.  Every frame is decoded again
+// as it's baked, and checked against the original.
+
+#ifdef EMULATE
+
+// Includes
+#include "emuBake.h"
+#include "baked.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Defines
+#define NAME_LENGTH 64
+
+// Types
+typedef struct {
+  char name[NAME_LENGTH];
+  unsigned int frames;
+} bakedName_t;
+
+// Globals
+static FILE *source = NULL;
+static char headerPath[FILENAME_MAX];
+static unsigned int bakeSeed;
+static bakedName_t *names = NULL;
+static int nameCount = 0;
+static unsigned long int totalRaw, totalBaked;
+
+// The run being baked.
+static char runName[NAME_LENGTH];
+static unsigned char *data = NULL;     // Encoded frames.
+static unsigned long int dataBytes, dataSize;
+static unsigned char *last = NULL;     // Bytes of the frame before.
+static unsigned char *frame = NULL;    // And of this one.
+static unsigned char *now = NULL;      // This one and the one before, in
+static unsigned char *then = NULL;     // the order they're decoded.
+static unsigned int runFrames, runPixels;
+static outputMapping_e runMap;
+static unsigned char runFailed;
+static galaxyData_t check;             // Frames decoded again, for checking.
+static color_t *checkPixels = NULL;
+
+// Prototypes
+static void Encode(const unsigned char *bytes, const unsigned char *before,
+                   unsigned int count, long int hold, unsigned char backward);
+static unsigned int Span(unsigned char kind, unsigned int i, unsigned int count,
+                         unsigned char haveBefore, unsigned int limit);
+static void PutOps(unsigned char kind, unsigned int count,
+                   const unsigned char *bytes, unsigned char value);
+static void Put(unsigned char byte);
+
+
+// Start baking to path, which must end in .c.  The header goes alongside, in
+// .h.  Returns 0 if successful.
+int EmuBakeOpen(const char *path, unsigned int seed) {
+  size_t length = strlen(path);
+
+  if ((length < 3) || (length >= sizeof(headerPath)) ||
+      (strcmp(path + length - 2, ".c") != 0)) {
+    fprintf(stderr, "The bake should go to a .c file, not \"%s\"\n", path);
+    return -1;
+  }
+  strcpy(headerPath, path);
+  headerPath[length - 1] = 'h';
+
+  source = fopen(path, "w");
+  if (source == NULL) {
+    fprintf(stderr, "Unable to bake to \"%s\"!\n", path);
+    return -1;
+  }
+  bakeSeed = seed;
+  totalRaw = 0;
+  totalBaked = 0;
+
+  fprintf(source, "// File: %s\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+  fprintf(source, "// Baked by the galaxy emulator (--bake), seed %u.  Don't edit.\n\n", seed);
+  fprintf(source, "// Includes\n#include \"%s\"\n",
+          strrchr(headerPath, '/') ? strrchr(headerPath, '/') + 1 : headerPath);
+
+  printf("Baking to %s (seed %u):\n", path, seed);
+  printf("  %-16s %6s %10s %10s %8s %10s\n", "Pattern", "Frames", "Raw", "Baked",
+         "Saved", "bytes/frame");
+  return 0;
+}
+
+
+// Start baking a run, of the pattern called name.
+void EmuBakeBegin(const char *name) {
+  snprintf(runName, sizeof(runName), "%s", name);
+  dataBytes = 0;
+  runFrames = 0;
+  runFailed = FALSE;
+}
+
+
+// Bake the next frame of the run: the galaxy's pixels, sent with map, held
+// for hold.  The first frame decides the map, and the rest must keep to it.
+void EmuBakeFrame(galaxyData_t *galaxy, outputMapping_e map, long int hold) {
+  unsigned int i, bytes;
+  unsigned long int start, forward;
+  unsigned char *swap;
+  long int checkHold;
+
+  if ((source == NULL) || runFailed) {
+    return;
+  }
+
+  if (runFrames == 0) {
+    runMap = map;
+    runPixels = (map == MAP_MIRROR) ? ARM_SIZE(galaxy) : galaxy->size;
+    last = realloc(last, galaxy->size * BYTES_PER_PIXEL);
+    frame = realloc(frame, galaxy->size * BYTES_PER_PIXEL);
+    now = realloc(now, galaxy->size * BYTES_PER_PIXEL);
+    then = realloc(then, galaxy->size * BYTES_PER_PIXEL);
+    checkPixels = realloc(checkPixels, galaxy->size * sizeof(color_t));
+    check.pixels = realloc(check.pixels, galaxy->size * sizeof(color_t *));
+    if ((last == NULL) || (frame == NULL) || (now == NULL) || (then == NULL) ||
+        (checkPixels == NULL) || (check.pixels == NULL)) {
+      fprintf(stderr, "Unable to allocate the baking frames!\n");
+      exit(EXIT_FAILURE);
+    }
+    check.size = galaxy->size;
+    check.topology = galaxy->topology;
+    for (i = 0; i < galaxy->size; i++) {
+      check.pixels[i] = &checkPixels[i];
+    }
+  } else if (map != runMap) {
+    fprintf(stderr, "  %s changes its output map, so it can't be baked.\n", runName);
+    runFailed = TRUE;
+    return;
+  }
+
+  // A channel at a time.
+  bytes = runPixels * BYTES_PER_PIXEL;
+  for (i = 0; i < bytes; i++) {
+    frame[i] = galaxy->pixels[i % runPixels]->chan[i / runPixels];
+  }
+
+  // Forwards or backwards, whichever's shorter.
+  start = dataBytes;
+  Encode(frame, (runFrames == 0) ? NULL : last, bytes, hold, FALSE);
+  forward = dataBytes - start;
+  if (runFrames > 0) {
+    Encode(frame, last, bytes, hold, BAKED_BACKWARD);
+    if (dataBytes - start - forward < forward) {
+      memmove(data + start, data + start + forward, dataBytes - start - forward);
+      dataBytes -= forward;
+    } else {
+      dataBytes = start + forward;
+    }
+  }
+
+  // Play it back.
+  BakedDecode(&check, runPixels, data + start, &checkHold);
+  for (i = 0; i < bytes; i++) {
+    if (check.pixels[i % runPixels]->chan[i / runPixels] != frame[i]) {
+      break;
+    }
+  }
+  if ((i < bytes) || (checkHold != hold)) {
+    fprintf(stderr, "  %s frame %u doesn't decode the same!\n", runName, runFrames);
+    runFailed = TRUE;
+    return;
+  }
+
+  swap = last;
+  last = frame;
+  frame = swap;
+  runFrames++;
+}
+
+
+// Write out the run.
+void EmuBakeEnd(void) {
+  unsigned long int i, raw;
+  bakedName_t *more;
+
+  if ((source == NULL) || runFailed || (runFrames == 0)) {
+    return;
+  }
+
+  fprintf(source, "\n\n// %s, %u frames.\n", runName, runFrames);
+  fprintf(source, "static const unsigned char baked%sData[] = {", runName);
+  for (i = 0; i < dataBytes; i++) {
+    fprintf(source, "%s0x%02x%s", (i % 16) ? " " : "\n  ", data[i],
+            (i + 1 < dataBytes) ? "," : "");
+  }
+  fprintf(source, "\n};\n\n");
+  fprintf(source, "const bakedRun_t baked%sRun = {\n  %u, %u, %s, baked%sData\n};\n\n",
+          runName, runFrames, runPixels,
+          (runMap == MAP_MIRROR) ? "MAP_MIRROR" : "MAP_FULL", runName);
+  fprintf(source, "long int Baked%s(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {\n",
+          runName);
+  fprintf(source, "  return BakedPlay(galaxy, state, &baked%sRun, initial, map);\n}\n",
+          runName);
+
+  more = realloc(names, (nameCount + 1) * sizeof(bakedName_t));
+  if (more == NULL) {
+    fprintf(stderr, "Unable to allocate the baked names!\n");
+    exit(EXIT_FAILURE);
+  }
+  names = more;
+  strcpy(names[nameCount].name, runName);
+  names[nameCount].frames = runFrames;
+  nameCount++;
+
+  raw = (unsigned long int) runFrames * runPixels * BYTES_PER_PIXEL;
+  totalRaw += raw;
+  totalBaked += dataBytes;
+  printf("  %-16s %6u %10lu %10lu %7.1f%% %10.1f\n", runName, runFrames, raw,
+         dataBytes, 100.0 * (1.0 - ((double) dataBytes / raw)),
+         (double) dataBytes / runFrames);
+}
+
+
+// Finish the source, and write the header.  Returns 0 if successful.
+int EmuBakeClose(void) {
+  FILE *header;
+  const char *file;
+  int i, result = 0;
+
+  if (source == NULL) {
+    return -1;
+  }
+  if (fclose(source) != 0) {
+    result = -1;
+  }
+  source = NULL;
+
+  header = fopen(headerPath, "w");
+  if (header == NULL) {
+    fprintf(stderr, "Unable to write \"%s\"!\n", headerPath);
+    return -1;
+  }
+  file = strrchr(headerPath, '/') ? strrchr(headerPath, '/') + 1 : headerPath;
+  fprintf(header, "// File:   %s\n", file);
+  fprintf(header, "// Baked by the galaxy emulator (--bake), seed %u.  Don't edit.\n\n", bakeSeed);
+  fprintf(header, "#ifndef BAKED_RUNS_H\n#define\tBAKED_RUNS_H\n\n");
+  fprintf(header, "  #include \"baked.h\"\n\n");
+  fprintf(header, "  // To play a run, add its pattern to patternList in pattern.h, e.g.:\n");
+  if (nameCount > 0) {
+    fprintf(header, "  //   { Baked%s, %u, \"Baked%s\", sizeof(bakedState_t) },\n",
+            names[0].name, names[0].frames, names[0].name);
+  }
+  fprintf(header, "  // count it in PATTERN_COUNT and BAKED_PATTERNS there (the latter sets\n");
+  fprintf(header, "  // aside its state), and give it a playlist entry.\n");
+  for (i = 0; i < nameCount; i++) {
+    fprintf(header, "  extern const bakedRun_t baked%sRun;  // %u frames\n",
+            names[i].name, names[i].frames);
+  }
+  fprintf(header, "\n  // Prototypes\n");
+  for (i = 0; i < nameCount; i++) {
+    fprintf(header, "  long int Baked%s(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);\n",
+            names[i].name);
+  }
+  fprintf(header, "\n#endif\t/* BAKED_RUNS_H */\n");
+  if (fclose(header) != 0) {
+    result = -1;
+  }
+
+  if (totalRaw > 0) {
+    printf("  %-16s %6s %10lu %10lu %7.1f%%\n", "Total", "", totalRaw, totalBaked,
+           100.0 * (1.0 - ((double) totalBaked / totalRaw)));
+  }
+  printf("  Playing a run takes %u bytes of RAM.\n", (unsigned int) sizeof(bakedState_t));
+  if (result != 0) {
+    fprintf(stderr, "Unable to finish the bake!\n");
+  }
+  free(names);
+  names = NULL;
+  nameCount = 0;
+  return result;
+}
+
+
+// Encode a frame of count bytes (a channel at a time), held for hold, against
+// the frame before (or NULL for the first), to be decoded backwards or not.
+static void Encode(const unsigned char *bytes, const unsigned char *before,
+                   unsigned int count, long int hold, unsigned char backward) {
+  unsigned int i, n, best;
+  unsigned char kind;
+  unsigned long int header = ((unsigned long int) hold << 1) | backward;
+
+  // Put the frames in the order they'll be decoded.
+  for (i = 0; i < count; i++) {
+    now[i] = bytes[backward ? count - 1 - i : i];
+    if (before != NULL) {
+      then[i] = before[backward ? count - 1 - i : i];
+    }
+  }
+
+  // The hold.
+  do {
+    Put((unsigned char) ((header & 0x7F) | ((header > 0x7F) ? 0x80 : 0)));
+    header >>= 7;
+  } while (header > 0);
+
+  i = 0;
+  while (i < count) {
+    n = Span(BAKED_SKIP, i, count, before != NULL, count);
+    if (i + n == count) {
+      Put(BAKED_END);
+      return;
+    }
+    if (n > 0) {
+      PutOps(BAKED_SKIP, n, now + i, 0);
+      i += n;
+      continue;
+    }
+
+    // The op that covers the most, if any is worth it.
+    kind = BAKED_LITERAL;
+    best = 0;
+    n = Span(BAKED_COPY, i, count, before != NULL, count);
+    if (n >= 2) {
+      kind = BAKED_COPY;
+      best = n;
+    }
+    n = Span(BAKED_ADD, i, count, before != NULL, count);
+    if ((n >= 3) && (n > best)) {
+      kind = BAKED_ADD;
+      best = n;
+    }
+    n = Span(BAKED_RUN, i, count, before != NULL, count);
+    if ((n >= 3) && (n > best)) {
+      kind = BAKED_RUN;
+      best = n;
+    }
+    if (kind != BAKED_LITERAL) {
+      PutOps(kind, best, now + i, (unsigned char) (now[i] - then[i]));
+      i += best;
+      continue;
+    }
+
+    // Literal, up to where another op would do better.
+    n = 1;
+    while ((i + n < count) && (n < BAKED_COUNT_MAX) &&
+           (Span(BAKED_SKIP, i + n, count, before != NULL, 2) < 2) &&
+           (Span(BAKED_COPY, i + n, count, before != NULL, 2) < 2) &&
+           (Span(BAKED_ADD, i + n, count, before != NULL, 3) < 3) &&
+           (Span(BAKED_RUN, i + n, count, before != NULL, 3) < 3)) {
+      n++;
+    }
+    PutOps(BAKED_LITERAL, n, now + i, 0);
+    i += n;
+  }
+}
+
+
+// How many bytes from i on an op of kind could cover, up to limit.  Only
+// BAKED_RUN works without the frame before.
+static unsigned int Span(unsigned char kind, unsigned int i, unsigned int count,
+                         unsigned char haveBefore, unsigned int limit) {
+  unsigned int n = 0;
+  unsigned char step = (unsigned char) (now[i] - then[i]);
+
+  if (!haveBefore && (kind != BAKED_RUN)) {
+    return 0;
+  }
+  while ((n < limit) && (i + n < count)) {
+    if (((kind == BAKED_SKIP) && (now[i + n] != then[i + n])) ||
+        ((kind == BAKED_COPY) && ((i + n + 1 >= count) || (now[i + n] != then[i + n + 1]))) ||
+        ((kind == BAKED_ADD) && ((step == 0) || ((unsigned char) (now[i + n] - then[i + n]) != step))) ||
+        ((kind == BAKED_RUN) && (now[i + n] != now[i]))) {
+      break;
+    }
+    n++;
+  }
+  return n;
+}
+
+
+// Ops of kind for count bytes, BAKED_COUNT_MAX at a time.  value is the
+// amount for BAKED_ADD.
+static void PutOps(unsigned char kind, unsigned int count,
+                   const unsigned char *bytes, unsigned char value) {
+  unsigned int n, i;
+
+  while (count > 0) {
+    n = (count > BAKED_COUNT_MAX) ? BAKED_COUNT_MAX : count;
+    Put(kind | (n - 1));
+    if (kind == BAKED_RUN) {
+      Put(bytes[0]);
+    } else if (kind == BAKED_ADD) {
+      Put(value);
+    } else if (kind == BAKED_LITERAL) {
+      for (i = 0; i < n; i++) {
+        Put(bytes[i]);
+      }
+    }
+    bytes += n;
+    count -= n;
+  }
+}
+
+
+// Add a byte to the run's data.
+static void Put(unsigned char byte) {
+  if (dataBytes == dataSize) {
+    dataSize = dataSize ? dataSize * 2 : 4096;
+    data = realloc(data, dataSize);
+    if (data == NULL) {
+      fprintf(stderr, "Unable to allocate the baked data!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  data[dataBytes++] = byte;
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,21 @@
+// File:   emuBake.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Pattern baker for the EMULATE target.  Turns pattern runs into baked
+// tables (see baked.h).
+
+#ifndef EMUBAKE_H
+#define	EMUBAKE_H
+
+  #include "galaxyConfig.h"
+  #include "display.h"
+
+  // Prototypes
+  int EmuBakeOpen(const char *path, unsigned int seed);
+  void EmuBakeBegin(const char *name);
+  void EmuBakeFrame(galaxyData_t *galaxy, outputMapping_e map, long int hold);
+  void EmuBakeEnd(void);
+  int EmuBakeClose(void);
+
+#endif	/* EMUBAKE_H */
@@ -0,0 +1,187 @@
+// File: emuClock.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Frame scheduler.  The frame holds (HoldFrame() in master.c) are kept on a
+// running deadline: each delay moves the deadline on by its length, and the
+// emulator sleeps until the deadline with clock_nanosleep(), rather than for
+// the length from whenever it got around to asking.  Time spent
+// computing, drawing and waiting on the serial port comes out of the delay,
+// and oversleeping one delay is made up in the next, so a pattern runs at the
+// rate its delays add up to, without drift.
+//
+// If a frame's work takes longer than its delays, the deadline has already
+// gone by.  That's an overrun.  The deadline is reset to the present, rather
+// than rushing the next few frames to catch up.
+//
+// Statistics kept:
+// - The frame interval, from one call to EmuClockFrame() to the next.
+// - Wake-up lateness (jitter), how long after the deadline the sleep returned.
+// - Overruns.
+// The percentiles come from a fixed size random sample (a reservoir) of each,
+// so a run of any length takes the same memory.  The averages and maximums
+// are of every sample.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuClock.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Defines
+#define RESERVOIR_SIZE 65536  // Samples kept for the percentiles.
+
+// Samples, for percentiles.  Once the reservoir is full, each new sample
+// replaces a random one in it, with odds that leave every sample so far the
+// same chance of being kept.
+typedef struct {
+  double values[RESERVOIR_SIZE];
+  long int count;    // Samples seen.
+  double sum, max;
+} samples_t;
+
+// Globals
+static struct timespec deadline;
+static double lastFrame = -1;
+static unsigned char delayed = FALSE;  // Delays were scheduled this frame.
+static long int overruns = 0;
+static samples_t intervals, lateness;
+static uint64_t reservoirRand = 25;  // Not rand(), the patterns' own.
+
+// Prototypes
+static void AddSample(samples_t *s, double value);
+static double Percentile(samples_t *s, double p);
+static int CompareDoubles(const void *a, const void *b);
+static double TimespecToSeconds(const struct timespec *t);
+static void AddSeconds(struct timespec *t, double s);
+
+
+// Mark the start of a frame.  If the last frame had no delays, the deadline
+// is stale, so the next delay is timed from here.
+void EmuClockFrame(void) {
+  struct timespec now;
+  double nowS;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  nowS = TimespecToSeconds(&now);
+  if (lastFrame >= 0) {
+    AddSample(&intervals, nowS - lastFrame);
+  }
+  lastFrame = nowS;
+
+  if (!delayed) {
+    deadline = now;
+  }
+  delayed = FALSE;
+}
+
+
+// Delay until the deadline, moved on by seconds.
+void EmuClockDelay(double seconds) {
+  struct timespec now;
+  int result;
+
+  if (seconds <= 0) {
+    return;
+  }
+  delayed = TRUE;
+  AddSeconds(&deadline, seconds);
+
+  // Already late?
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (TimespecToSeconds(&now) > TimespecToSeconds(&deadline)) {
+    overruns++;
+    deadline = now;
+    return;
+  }
+
+  do {
+    result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+  } while (result == EINTR);
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  AddSample(&lateness, TimespecToSeconds(&now) - TimespecToSeconds(&deadline));
+}
+
+
+// Print the frame interval, wake-up jitter and overruns.
+void EmuClockPrintStats(void) {
+  if (intervals.count == 0) {
+    return;
+  }
+
+  printf("Frame interval: %li frames, %.2f ms average, %.2f ms median, "
+         "%.2f ms 99th percentile, %.2f ms max\n", intervals.count,
+         1000.0 * intervals.sum / intervals.count, 1000.0 * Percentile(&intervals, 50),
+         1000.0 * Percentile(&intervals, 99), 1000.0 * Percentile(&intervals, 100));
+  if (lateness.count > 0) {
+    printf("  Wake-up jitter: %.3f ms median, %.3f ms 90th, %.3f ms 99th, %.3f ms max\n",
+           1000.0 * Percentile(&lateness, 50), 1000.0 * Percentile(&lateness, 90),
+           1000.0 * Percentile(&lateness, 99), 1000.0 * Percentile(&lateness, 100));
+  }
+  printf("  %li delays, %li overruns (frame work outlasted its delays)\n",
+         lateness.count + overruns, overruns);
+}
+
+
+static void AddSample(samples_t *s, double value) {
+  long int i;
+
+  if (s->count < RESERVOIR_SIZE) {
+    s->values[s->count] = value;
+  } else {
+    reservoirRand = (reservoirRand * 6364136223846793005ULL) + 1442695040888963407ULL;
+    i = (long int) ((reservoirRand >> 33) % (uint64_t) (s->count + 1));
+    if (i < RESERVOIR_SIZE) {
+      s->values[i] = value;
+    }
+  }
+  if ((s->count == 0) || (value > s->max)) {
+    s->max = value;
+  }
+  s->sum += value;
+  s->count++;
+}
+
+
+// The p'th percentile (0 - 100) of a list of samples, from the reservoir (the
+// 100th is the maximum of them all).  Sorts the reservoir.
+static double Percentile(samples_t *s, double p) {
+  long int i, kept;
+
+  if (p >= 100) {
+    return s->max;
+  }
+  kept = (s->count < RESERVOIR_SIZE) ? s->count : RESERVOIR_SIZE;
+  qsort(s->values, kept, sizeof(double), CompareDoubles);
+  i = (long int) ((p / 100.0) * (kept - 1) + 0.5);
+  return s->values[i];
+}
+
+
+static int CompareDoubles(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return (x > y) - (x < y);
+}
+
+
+// Timespec helpers.
+static double TimespecToSeconds(const struct timespec *t) {
+  return t->tv_sec + (t->tv_nsec / 1e9);
+}
+
+static void AddSeconds(struct timespec *t, double s) {
+  long int ns;
+
+  ns = t->tv_nsec + (long int) (s * 1e9);
+  t->tv_sec += ns / 1000000000L;
+  t->tv_nsec = ns % 1000000000L;
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,15 @@
+// File:   emuClock.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Frame scheduler for the EMULATE target.
+
+#ifndef EMUCLOCK_H
+#define	EMUCLOCK_H
+
+  // Prototypes
+  void EmuClockFrame(void);
+  void EmuClockDelay(double seconds);
+  void EmuClockPrintStats(void);
+
+#endif	/* EMUCLOCK_H */
@@ -0,0 +1,63 @@
+// File: emuCommand.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Command queue.  The display thread turns key presses into commands and posts
+// them here, and the pattern thread takes them at the top of each frame, so the
+// pattern loop never has to go near SDL's event handling.
+//
+// It's a ring buffer with one producer and one consumer, so it needs no locks.
+// Only the display thread moves the head, and only the pattern thread moves
+// the tail.  Each publishes its index with a release store after touching the
+// slot, and reads the other's with an acquire load before, so a command is
+// always written before it can be seen.  Posting and taking are O(1).  Another
+// control source (a socket, say) would need a queue of its own.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuCommand.h"
+#include <stdatomic.h>
+
+// Defines
+#define QUEUE_SIZE 64  // Must be a power of 2.
+
+// Globals
+static command_t queue[QUEUE_SIZE];
+static atomic_uint head = 0;  // Next slot to post to.  Display thread only.
+static atomic_uint tail = 0;  // Next slot to take from.  Pattern thread only.
+
+
+// Post a command.  Returns FALSE if the queue is full.  Display thread only.
+int EmuCommandPost(command_e command, int value) {
+  unsigned int h, t;
+
+  h = atomic_load_explicit(&head, memory_order_relaxed);
+  t = atomic_load_explicit(&tail, memory_order_acquire);
+  if ((h - t) == QUEUE_SIZE) {
+    return FALSE;
+  }
+  queue[h & (QUEUE_SIZE - 1)].command = command;
+  queue[h & (QUEUE_SIZE - 1)].value = value;
+  atomic_store_explicit(&head, h + 1, memory_order_release);
+  return TRUE;
+}
+
+
+// Take the oldest command.  Returns FALSE if there aren't any.  Pattern thread
+// only.
+int EmuCommandTake(command_t *command) {
+  unsigned int h, t;
+
+  t = atomic_load_explicit(&tail, memory_order_relaxed);
+  h = atomic_load_explicit(&head, memory_order_acquire);
+  if (h == t) {
+    return FALSE;
+  }
+  *command = queue[t & (QUEUE_SIZE - 1)];
+  atomic_store_explicit(&tail, t + 1, memory_order_release);
+  return TRUE;
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,25 @@
+// File:   emuCommand.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Command queue from the display thread to the pattern thread for the EMULATE
+// target.
+
+#ifndef EMUCOMMAND_H
+#define	EMUCOMMAND_H
+
+  // Commands for the pattern thread.  DOSPEED's value is the new delay
+  // multiplier (10 is real time), and DOBRIGHTNESS's the new global brightness.
+  typedef enum {
+    DOEXIT, DONOTHING, DONEXTPATTERN, DOPAUSE, DOSPEED, DOBRIGHTNESS
+  } command_e;
+  typedef struct {
+    command_e command;
+    int value;
+  } command_t;
+
+  // Prototypes
+  int EmuCommandPost(command_e command, int value);
+  int EmuCommandTake(command_t *command);
+
+#endif	/* EMUCOMMAND_H */
@@ -0,0 +1,356 @@
+// File: emuFleet.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Fleet runner.  Runs the frames of many galaxies at once on a pool of worker
+// threads, each galaxy to its own schedule, and reports how well the host kept
+// up, for sizing the machine that drives a field of sculptures.
+//
+// A galaxy's frames are released one at a time.  A frame is released when the
+// one before it goes up on the lights, and is due when that one's time is up,
+// so it gets worked on while the last one is showing, like on the master.  A
+// frame finished after it was due is a missed deadline.  It goes up late, and
+// the galaxy's schedule slips rather than rushing to catch up.  Unpaced, each
+// frame is released as soon as the last one is done, which shows how many
+// frames per second the host can turn out.
+//
+// Scheduling is work stealing.  Each worker keeps the galaxies it last ran in
+// a heap by release time, and moves them onto its deque as they come due, so
+// the deque runs in release order, and the top is the galaxy that's been
+// waiting longest, with the earliest deadline.  It runs frames off the top of
+// its own deque, and when that's empty, steals from the top of the others'.
+// A stolen galaxy stays with the thief.  So a
+// worker that falls behind sheds its backlog to the idle ones, and while the
+// load is even, each galaxy's state stays in the one cache.
+//
+// Busy time is time spent in frames.  With a worker per core, busy over wall
+// time is each core's utilization.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuFleet.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Defines
+#define IDLE_SLEEP 0.0002  // Longest an idle worker sleeps before looking again (s).
+
+// Types
+typedef struct {
+  double release;       // When the next frame may start (s).
+  double due;           // When the next frame should go up (s).
+  long int frames;
+  long int missed;
+  double worstLate;     // (s)
+} fleetTask_t;
+
+typedef struct {
+  pthread_t thread;
+  int index;
+  pthread_mutex_t lock;  // Guards the deque, which others steal from.
+  int *deque;            // Ring of fleetSize entries.
+  long int top, bottom;  // Taken from the top, added at the bottom.
+  int *heap;             // Owner only.  Galaxies waiting for release.
+  int heapSize;
+  long int frames, steals;
+  double busy;           // (s)
+} fleetWorker_t;
+
+// Globals
+static fleetTask_t *galaxies;
+static fleetWorker_t *workers;
+static int fleetSize, workerCount;
+static double runSeconds;
+static long int runFrames;
+static unsigned char runPaced;
+static emuFleetFrame_f runFrame;
+static struct timespec runStart;
+static atomic_int galaxiesDone;
+
+// Prototypes
+void *FleetWorker(void *arg);
+static double Now(void);
+static void Push(fleetWorker_t *w, int g);
+static int Pop(fleetWorker_t *w);
+static int Steal(fleetWorker_t *w);
+static void HeapPush(fleetWorker_t *w, int g);
+static int HeapPop(fleetWorker_t *w);
+
+
+// Run galaxyCount galaxies on threadCount workers (one per core if 0 or
+// less), for the given seconds of wall time or frames per galaxy, whichever
+// comes first (less than 0 for no limit).  Returns 0 if the fleet ran.
+int EmuFleetRun(int galaxyCount, int threadCount, double seconds,
+                long int frames, unsigned char paced, emuFleetFrame_f frame) {
+  int i, started;
+  long int totalFrames = 0, missed = 0, counted = 0;
+  double wall, worstLate = 0, busy = 0;
+
+  fleetSize = galaxyCount;
+  workerCount = threadCount;
+  if (workerCount <= 0) {
+    workerCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (workerCount <= 0) {
+    workerCount = 1;
+  }
+  runSeconds = seconds;
+  runFrames = frames;
+  runPaced = paced;
+  runFrame = frame;
+  atomic_store(&galaxiesDone, 0);
+
+  galaxies = calloc(fleetSize, sizeof(fleetTask_t));
+  workers = calloc(workerCount, sizeof(fleetWorker_t));
+  if ((fleetSize < 1) || (galaxies == NULL) || (workers == NULL)) {
+    fprintf(stderr, "Unable to set up a fleet of %i galaxies!\n", fleetSize);
+    return -1;
+  }
+  for (i = 0; i < workerCount; i++) {
+    workers[i].index = i;
+    workers[i].deque = malloc(fleetSize * sizeof(int));
+    workers[i].heap = malloc(fleetSize * sizeof(int));
+    if ((workers[i].deque == NULL) || (workers[i].heap == NULL)) {
+      fprintf(stderr, "Unable to set up a fleet of %i galaxies!\n", fleetSize);
+      return -1;
+    }
+    pthread_mutex_init(&workers[i].lock, NULL);
+  }
+
+  // Deal the galaxies out.  Everyone's first frame is released at the start.
+  for (i = 0; i < fleetSize; i++) {
+    HeapPush(&workers[i % workerCount], i);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &runStart);
+  for (started = 0; started < workerCount; started++) {
+    if (pthread_create(&workers[started].thread, NULL, FleetWorker,
+                       &workers[started]) != 0) {
+      fprintf(stderr, "Unable to start fleet worker %i!\n", started);
+      break;
+    }
+  }
+  for (i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  wall = Now();
+  if (started == 0) {
+    return -1;
+  }
+
+  for (i = 0; i < fleetSize; i++) {
+    totalFrames += galaxies[i].frames;
+    missed += galaxies[i].missed;
+    if (galaxies[i].frames > 1) {
+      counted += galaxies[i].frames - 1;
+    }
+    if (galaxies[i].worstLate > worstLate) {
+      worstLate = galaxies[i].worstLate;
+    }
+  }
+
+  printf("Fleet run: %i galaxies on %i threads, %.2f s, %s\n", fleetSize,
+         started, wall, runPaced ? "paced" : "unpaced");
+  printf("  %li frames, %.1f frames/s\n", totalFrames, totalFrames / wall);
+  if (runPaced) {
+    printf("  Missed deadlines: %li of %li (%.2f%%), worst %.2f ms late\n",
+           missed, counted, counted ? (100.0 * missed / counted) : 0.0,
+           worstLate * 1000);
+  }
+  printf("  %-6s %10s %10s %8s\n", "Thread", "Frames", "Steals", "Busy");
+  for (i = 0; i < started; i++) {
+    printf("  %-6i %10li %10li %7.1f%%\n", i, workers[i].frames,
+           workers[i].steals, 100.0 * workers[i].busy / wall);
+    busy += workers[i].busy;
+  }
+  printf("  %-6s %10li %10s %7.1f%%\n", "All", totalFrames, "",
+         100.0 * busy / (wall * started));
+
+  for (i = 0; i < workerCount; i++) {
+    pthread_mutex_destroy(&workers[i].lock);
+    free(workers[i].deque);
+    free(workers[i].heap);
+  }
+  free(workers);
+  free(galaxies);
+  return 0;
+}
+
+
+// A worker.  Runs released frames, its own or stolen, until the time is up or
+// every galaxy has run its frames.
+void *FleetWorker(void *arg) {
+  fleetWorker_t *w = arg;
+  fleetTask_t *g;
+  int index;
+  double now, start, end, length, wake;
+  struct timespec ts;
+
+  FOREVER {
+    now = Now();
+    if (((runSeconds >= 0) && (now >= runSeconds)) ||
+        (atomic_load(&galaxiesDone) >= fleetSize)) {
+      break;
+    }
+
+    // Put whatever's been released up for grabs.
+    while ((w->heapSize > 0) && (galaxies[w->heap[0]].release <= now)) {
+      Push(w, HeapPop(w));
+    }
+
+    index = Pop(w);
+    if (index < 0) {
+      index = Steal(w);
+    }
+
+    // Nothing to do.  Sleep until the next release, but not so long that
+    // someone else's backlog has to wait.
+    if (index < 0) {
+      wake = now + IDLE_SLEEP;
+      if ((w->heapSize > 0) && (galaxies[w->heap[0]].release < wake)) {
+        wake = galaxies[w->heap[0]].release;
+      }
+      wake += runStart.tv_sec + (runStart.tv_nsec / 1e9);
+      ts.tv_sec = (time_t) wake;
+      ts.tv_nsec = (long int) ((wake - ts.tv_sec) * 1e9);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+      continue;
+    }
+
+    g = &galaxies[index];
+    start = Now();
+    length = runFrame(index);
+    end = Now();
+    w->busy += end - start;
+    w->frames++;
+
+    // The first frame has nothing showing before it, so no deadline.
+    if (runPaced) {
+      if ((g->frames > 0) && (end > g->due)) {
+        g->missed++;
+        if (end - g->due > g->worstLate) {
+          g->worstLate = end - g->due;
+        }
+        g->due = end;
+      } else if (g->frames == 0) {
+        g->due = end;
+      }
+      g->release = g->due;
+      g->due += length;
+    }
+    g->frames++;
+
+    if ((runFrames >= 0) && (g->frames >= runFrames)) {
+      atomic_fetch_add(&galaxiesDone, 1);
+    } else {
+      HeapPush(w, index);
+    }
+  }
+  return NULL;
+}
+
+
+// Seconds since the run started.
+static double Now(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - runStart.tv_sec) + ((now.tv_nsec - runStart.tv_nsec) / 1e9);
+}
+
+
+// Add a released galaxy to the bottom of a worker's deque.
+static void Push(fleetWorker_t *w, int g) {
+  pthread_mutex_lock(&w->lock);
+  w->deque[w->bottom % fleetSize] = g;
+  w->bottom++;
+  pthread_mutex_unlock(&w->lock);
+}
+
+
+// Take the oldest released galaxy off the top of a worker's own deque.
+static int Pop(fleetWorker_t *w) {
+  int g = -1;
+
+  pthread_mutex_lock(&w->lock);
+  if (w->bottom > w->top) {
+    g = w->deque[w->top % fleetSize];
+    w->top++;
+  }
+  pthread_mutex_unlock(&w->lock);
+  return g;
+}
+
+
+// Take the oldest released galaxy from the first other worker that has one.
+static int Steal(fleetWorker_t *w) {
+  int i, g = -1;
+  fleetWorker_t *victim;
+
+  for (i = 1; (i < workerCount) && (g < 0); i++) {
+    victim = &workers[(w->index + i) % workerCount];
+    pthread_mutex_lock(&victim->lock);
+    if (victim->bottom > victim->top) {
+      g = victim->deque[victim->top % fleetSize];
+      victim->top++;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  if (g >= 0) {
+    w->steals++;
+  }
+  return g;
+}
+
+
+// Min heap of galaxies by release time.
+static void HeapPush(fleetWorker_t *w, int g) {
+  int i, parent;
+
+  i = w->heapSize++;
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (galaxies[w->heap[parent]].release <= galaxies[g].release) {
+      break;
+    }
+    w->heap[i] = w->heap[parent];
+    i = parent;
+  }
+  w->heap[i] = g;
+}
+
+
+static int HeapPop(fleetWorker_t *w) {
+  int i, child, top, last;
+
+  top = w->heap[0];
+  last = w->heap[--w->heapSize];
+  i = 0;
+  FOREVER {
+    child = (2 * i) + 1;
+    if (child >= w->heapSize) {
+      break;
+    }
+    if ((child + 1 < w->heapSize) &&
+        (galaxies[w->heap[child + 1]].release < galaxies[w->heap[child]].release)) {
+      child++;
+    }
+    if (galaxies[last].release <= galaxies[w->heap[child]].release) {
+      break;
+    }
+    w->heap[i] = w->heap[child];
+    i = child;
+  }
+  if (w->heapSize > 0) {
+    w->heap[i] = last;
+  }
+  return top;
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,19 @@
+// File:   emuFleet.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Multi-galaxy fleet runner for the EMULATE target.
+
+#ifndef EMUFLEET_H
+#define	EMUFLEET_H
+
+  // Runs one frame of a fleet galaxy, and returns how long the frame lasts on
+  // the lights (s).  Called from the worker threads, never for the same
+  // galaxy from two at once.
+  typedef double (*emuFleetFrame_f)(int galaxy);
+
+  // Prototypes
+  int EmuFleetRun(int galaxyCount, int threadCount, double seconds,
+                  long int frames, unsigned char paced, emuFleetFrame_f frame);
+
+#endif	/* EMUFLEET_H */
@@ -0,0 +1,93 @@
+// File: emuFrames.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Triple buffer between the pattern thread, which makes the frames, and the
+// display thread, which draws them.  Neither one ever waits on the other.
+//
+// There are three frame buffers.  The pattern thread owns the back one and
+// fills it in.  The display thread owns the front one and draws from it.  The
+// middle one belongs to whoever swaps with it next.  Publishing a frame swaps
+// back and middle, and marks the middle fresh.  If the middle is fresh, the
+// display thread swaps it with the front before drawing.  The swaps are single
+// atomic exchanges, so there are no locks, and the display always gets the
+// newest whole frame.  If the display falls behind, older frames are written
+// over unseen (dropped), and the pattern thread carries on at its own pace.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuFrames.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Defines
+#define FRESH 0x04  // Set on the middle index when it holds an unseen frame.
+
+// Globals
+static color_t *buffers[3] = {NULL, NULL, NULL};
+static int back = 0;                 // Pattern thread only.
+static int front = 1;                // Display thread only.
+static atomic_int middle = 2;
+static long int published = 0;      // Pattern thread only.
+static long int dropped = 0;        // Pattern thread only.
+static atomic_long shown = 0;
+
+
+// Allocate the buffers, all black.  Returns 0 if successful.
+int EmuFramesInit(int pixelCount) {
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    buffers[i] = calloc(pixelCount, sizeof(color_t));
+    if (buffers[i] == NULL) {
+      fprintf(stderr, "Unable to allocate the frame buffers!\n");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+// The buffer for the pattern thread to fill in with the next frame.
+color_t *EmuFramesBack(void) {
+  return buffers[back];
+}
+
+
+// Hand the back buffer over to the display thread, and take the middle buffer
+// as the new back.
+void EmuFramesPublish(void) {
+  back = atomic_exchange(&middle, back | FRESH);
+  if (back & FRESH) {
+    dropped++;
+  }
+  back &= ~FRESH;
+  published++;
+}
+
+
+// The newest frame the pattern thread has published, or NULL if there hasn't
+// been one since the last call.  The frame stays put until the next call.
+const color_t *EmuFramesLatest(void) {
+  if (!(atomic_load(&middle) & FRESH)) {
+    return NULL;
+  }
+  front = atomic_exchange(&middle, front) & ~FRESH;
+  atomic_fetch_add(&shown, 1);
+  return buffers[front];
+}
+
+
+// Print how many frames made it to the display.  Call from the pattern thread.
+void EmuFramesPrintStats(void) {
+  if (published == 0) {
+    return;
+  }
+  printf("Display: %li frames made, %li shown, %li dropped (replaced before they were drawn)\n",
+         published, atomic_load(&shown), dropped);
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,20 @@
+// File:   emuFrames.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Frame exchange between the pattern and display threads for the EMULATE
+// target.
+
+#ifndef EMUFRAMES_H
+#define	EMUFRAMES_H
+
+  #include "galaxyConfig.h"
+
+  // Prototypes
+  int EmuFramesInit(int pixelCount);
+  color_t *EmuFramesBack(void);
+  void EmuFramesPublish(void);
+  const color_t *EmuFramesLatest(void);
+  void EmuFramesPrintStats(void);
+
+#endif	/* EMUFRAMES_H */
@@ -0,0 +1,931 @@
+// File: emuModes.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Windowless run modes.  The benchmarks and checks (--wire-benchmark,
+// --blend-benchmark, --math-benchmark, --vm-benchmark, --transition-check),
+// and the runs that go as fast as they can (--headless, --bake, --fleet).
+// Each sets up the patterns as the pattern loop in master.c does (see
+// PatternSetup()), and runs them without the window or the emulated serial
+// port.
+
+#ifdef EMULATE
+
+// Includes
+#include "deviceConfig.h"  // BIT_RATE
+#include "galaxyConfig.h"
+#include "master.h"
+#include "display.h"
+#include "topology.h"
+#include "patternSupport.h"
+#include "pattern.h"
+#include "composite.h"
+#include "transition.h"
+#include "vm.h"
+#include "emuModes.h"
+#include "emuSlave.h"
+#include "emuRecord.h"
+#include "emuVideo.h"
+#include "emuFleet.h"
+#include "emuBake.h"
+#include "emuAsm.h"
+#include <math.h>    // fabs(), cosf(), sinf(), M_PI
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>    // clock_gettime()
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc()
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+// Types
+
+// One galaxy of a fleet (see Fleet()).  Each has its own pixels, link to its
+// slaves, pattern schedule and state, and random numbers.
+typedef struct {
+  galaxyData_t galaxy;
+  link_t link;
+  packet_t packet;
+  stateSet_t states;
+  int pattern;
+  playlist_t playlist;
+  unsigned char initial;
+  outputMapping_e map;
+  unsigned long int randState;
+  unsigned int checksum;     // FNV-1a of all the packets it built.
+} fleetGalaxy_t;
+
+// Globals
+static fleetGalaxy_t *fleet = NULL;
+
+// Prototypes
+static unsigned int FrameChecksum(galaxyData_t *galaxy, outputMapping_e map);
+static double FleetFrame(int index);
+static color_t HsvToRgbFloat(float hue, float saturation, float value);
+static color_t RainbowSwitchStep(color_t color, int *transition);
+static void UnitPixelPositionFloat(int pixel, float *x, float *y);
+
+
+// Wire format benchmark.  Runs each pattern in patternList for its full
+// iteration count and counts the bytes it would put on the wire:
+// - Fixed: every slave, every frame, raw (135 bytes per frame on the galaxy).
+// - Partial: changed slaves only, or broadcast commands when shorter.
+// - Compressed: as Partial, with RLE / palette slave blocks when shorter.
+// Each run starts from the same seed and a black galaxy, so every mode sees
+// exactly the same frames.  Pattern holds are ignored.
+void WireBenchmark(galaxyData_t *galaxy) {
+
+  // Vars
+  int p, mode;
+  long int frame, fixedBytes, bytes[2], total[3] = {0, 0, 0};
+  outputMapping_e map;
+  packet_t packet;
+  link_t link;
+  static stateSet_t states;
+
+  AllocatePacket(&packet, galaxy->topology);
+  LinkInit(&link);
+  PatternSetup(&states, NULL, 0, NULL, NULL, 0);
+
+  printf("Wire bytes per frame and wire time by pattern (%.1f kbps):\n",
+         1.0 / (BIT_RATE * 1000));
+  printf("  %-16s %6s %14s %14s %14s %8s\n", "Pattern", "Frames",
+         "Fixed", "Partial", "Compressed", "Saved");
+  for (p = 0; p < PATTERN_COUNT; p++) {
+    for (mode = 0; mode < 2; mode++) {
+      srand(25);
+      ColorAll(galaxy, PIXEL_BLACK);
+      RefreshAllSlaves(&link);
+      SetCompression(&link, mode == 1);
+      map = MAP_FULL;
+      bytes[mode] = 0;
+      for (frame = 0; frame < patternList[p].iterations; frame++) {
+        patternList[p].patternFunction(galaxy, states.state[p], frame == 0, &map);
+        BuildPacket(&link, galaxy, map, &packet);
+        bytes[mode] += packet.length;
+      }
+    }
+    fixedBytes = patternList[p].iterations * GetFrameBytes(galaxy->topology);
+    total[0] += fixedBytes;
+    total[1] += bytes[0];
+    total[2] += bytes[1];
+
+    printf("  %-16s %6li %5.1f %6.2fs %5.1f %6.2fs %5.1f %6.2fs %7.1f%%\n",
+           patternList[p].name, patternList[p].iterations,
+           (double) fixedBytes / patternList[p].iterations,
+           fixedBytes * BITS_PER_BYTE * BIT_RATE,
+           (double) bytes[0] / patternList[p].iterations,
+           bytes[0] * BITS_PER_BYTE * BIT_RATE,
+           (double) bytes[1] / patternList[p].iterations,
+           bytes[1] * BITS_PER_BYTE * BIT_RATE,
+           100.0 * (1.0 - ((double) bytes[1] / fixedBytes)));
+  }
+  printf("  %-16s %6s %12.2fs %12.2fs %12.2fs %7.1f%%\n", "Total", "",
+         total[0] * BITS_PER_BYTE * BIT_RATE, total[1] * BITS_PER_BYTE * BIT_RATE,
+         total[2] * BITS_PER_BYTE * BIT_RATE,
+         100.0 * (1.0 - ((double) total[2] / total[0])));
+}
+
+
+// Bake each pattern's run (see emuBake.c) to path, frames long, or as long as
+// the wire benchmark runs it if that's less than 0.  Each run starts from the
+// seed and a black galaxy, like the wire benchmark's, and is played back from
+// its first frame.
+void Bake(galaxyData_t *galaxy, const char *path, unsigned int seed, long int frames) {
+
+  // Vars
+  int p;
+  long int frame, count, hold;
+  outputMapping_e map;
+  static stateSet_t states;
+
+  PatternSetup(&states, NULL, 0, NULL, NULL, 0);
+  if (EmuBakeOpen(path, seed) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  for (p = 0; p < PATTERN_COUNT; p++) {
+    srand(seed);
+    ColorAll(galaxy, PIXEL_BLACK);
+    map = MAP_FULL;
+    count = (frames < 0) ? patternList[p].iterations : frames;
+    EmuBakeBegin(patternList[p].name);
+    for (frame = 0; frame < count; frame++) {
+      hold = patternList[p].patternFunction(galaxy, states.state[p], frame == 0, &map);
+      EmuBakeFrame(galaxy, map, hold);
+    }
+    EmuBakeEnd();
+  }
+
+  if (EmuBakeClose() != 0) {
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+// Headless run.  Runs the pattern loop as fast as it will go, without the
+// window, the emulated serial port or the pattern holds, for a number of
+// frames or a length of simulated time, whichever comes first.  A negative
+// limit is no limit.  Simulated time is how long the frames would have taken
+// on the galaxy - each one takes its wire time or its pattern's hold, whichever
+// is longer, since the two overlap.  Patterns are chosen just as in
+// GeneratePattern(), from the given seed, so runs are repeatable.  Prints the
+// speed of each pattern (pattern code plus packet building) and a checksum of
+// every byte that would have gone out the wire, for spotting changes in the
+// output.
+void Headless(galaxyData_t *galaxy, unsigned int seed, long int frames, double seconds) {
+
+  // Vars
+  int i, next, pattern, initial = TRUE;
+  long int frame, totalBytes = 0;
+  outputMapping_e map = MAP_FULL, outputMap = MAP_FULL;
+  galaxyData_t *output = galaxy;
+  transition_t transition;
+  packet_t packet;
+  link_t link;
+  struct timespec start, end;
+  double patternNs[PATTERN_COUNT], ns, totalNs = 0, simulated = 0;
+  double wireTime, shown;
+  long int hold = 0, nextHold;
+  playlist_t playlist;
+  unsigned int checksum = 2166136261U;  // FNV-1a
+  color_t *leds = NULL;
+  static stateSet_t states;
+
+  // Skip the pattern holds.
+  delayMultiplier = 0;
+  srand(seed);
+  AllocatePacket(&packet, galaxy->topology);
+  LinkInit(&link);
+  PatternSetup(&states, &playlist, playlistClock, &transition, galaxy,
+               transitionFrames);
+  ColorAll(galaxy, PIXEL_BLACK);
+  pattern = PlaylistNext(&playlist);
+
+  // The video shows what the slaves make of the packets.
+  if (EmuVideoIsOpen()) {
+    EmuSlavesInit(galaxy->topology);
+    leds = malloc(galaxy->size * sizeof(color_t));
+    if (leds == NULL) {
+      fprintf(stderr, "Unable to allocate %i pixels!\n", galaxy->size);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (i = 0; i < PATTERN_COUNT; i++) {
+    patternNs[i] = 0;
+    patternFrames[i] = 0;
+    patternBytes[i] = 0;
+  }
+
+  for (frame = 0; (frames < 0) || (frame < frames); frame++) {
+    if ((seconds >= 0) && (simulated >= seconds)) break;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    BuildPacket(&link, output, outputMap, &packet);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+
+    // The frame shows until the last of it has gone out, or for its hold,
+    // whichever is longer.
+    wireTime = packet.length * BITS_PER_BYTE * BIT_RATE;
+    shown = (wireTime > hold / 1e6) ? wireTime : hold / 1e6;
+    EmuRecordFrame(output, outputMap, pattern, shown);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    nextHold = patternList[pattern].patternFunction(galaxy, states.state[pattern],
+                                                    initial, &map);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    output = RunTransition(&transition, galaxy, map, &outputMap);
+
+    ns += ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+    patternNs[pattern] += ns;
+    totalNs += ns;
+    patternFrames[pattern]++;
+    patternBytes[pattern] += packet.length;
+    totalBytes += packet.length;
+    for (i = 0; i < packet.length; i++) {
+      checksum = (checksum ^ packet.bytes[i]) * 16777619U;
+    }
+
+    // The frame shows once the last of it has gone out.
+    if (leds != NULL) {
+      EmuSlavesReceive(&packet);
+      EmuSlavesGetFrame(leds);
+      EmuVideoFrame(leds, simulated + wireTime);
+    }
+    simulated += shown;
+    hold = nextHold;
+
+    // Next pattern?
+    initial = FALSE;
+    if (PlaylistTick(&playlist, (long int) (shown * 1e6))) {
+      next = PlaylistNext(&playlist);
+      if (next != pattern) {
+        TransitionStart(&transition, galaxy, &patternList[pattern],
+                        states.state[pattern], map);
+      }
+      pattern = next;
+      initial = TRUE;
+    }
+  }
+
+  printf("Headless run: %li frames, %.2f s of galaxy time, %.3f s of compute, seed %u\n",
+         frame, simulated, totalNs / 1e9, seed);
+  printf("  %-16s %8s %12s %12s %12s\n", "Pattern", "Frames", "ns/frame",
+         "frames/s", "bytes/frame");
+  for (i = 0; i < PATTERN_COUNT; i++) {
+    if (patternFrames[i] == 0) continue;
+    printf("  %-16s %8li %12.0f %12.0f %12.1f\n", patternList[i].name,
+           patternFrames[i], patternNs[i] / patternFrames[i],
+           1e9 * patternFrames[i] / patternNs[i],
+           (double) patternBytes[i] / patternFrames[i]);
+  }
+  if (frame > 0) {
+    printf("  %-16s %8li %12.0f %12.0f %12.1f\n", "Total", frame, totalNs / frame,
+           1e9 * frame / totalNs, (double) totalBytes / frame);
+  }
+  PrintTransitionStats();
+  printf("Wire checksum: %08x\n", checksum);
+  EmuRecordClose();
+  EmuVideoClose();
+}
+
+
+// What the crossfades cost: the outgoing pattern's frame and the blend, on top
+// of the incoming pattern's frame.
+void PrintTransitionStats(void) {
+  if (transitionFrames <= 0) {
+    printf("Crossfades: off\n");
+  } else if (fadeFrames > 0) {
+    printf("Crossfades: %i frames each, %li frames in all, %.0f ns/frame extra\n",
+           transitionFrames, fadeFrames, fadeNs / fadeFrames);
+  }
+}
+
+
+// Crossfade check.  Fades from each pattern to the next, and checks that both
+// run through the fade just as they do alone: the outgoing one's frames
+// against a run of it on its own, and the incoming one's against a run of it
+// on its own from the same start (the outgoing one's last frame, as with a
+// cut).  Each pattern gets random numbers of its own, so the other
+// can't throw it off.  Returns the number of patterns that differ.
+int TransitionCheck(galaxyData_t *galaxy) {
+
+  // Vars
+  static stateSet_t states;
+  transition_t t;
+  outputMapping_e map, outMap;
+  unsigned long int randOut, randIn;
+  unsigned int *outSums, *inSums;
+  color_t *start;
+  int i, p, q, frame, fade, lead = 50, failed = 0;
+  unsigned char outSame, inSame;
+
+  fade = (transitionFrames > 0) ? transitionFrames : TRANSITION_FRAMES;
+  PatternSetup(&states, NULL, 0, &t, galaxy, fade);
+  outSums = malloc(fade * sizeof(unsigned int));
+  inSums = malloc(fade * sizeof(unsigned int));
+  start = malloc(galaxy->size * sizeof(color_t));
+  if ((outSums == NULL) || (inSums == NULL) || (start == NULL)) {
+    fprintf(stderr, "Unable to allocate the crossfade check!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("Crossfades of %i frames, %i frames into the outgoing pattern:\n",
+         fade, lead);
+  printf("  %-16s %-16s %9s %9s\n", "From", "To", "Outgoing", "Incoming");
+  for (p = 0; p < PATTERN_COUNT; p++) {
+    q = (p + 1) % PATTERN_COUNT;
+
+    // Each on its own.
+    PatternSetup(&states, NULL, 0, NULL, NULL, 0);
+    randOut = 1;
+    PatternRandUse(&randOut);
+    ColorAll(galaxy, PIXEL_BLACK);
+    map = MAP_FULL;
+    for (frame = 0; frame < lead + fade; frame++) {
+      patternList[p].patternFunction(galaxy, states.state[p], frame == 0, &map);
+      if (frame >= lead) {
+        outSums[frame - lead] = FrameChecksum(galaxy, map);
+      } else if (frame == lead - 1) {
+        for (i = 0; i < galaxy->size; i++) {
+          start[i] = *galaxy->pixels[i];
+        }
+      }
+    }
+    randIn = 2;
+    PatternRandUse(&randIn);
+    for (i = 0; i < galaxy->size; i++) {
+      *galaxy->pixels[i] = start[i];
+    }
+    map = MAP_FULL;
+    for (frame = 0; frame < fade; frame++) {
+      patternList[q].patternFunction(galaxy, states.state[q], frame == 0, &map);
+      inSums[frame] = FrameChecksum(galaxy, map);
+    }
+
+    // And faded from one to the other.
+    PatternSetup(&states, NULL, 0, NULL, NULL, 0);
+    randOut = 1;
+    randIn = 2;
+    PatternRandUse(&randOut);
+    ColorAll(galaxy, PIXEL_BLACK);
+    map = MAP_FULL;
+    for (frame = 0; frame < lead; frame++) {
+      patternList[p].patternFunction(galaxy, states.state[p], frame == 0, &map);
+    }
+    TransitionStart(&t, galaxy, &patternList[p], states.state[p], map);
+    outSame = inSame = TRUE;
+    map = MAP_FULL;
+    for (frame = 0; frame < fade; frame++) {
+      PatternRandUse(&randIn);
+      patternList[q].patternFunction(galaxy, states.state[q], frame == 0, &map);
+      PatternRandUse(&randOut);
+      RunTransition(&t, galaxy, map, &outMap);
+      inSame &= (FrameChecksum(galaxy, map) == inSums[frame]);
+      outSame &= (FrameChecksum(&t.galaxy, t.map) == outSums[frame]);
+    }
+    PatternRandUse(NULL);
+
+    printf("  %-16s %-16s %9s %9s\n", patternList[p].name, patternList[q].name,
+           outSame ? "same" : "DIFFERS", inSame ? "same" : "DIFFERS");
+    failed += !(outSame && inSame);
+  }
+
+  free(outSums);
+  free(inSums);
+  free(start);
+  return failed;
+}
+
+
+// FNV-1a of a frame and its map.
+static unsigned int FrameChecksum(galaxyData_t *galaxy, outputMapping_e map) {
+
+  // Vars
+  unsigned int checksum = 2166136261U;
+  int i, j;
+
+  checksum = (checksum ^ map) * 16777619U;
+  for (i = 0; i < galaxy->size; i++) {
+    for (j = 0; j < CHANNEL_COUNT; j++) {
+      checksum = (checksum ^ galaxy->pixels[i]->chan[j]) * 16777619U;
+    }
+  }
+  return checksum;
+}
+
+
+// Run a fleet of count galaxies at once, spread over threads workers (one per
+// core if 0), for the given frames per galaxy or seconds, whichever comes
+// first.  Each galaxy runs its own pattern schedule, with random numbers of
+// its own seeded from seed, so its frames are the same however the work gets
+// spread.  Paced, each galaxy runs in real time, and the report shows the
+// deadlines it missed.  Unpaced, the frames are run as fast as they'll go.
+// Each galaxy's frames are packed for its own link, as for the galaxy, and
+// its packets summed into a checksum.
+void Fleet(const topology_t *topology, int count, int threads, unsigned int seed,
+           long int frames, double seconds, unsigned char paced) {
+
+  // Vars
+  int i, j, size;
+  fleetGalaxy_t *g;
+  color_t *pixels;
+  unsigned int checksum = 2166136261U;  // FNV-1a
+
+  size = GetPixelCount(topology);
+
+  fleet = calloc(count, sizeof(fleetGalaxy_t));
+  if (fleet == NULL) {
+    fprintf(stderr, "Unable to allocate %i galaxies!\n", count);
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < count; i++) {
+    g = &fleet[i];
+    pixels = malloc(size * sizeof(color_t));
+    g->galaxy.pixels = malloc(size * sizeof(color_t *));
+    if ((pixels == NULL) || (g->galaxy.pixels == NULL)) {
+      fprintf(stderr, "Unable to allocate %i galaxies!\n", count);
+      exit(EXIT_FAILURE);
+    }
+    g->galaxy.size = size;
+    g->galaxy.topology = topology;
+    for (j = 0; j < size; j++) {
+      g->galaxy.pixels[j] = &pixels[j];
+    }
+    ColorAll(&g->galaxy, PIXEL_BLACK);
+    LinkInit(&g->link);
+    AllocatePacket(&g->packet, topology);
+
+    // Each starts on a pattern of its own.
+    g->randState = seed + i;
+    PatternRandUse(&g->randState);
+    PatternSetup(&g->states, &g->playlist, playlistClock, NULL, NULL, 0);
+    g->pattern = PlaylistNext(&g->playlist);
+    PatternRandUse(NULL);
+    g->initial = TRUE;
+    g->map = MAP_FULL;
+    g->checksum = 2166136261U;
+  }
+
+  if (EmuFleetRun(count, threads, seconds, frames, paced, FleetFrame) == 0) {
+    for (i = 0; i < count; i++) {
+      for (j = 0; j < 4; j++) {
+        checksum = (checksum ^ ((fleet[i].checksum >> (j * 8)) & 0xFF)) * 16777619U;
+      }
+    }
+    printf("Fleet checksum: %08x (seed %u)\n", checksum, seed);
+  }
+}
+
+
+// Run the next frame of fleet galaxy index, on a fleet worker thread, and pack
+// it for the galaxy's link.  Returns the frame's length, the longer of its
+// hold and its packet's time on the wire.
+static double FleetFrame(int index) {
+
+  // Vars
+  fleetGalaxy_t *g = &fleet[index];
+  int i;
+  double length, wireTime;
+
+  PatternRandUse(&g->randState);
+  length = patternList[g->pattern].patternFunction(&g->galaxy,
+      g->states.state[g->pattern], g->initial, &g->map) / 1e6;
+  BuildPacket(&g->link, &g->galaxy, g->map, &g->packet);
+  wireTime = g->packet.length * BITS_PER_BYTE * BIT_RATE;
+  if (length < wireTime) {
+    length = wireTime;
+  }
+
+  for (i = 0; i < g->packet.length; i++) {
+    g->checksum = (g->checksum ^ g->packet.bytes[i]) * 16777619U;
+  }
+
+  // Next pattern?
+  g->initial = FALSE;
+  if (PlaylistTick(&g->playlist, (long int) (length * 1e6))) {
+    g->pattern = PlaylistNext(&g->playlist);
+    g->initial = TRUE;
+  }
+  PatternRandUse(NULL);
+
+  return length;
+}
+
+
+// Time each blend over the galaxy's pixels (use --topology for bigger ones),
+// fully opaque and part transparent, and check that the SIMD blends give the
+// same results as the scalar ones.
+void BlendBenchmark(galaxyData_t *galaxy) {
+
+  // Vars
+  const char *names[BLEND_COUNT] = {"Alpha", "Add", "Multiply", "Screen", "Max"};
+  const unsigned char alphas[2] = {255, 160};
+  int i, mode, a, same, bytes = galaxy->size * BYTES_PER_PIXEL;
+  long int rep, reps;
+  unsigned char *src, *dst, *check;
+  struct timespec start, end;
+  double ns;
+
+  src = malloc(bytes);
+  dst = malloc(bytes);
+  check = malloc(bytes);
+  if ((src == NULL) || (dst == NULL) || (check == NULL)) {
+    fprintf(stderr, "Unable to allocate %i pixels!\n", galaxy->size);
+    exit(EXIT_FAILURE);
+  }
+
+  // About 100 MB through each blend.
+  reps = 1 + (100000000L / bytes);
+  printf("Blending %i pixels, %li times each:\n", galaxy->size, reps);
+  printf("  %-10s %6s %10s %12s %8s\n", "Blend", "Alpha", "ns/pixel",
+         "Mpixels/s", "Scalar");
+  for (mode = 0; mode < BLEND_COUNT; mode++) {
+    for (a = 0; a < 2; a++) {
+      srand(25);
+      for (i = 0; i < bytes; i++) {
+        src[i] = rand();
+        dst[i] = check[i] = rand();
+      }
+      BlendPixels((color_t *) dst, (color_t *) src, galaxy->size, mode, alphas[a]);
+      BlendScalar(check, src, bytes, mode, alphas[a]);
+      same = (memcmp(dst, check, bytes) == 0);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (rep = 0; rep < reps; rep++) {
+        BlendPixels((color_t *) dst, (color_t *) src, galaxy->size, mode, alphas[a]);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      ns = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+
+      printf("  %-10s %6i %10.3f %12.1f %8s\n", names[mode], alphas[a],
+             ns / ((double) reps * galaxy->size),
+             (reps * (double) galaxy->size) / (ns / 1e9) / 1e6,
+             same ? "same" : "DIFFERS");
+    }
+  }
+
+  free(src);
+  free(dst);
+  free(check);
+}
+
+
+// Pattern program benchmark.  Runs each pattern compiled in, and the program
+// of the same name in dir (see emuAsm.c) on the VM, from the same seed and a
+// black galaxy, and checks they draw the same frames with the same holds.
+// Then times each, over about 100000 frames.  Cycles are the CPU's time stamp
+// counter, where it has one.
+void VmBenchmark(galaxyData_t *galaxy, const char *dir) {
+
+  // Vars
+  int p, run, same;
+  long int frame, rep, reps, hold;
+  outputMapping_e map;
+  static stateSet_t states;
+  vmState_t vmState;
+  void *state;
+  unsigned char *program;
+  unsigned int i, length, checksum[2];
+  char path[FILENAME_MAX];
+  struct timespec start, end;
+  unsigned long long cycles;
+  double ns[2], perFrame[2];
+
+  PatternSetup(&states, NULL, 0, NULL, NULL, 0);
+
+  printf("Pattern programs from %s against the compiled patterns:\n", dir);
+  printf("  %-16s %5s %12s %12s %12s %12s %7s %7s\n", "Pattern", "Bytes",
+         "Native ns", "cycles", "VM ns", "cycles", "Slower", "Output");
+  for (p = 0; p < PATTERN_COUNT; p++) {
+    snprintf(path, sizeof(path), "%s/%s.gva", dir, patternList[p].name);
+    if (EmuAsmLoad(path, &program, &length) != 0) {
+      continue;
+    }
+    reps = 1 + (100000L / patternList[p].iterations);
+
+    for (run = 0; run < 2; run++) {
+      state = run ? (void *) &vmState : states.state[p];
+
+      // What it draws.
+      srand(25);
+      memset(state, 0, run ? sizeof(vmState) : patternList[p].stateSize);
+      ColorAll(galaxy, PIXEL_BLACK);
+      map = MAP_FULL;
+      checksum[run] = 2166136261U;  // FNV-1a
+      for (frame = 0; frame < patternList[p].iterations; frame++) {
+        if (run) {
+          hold = VmRun(galaxy, state, program, frame == 0, &map);
+        } else {
+          hold = patternList[p].patternFunction(galaxy, state, frame == 0, &map);
+        }
+        checksum[run] = (checksum[run] ^ (unsigned int) hold) * 16777619U;
+        checksum[run] = (checksum[run] ^ map) * 16777619U;
+        for (i = 0; i < (unsigned int) galaxy->size * BYTES_PER_PIXEL; i++) {
+          checksum[run] = (checksum[run] ^
+              galaxy->pixels[i / BYTES_PER_PIXEL]->chan[i % BYTES_PER_PIXEL]) *
+              16777619U;
+        }
+      }
+
+      // And how long it takes.
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      cycles = CYCLES();
+      for (rep = 0; rep < reps; rep++) {
+        srand(25);
+        ColorAll(galaxy, PIXEL_BLACK);
+        for (frame = 0; frame < patternList[p].iterations; frame++) {
+          if (run) {
+            VmRun(galaxy, state, program, frame == 0, &map);
+          } else {
+            patternList[p].patternFunction(galaxy, state, frame == 0, &map);
+          }
+        }
+      }
+      cycles = CYCLES() - cycles;
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      ns[run] = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+      ns[run] /= (double) reps * patternList[p].iterations;
+      perFrame[run] = (double) cycles / ((double) reps * patternList[p].iterations);
+    }
+    same = (checksum[0] == checksum[1]);
+
+    printf("  %-16s %5u %12.1f %12.0f %12.1f %12.0f %6.1fx %7s\n",
+           patternList[p].name, length, ns[0], perFrame[0], ns[1], perFrame[1],
+           ns[1] / ns[0], same ? "same" : "DIFFERS");
+    free(program);
+  }
+  printf("  A program's registers take %u bytes of RAM.\n",
+         (unsigned int) sizeof(vmState_t));
+}
+
+
+// Fixed point math benchmark.  Checks each of the pattern support fixed point
+// functions against float over all of its inputs (a million random ones for
+// the multiplies), with the error in units of the result's last bit, and
+// times each against the same sum done in float, over 10000000 calls.
+void MathBenchmark(void) {
+
+  // Vars
+  long int rep, reps = 10000000L, i, count;
+  double maxError, sumError, error, exact, fixedNs, floatNs;
+  volatile long int sink = 0;
+  long int a[1024], b[1024];
+  int h, s, v, j, transition, pixels;
+  color_t fixed, real;
+  float x, y, realX, realY;
+  struct timespec start, end;
+
+  // Time statement over reps calls (ns per call).
+#define MATH_TIME(ns, statement) \
+  clock_gettime(CLOCK_MONOTONIC, &start); \
+  for (rep = 0; rep < reps; rep++) { \
+    statement; \
+  } \
+  clock_gettime(CLOCK_MONOTONIC, &end); \
+  ns = (((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec)) / reps
+
+  // Keep a running error.
+#define MATH_ERROR(fixedValue, exactValue) \
+  error = fabs((double) (fixedValue) - (exactValue)); \
+  sumError += error; \
+  if (error > maxError) { \
+    maxError = error; \
+  } \
+  count++
+
+  printf("Fixed point against float (error in the result's last bit):\n");
+  printf("  %-12s %9s %10s %10s %9s %9s %7s\n", "Function", "Inputs",
+         "Max error", "Mean error", "Fixed ns", "Float ns", "Speed");
+
+  // Sin1616(), against the whole turn.
+  maxError = sumError = count = 0;
+  for (i = 0; i < 65536; i++) {
+    MATH_ERROR(Sin1616(i), sin(i * 2 * M_PI / 65536) * FIXED1616_ONE);
+  }
+  MATH_TIME(fixedNs, sink += Sin1616(rep));
+  MATH_TIME(floatNs, sink += (long int) lrintf(sinf((rep & 0xFFFF) * (float) (2 * M_PI / 65536)) * FIXED1616_ONE));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Sin1616", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // Sin8().
+  maxError = sumError = count = 0;
+  for (i = 0; i < 256; i++) {
+    MATH_ERROR(Sin8(i), 128 + (127 * sin(i * 2 * M_PI / 256)));
+  }
+  MATH_TIME(fixedNs, sink += Sin8(rep));
+  MATH_TIME(floatNs, sink += (long int) lrintf(128 + (127 * sinf((rep & 0xFF) * (float) (2 * M_PI / 256)))));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Sin8", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // Scale8(), every value at every scale.
+  maxError = sumError = count = 0;
+  for (i = 0; i < 65536; i++) {
+    MATH_ERROR(Scale8(i & 0xFF, i >> 8), floor(((i & 0xFF) * (i >> 8) / 255.0) + 0.5));
+  }
+  MATH_TIME(fixedNs, sink += Scale8(rep, rep >> 8));
+  MATH_TIME(floatNs, sink += (long int) lrintf((rep & 0xFF) * ((rep >> 8) & 0xFF) / 255.0f));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Scale8", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // Lerp8(), every pair of ends at every fraction.
+  maxError = sumError = count = 0;
+  for (i = 0; i < 16777216L; i++) {
+    exact = (i & 0xFF) + ((((i >> 8) & 0xFF) - (i & 0xFF)) * (i >> 16) / 255.0);
+    MATH_ERROR(Lerp8(i, i >> 8, i >> 16), exact);
+  }
+  MATH_TIME(fixedNs, sink += Lerp8(rep, rep >> 8, rep >> 16));
+  MATH_TIME(floatNs, sink += (long int) lrintf((rep & 0xFF) + ((((rep >> 8) & 0xFF) - (rep & 0xFF)) * ((rep >> 16) & 0xFF) / 255.0f)));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Lerp8", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // HsvToRgb(), every color.  Each channel counts.
+  maxError = sumError = count = 0;
+  for (h = 0; h < 256; h++) {
+    for (s = 0; s < 256; s++) {
+      for (v = 0; v < 256; v++) {
+        fixed = HsvToRgb(h, s, v);
+        real = HsvToRgbFloat(h, s, v);
+        for (j = 0; j < CHANNEL_COUNT; j++) {
+          MATH_ERROR(fixed.chan[j], real.chan[j]);
+        }
+      }
+    }
+  }
+  MATH_TIME(fixedNs, sink += HsvToRgb(rep, rep >> 8, rep >> 16).r);
+  MATH_TIME(floatNs, sink += HsvToRgbFloat(rep & 0xFF, (rep >> 8) & 0xFF, (rep >> 16) & 0xFF).r);
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "HsvToRgb", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // RainbowFader()'s colors, once round the wheel from red, against the
+  // six-way fader it replaced at the same point round the wheel (it took 186
+  // steps to go round).  Each channel counts.
+  maxError = sumError = count = 0;
+  real = PIXEL_RED;
+  transition = 0;
+  for (i = 1; i <= 186; i++) {
+    real = RainbowSwitchStep(real, &transition);
+    fixed = HsvToRgb((unsigned char) (((i * 256L) + 93) / 186), 255, 255);
+    for (j = 0; j < CHANNEL_COUNT; j++) {
+      MATH_ERROR(fixed.chan[j], real.chan[j]);
+    }
+  }
+  MATH_TIME(fixedNs, sink += HsvToRgb((unsigned char) rep, 255, 255).g);
+  MATH_TIME(floatNs, real = RainbowSwitchStep(real, &transition); sink += real.g);
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "RainbowFader", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // UnitPixelPosition(), every pixel of the topology, x and y each, in
+  // 65536ths of an arm.
+  maxError = sumError = count = 0;
+  pixels = GetPixelCount(emuTopology);
+  for (i = 0; i < pixels; i++) {
+    UnitPixelPosition(i, &x, &y);
+    UnitPixelPositionFloat(i, &realX, &realY);
+    MATH_ERROR((double) x * FIXED1616_ONE, (double) realX * FIXED1616_ONE);
+    MATH_ERROR((double) y * FIXED1616_ONE, (double) realY * FIXED1616_ONE);
+  }
+  MATH_TIME(fixedNs, UnitPixelPosition(rep % pixels, &x, &y); sink += (long int) (x * 1000));
+  MATH_TIME(floatNs, UnitPixelPositionFloat(rep % pixels, &x, &y); sink += (long int) (x * 1000));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Layout", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // Fixed88Mul(), on factors whose product fits (under 11.3 or so).
+  srand(25);
+  for (i = 0; i < 1024; i++) {
+    a[i] = (rand() % 5792) - 2896;
+    b[i] = (rand() % 5792) - 2896;
+  }
+  maxError = sumError = count = 0;
+  for (i = 0; i < 1000000L; i++) {
+    MATH_ERROR(Fixed88Mul(a[i & 1023], b[(i >> 10) & 1023]),
+               (double) a[i & 1023] * b[(i >> 10) & 1023] / FIXED88_ONE);
+  }
+  MATH_TIME(fixedNs, sink += Fixed88Mul(a[rep & 1023], b[(rep >> 10) & 1023]));
+  MATH_TIME(floatNs, sink += (long int) lrintf((a[rep & 1023] / (float) FIXED88_ONE) * (b[(rep >> 10) & 1023] / (float) FIXED88_ONE) * FIXED88_ONE));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Fixed88Mul", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  // Fixed1616Mul(), likewise (under 181 or so).
+  for (i = 0; i < 1024; i++) {
+    a[i] = (((long int) rand() << 16) ^ rand()) % 23724032L - 11862016L;
+    b[i] = (((long int) rand() << 16) ^ rand()) % 23724032L - 11862016L;
+  }
+  maxError = sumError = count = 0;
+  for (i = 0; i < 1000000L; i++) {
+    MATH_ERROR(Fixed1616Mul(a[i & 1023], b[(i >> 10) & 1023]),
+               (double) a[i & 1023] * b[(i >> 10) & 1023] / FIXED1616_ONE);
+  }
+  MATH_TIME(fixedNs, sink += Fixed1616Mul(a[rep & 1023], b[(rep >> 10) & 1023]));
+  MATH_TIME(floatNs, sink += (long int) lrintf((a[rep & 1023] / (float) FIXED1616_ONE) * (b[(rep >> 10) & 1023] / (float) FIXED1616_ONE) * FIXED1616_ONE));
+  printf("  %-12s %9li %10.2f %10.3f %9.2f %9.2f %6.1fx\n", "Fixed1616Mul", count,
+         maxError, sumError / count, fixedNs, floatNs, floatNs / fixedNs);
+
+  printf("  RainbowFader is against the six-way fader it replaced (its \"float\"\n"
+         "  column), and Layout (UnitPixelPosition()) against cosf() and sinf().\n");
+  printf("  Times are the host's.  The PIC has no floating point unit, so there\n"
+         "  it's the float side that slows down.\n");
+
+#undef MATH_TIME
+#undef MATH_ERROR
+}
+
+
+// HSV to RGB in float, for MathBenchmark().  Hue, saturation and value are as
+// HsvToRgb()'s.
+static color_t HsvToRgbFloat(float hue, float saturation, float value) {
+
+  // Vars
+  color_t color;
+  float sector, rise, p, q, t;
+
+  sector = floorf(hue * 6 / 256);
+  rise = (hue * 6 / 256) - sector;
+  saturation /= 255;
+  p = value * (1 - saturation) + 0.5f;
+  q = value * (1 - (saturation * rise)) + 0.5f;
+  t = value * (1 - (saturation * (1 - rise))) + 0.5f;
+  value += 0.5f;
+
+  switch ((int) sector) {
+    case 0:
+      color.r = value; color.g = t; color.b = p;
+      break;
+    case 1:
+      color.r = q; color.g = value; color.b = p;
+      break;
+    case 2:
+      color.r = p; color.g = value; color.b = t;
+      break;
+    case 3:
+      color.r = p; color.g = q; color.b = value;
+      break;
+    case 4:
+      color.r = t; color.g = p; color.b = value;
+      break;
+    default:
+      color.r = value; color.g = p; color.b = q;
+      break;
+  }
+  return color;
+}
+
+
+// One step of the six-way fader RainbowFader() used to be, for
+// MathBenchmark(): the color after color, transition being which of the six
+// fades it's on.  Faithful to the old one, so the cyan to blue fade leaves a
+// little green behind (it zeroed red).
+static color_t RainbowSwitchStep(color_t color, int *transition) {
+  switch (*transition) {
+    case 0:  // Red -> Yellow (Green increases)
+      color.g += 8;
+      if (color.g > 255 - 8) { color.g = 255; (*transition)++; }
+      break;
+    case 1:  // Yellow -> Green (Red decreases)
+      color.r -= 8;
+      if (color.r < 8) { color.r = 0; (*transition)++; }
+      break;
+    case 2:  // Green -> Cyan (Blue increases)
+      color.b += 8;
+      if (color.b > 255 - 8) { color.b = 255; (*transition)++; }
+      break;
+    case 3:  // Cyan -> Blue (Green decreases)
+      color.g -= 8;
+      if (color.g < 8) { color.r = 0; (*transition)++; }
+      break;
+    case 4:  // Blue -> Magenta (Red increases)
+      color.r += 8;
+      if (color.r > 255 - 8) { color.r = 255; (*transition)++; }
+      break;
+    default:  // Magenta -> Red (Blue decreases)
+      color.b -= 8;
+      if (color.b < 8) { color.b = 0; *transition = 0; }
+      break;
+  }
+  return color;
+}
+
+
+// UnitPixelPosition() in float, for MathBenchmark().
+static void UnitPixelPositionFloat(int pixel, float *x, float *y) {
+
+  // Vars
+  int arm, i;
+  float theta, phi, ax, ay;
+
+  arm = pixel / emuTopology->pixelsPerArm;
+  i = emuTopology->pixelsPerArm - 1 - GetTipDistance(emuTopology, pixel);
+  theta = (i + 1) * (M_PI / emuTopology->pixelsPerArm);
+  ax = cosf(theta) - 1;
+  ay = -sinf(theta);
+  phi = arm * (2 * M_PI / emuTopology->armCount);
+  *x = (ax * cosf(phi)) - (ay * sinf(phi));
+  *y = (ax * sinf(phi)) + (ay * cosf(phi));
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,25 @@
+// File:   emuModes.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Windowless run modes for the EMULATE target: benchmarks, checks, headless
+// runs, baking and fleets.
+
+#ifndef EMUMODES_H
+#define	EMUMODES_H
+
+  #include "display.h"
+
+  // Prototypes
+  void WireBenchmark(galaxyData_t *galaxy);
+  void Bake(galaxyData_t *galaxy, const char *path, unsigned int seed, long int frames);
+  void Headless(galaxyData_t *galaxy, unsigned int seed, long int frames, double seconds);
+  void PrintTransitionStats(void);
+  int TransitionCheck(galaxyData_t *galaxy);
+  void Fleet(const topology_t *topology, int count, int threads, unsigned int seed,
+             long int frames, double seconds, unsigned char paced);
+  void BlendBenchmark(galaxyData_t *galaxy);
+  void VmBenchmark(galaxyData_t *galaxy, const char *dir);
+  void MathBenchmark(void);
+
+#endif	/* EMUMODES_H */
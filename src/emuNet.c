@@ -0,0 +1,437 @@
+// File: emuNet.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Output to networked LED controllers.  The galaxy's pixels are laid end to
+// end across DMX universes, 170 RGB pixels to a universe, and each universe
+// goes out as a UDP packet in either of the two common DMX over ethernet
+// protocols:
+// - E1.31 (streaming ACN, "sACN"), port 5568, universes numbered from 1.
+// - Art-Net (ArtDmx packets), port 6454, universes numbered from 0.
+// The packet headers are built once when the output is opened, so a frame is
+// just the pixel data copied in and one sendmmsg() for all the universes.
+//
+// The pixels are mapped the same way the slaves see them - MAP_MIRROR folds
+// every arm onto the first.
+//
+// Giving "loopback" as the host sends the packets to a receiver thread on
+// 127.0.0.1, which checks them and measures the packet rate and the time from
+// the send to the last universe of each frame arriving.
+
+#ifdef EMULATE
+
+#define _GNU_SOURCE  // sendmmsg(), recvmmsg()
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuNet.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Defines
+#define E131_PORT 5568
+#define E131_HEADER_BYTES 126
+#define ARTNET_PORT 6454
+#define ARTNET_HEADER_BYTES 18
+#define RECEIVE_BATCH 64
+
+// Globals
+static int netFd = -1;
+static netProtocol_e netProtocol;
+static struct sockaddr_in destination;
+static int universeCount = 0;
+static int firstUniverse;
+static int headerBytes;
+static unsigned char **universePackets = NULL;  // Header then data, per universe.
+static struct mmsghdr *messages = NULL;
+static struct iovec *iovecs = NULL;
+static unsigned char sequence = 0;
+static long int sendErrors = 0;
+
+static int loopbackFd = -1;
+static pthread_t receiverThread;
+static pthread_mutex_t netLock = PTHREAD_MUTEX_INITIALIZER;
+static double sentAt[256];  // Send time of each sequence number.
+static netStats_t stats;
+
+// Component ID for E1.31.  Any fixed UUID will do, as long as it's ours.
+static const unsigned char e131Cid[16] = {
+  0x67, 0x61, 0x6c, 0x61, 0x78, 0x79, 0x4d, 0x61,
+  0x73, 0x74, 0x65, 0x72, 0x20, 0x45, 0x6d, 0x75
+};
+
+// Prototypes
+void BuildE131Header(unsigned char *p, int universe, int slots);
+void BuildArtNetHeader(unsigned char *p, int universe, int slots);
+void *NetReceiver(void *arg);
+void ReceivePacket(const unsigned char *p, int length, double now);
+static int OpenLoopbackReceiver(void);
+static double Now(void);
+static void Put16(unsigned char *p, int value);
+
+
+// Open the output, sending to host (a name or address, or "loopback").
+// Returns 0 on success.
+int EmuNetOpen(netProtocol_e protocol, const char *host, const topology_t *topology) {
+  struct addrinfo hints, *result;
+  int u, pixels, slots, length;
+
+  netProtocol = protocol;
+  memset(&destination, 0, sizeof(destination));
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons((protocol == NET_E131) ? E131_PORT : ARTNET_PORT);
+
+  // Where to?
+  if (strcmp(host, "loopback") == 0) {
+    u = OpenLoopbackReceiver();
+    if (u < 0) {
+      return -1;
+    }
+    destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    destination.sin_port = htons(u);
+  } else {
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0) {
+      fprintf(stderr, "Unable to find host %s\n", host);
+      return -1;
+    }
+    destination.sin_addr = ((struct sockaddr_in *) result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+  }
+
+  netFd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (netFd < 0) {
+    fprintf(stderr, "Unable to open a UDP socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  // A packet per universe, with its header filled in.
+  pixels = GetPixelCount(topology);
+  universeCount = (pixels + PIXELS_PER_UNIVERSE - 1) / PIXELS_PER_UNIVERSE;
+  firstUniverse = (protocol == NET_E131) ? 1 : 0;
+  headerBytes = (protocol == NET_E131) ? E131_HEADER_BYTES : ARTNET_HEADER_BYTES;
+  universePackets = malloc(universeCount * sizeof(unsigned char *));
+  messages = calloc(universeCount, sizeof(struct mmsghdr));
+  iovecs = calloc(universeCount, sizeof(struct iovec));
+  if ((universePackets == NULL) || (messages == NULL) || (iovecs == NULL)) {
+    fprintf(stderr, "Unable to allocate the network packets!\n");
+    return -1;
+  }
+
+  for (u = 0; u < universeCount; u++) {
+    slots = pixels - (u * PIXELS_PER_UNIVERSE);
+    if (slots > PIXELS_PER_UNIVERSE) slots = PIXELS_PER_UNIVERSE;
+    slots *= BYTES_PER_PIXEL;
+    if (protocol == NET_ARTNET) {
+      slots += slots % 2;  // Art-Net wants an even length.
+    }
+    length = headerBytes + slots;
+
+    universePackets[u] = calloc(length, 1);
+    if (universePackets[u] == NULL) {
+      fprintf(stderr, "Unable to allocate the network packets!\n");
+      return -1;
+    }
+    if (protocol == NET_E131) {
+      BuildE131Header(universePackets[u], firstUniverse + u, slots);
+    } else {
+      BuildArtNetHeader(universePackets[u], firstUniverse + u, slots);
+    }
+
+    iovecs[u].iov_base = universePackets[u];
+    iovecs[u].iov_len = length;
+    messages[u].msg_hdr.msg_name = &destination;
+    messages[u].msg_hdr.msg_namelen = sizeof(destination);
+    messages[u].msg_hdr.msg_iov = &iovecs[u];
+    messages[u].msg_hdr.msg_iovlen = 1;
+  }
+
+  printf("%s output to %s:%i, universes %i to %i\n",
+         (protocol == NET_E131) ? "E1.31" : "Art-Net", inet_ntoa(destination.sin_addr),
+         ntohs(destination.sin_port), firstUniverse, firstUniverse + universeCount - 1);
+  return 0;
+}
+
+
+// Is there a network output?
+int EmuNetIsOpen(void) {
+  return netFd >= 0;
+}
+
+
+// Send a frame - every universe, in one system call.
+void EmuNetSend(galaxyData_t *galaxy, outputMapping_e map) {
+  int i, u, pixel, sent, n;
+  unsigned char *data;
+  color_t *color;
+
+  if (netFd < 0) {
+    return;
+  }
+
+  // Sequence numbers run 1 to 255.  Zero means "not sequenced" to Art-Net.
+  sequence = (sequence == 255) ? 1 : sequence + 1;
+
+  for (u = 0; u < universeCount; u++) {
+    universePackets[u][(netProtocol == NET_E131) ? 111 : 12] = sequence;
+    data = universePackets[u] + headerBytes;
+    for (i = 0; i < PIXELS_PER_UNIVERSE; i++) {
+      pixel = (u * PIXELS_PER_UNIVERSE) + i;
+      if (pixel >= galaxy->size) break;
+      if (map == MAP_MIRROR) {
+        pixel = GetTipDistance(galaxy->topology, pixel);
+      }
+      color = galaxy->pixels[pixel];
+      *data++ = color->r;
+      *data++ = color->g;
+      *data++ = color->b;
+    }
+  }
+
+  pthread_mutex_lock(&netLock);
+  sentAt[sequence] = Now();
+  pthread_mutex_unlock(&netLock);
+
+  // sendmmsg() may stop short (a full socket buffer), so finish the job.
+  sent = 0;
+  while (sent < universeCount) {
+    n = sendmmsg(netFd, messages + sent, universeCount - sent, 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      sendErrors++;
+      return;
+    }
+    sent += n;
+  }
+}
+
+
+// Print what the loopback receiver saw.
+void EmuNetPrintStats(void) {
+  netStats_t s;
+  double elapsed;
+
+  if (netFd < 0) {
+    return;
+  }
+  if (sendErrors > 0) {
+    printf("Network: %li frames failed to send.\n", sendErrors);
+  }
+  if (loopbackFd < 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&netLock);
+  s = stats;
+  pthread_mutex_unlock(&netLock);
+  if (s.packets == 0) {
+    return;
+  }
+
+  elapsed = s.lastPacket - s.firstPacket;
+  printf("Network loopback: %li packets (%i universes/frame), %li bad, %li lost\n",
+         s.packets, universeCount, s.badPackets, s.lostPackets);
+  if (elapsed > 0) {
+    printf("  %.1f packets/s, %.1f frames/s\n", s.packets / elapsed, s.frames / elapsed);
+  }
+  if (s.frames > 0) {
+    printf("  Latency, send to last universe received: %.3f ms average, %.3f ms max\n",
+           1000.0 * s.latencySum / s.frames, 1000.0 * s.latencyMax);
+  }
+}
+
+
+// E1.31 data packet header - root layer, framing layer, then the DMP layer
+// up to and including the start code.  All multi-byte fields are big endian.
+void BuildE131Header(unsigned char *p, int universe, int slots) {
+  int length = E131_HEADER_BYTES + slots;
+
+  // Root layer.
+  Put16(p + 0, 0x0010);                  // Preamble size.
+  Put16(p + 2, 0x0000);                  // Postamble size.
+  memcpy(p + 4, "ASC-E1.17\0\0\0", 12);  // ACN packet identifier.
+  Put16(p + 16, 0x7000 | (length - 16)); // Flags and length.
+  p[21] = 0x04;                          // Vector: E1.31 data.
+  memcpy(p + 22, e131Cid, 16);
+
+  // Framing layer.
+  Put16(p + 38, 0x7000 | (length - 38));
+  p[43] = 0x02;                          // Vector: DMP.
+  strncpy((char *) p + 44, "Galaxy Emulator", 64);
+  p[108] = 100;                          // Priority.
+  Put16(p + 113, universe);
+
+  // DMP layer.
+  Put16(p + 115, 0x7000 | (length - 115));
+  p[117] = 0x02;                         // Vector: set property.
+  p[118] = 0xa1;                         // Address and data type.
+  Put16(p + 121, 0x0001);                // Address increment.
+  Put16(p + 123, slots + 1);             // Property count, with the start code.
+}
+
+
+// Art-Net ArtDmx packet header.  The opcode is little endian, everything
+// else big endian.
+void BuildArtNetHeader(unsigned char *p, int universe, int slots) {
+  memcpy(p, "Art-Net\0", 8);
+  p[8] = 0x00;                    // OpDmx, 0x5000.
+  p[9] = 0x50;
+  Put16(p + 10, 14);              // Protocol version.
+  p[14] = universe & 0xff;        // SubUni.
+  p[15] = (universe >> 8) & 0x7f; // Net.
+  Put16(p + 16, slots);
+}
+
+
+// Bind the loopback receiver to a free port on 127.0.0.1 and start it.
+// Returns the port, or -1.
+static int OpenLoopbackReceiver(void) {
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+
+  loopbackFd = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  if ((loopbackFd < 0) ||
+      (bind(loopbackFd, (struct sockaddr *) &address, sizeof(address)) != 0) ||
+      (getsockname(loopbackFd, (struct sockaddr *) &address, &length) != 0)) {
+    fprintf(stderr, "Unable to open the loopback receiver: %s\n", strerror(errno));
+    return -1;
+  }
+
+  if (pthread_create(&receiverThread, NULL, NetReceiver, NULL) != 0) {
+    fprintf(stderr, "Unable to start the loopback receiver thread!\n");
+    return -1;
+  }
+  pthread_detach(receiverThread);
+  return ntohs(address.sin_port);
+}
+
+
+// The loopback receiver.  Takes packets in batches, as a controller with a lot
+// of universes would have to.
+void *NetReceiver(void *arg) {
+  static unsigned char buffers[RECEIVE_BATCH][E131_HEADER_BYTES + DMX_CHANNELS];
+  struct mmsghdr received[RECEIVE_BATCH];
+  struct iovec iov[RECEIVE_BATCH];
+  int i, n;
+  double now;
+
+  memset(received, 0, sizeof(received));
+  for (i = 0; i < RECEIVE_BATCH; i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = sizeof(buffers[i]);
+    received[i].msg_hdr.msg_iov = &iov[i];
+    received[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  FOREVER {
+    n = recvmmsg(loopbackFd, received, RECEIVE_BATCH, MSG_WAITFORONE, NULL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    now = Now();
+
+    pthread_mutex_lock(&netLock);
+    for (i = 0; i < n; i++) {
+      ReceivePacket(buffers[i], received[i].msg_len, now);
+    }
+    pthread_mutex_unlock(&netLock);
+  }
+
+  return NULL;
+}
+
+
+// Check one received packet and keep score.  A frame is complete when every
+// universe has arrived with the same sequence number.  Called with netLock held.
+void ReceivePacket(const unsigned char *p, int length, double now) {
+  static int lastSequence = -1, universesSeen = 0;
+  int universe, seq, slots;
+
+  // Parse it.
+  if (netProtocol == NET_E131) {
+    if ((length < E131_HEADER_BYTES) || (memcmp(p + 4, "ASC-E1.17", 10) != 0) ||
+        (p[21] != 0x04) || (p[43] != 0x02) || (p[117] != 0x02)) {
+      stats.badPackets++;
+      return;
+    }
+    seq = p[111];
+    universe = (p[113] << 8) | p[114];
+    slots = ((p[123] << 8) | p[124]) - 1;
+    if (slots != length - E131_HEADER_BYTES) {
+      stats.badPackets++;
+      return;
+    }
+  } else {
+    if ((length < ARTNET_HEADER_BYTES) || (memcmp(p, "Art-Net\0", 8) != 0) ||
+        (p[8] != 0x00) || (p[9] != 0x50)) {
+      stats.badPackets++;
+      return;
+    }
+    seq = p[12];
+    universe = p[14] | (p[15] << 8);
+    slots = (p[16] << 8) | p[17];
+    if (slots != length - ARTNET_HEADER_BYTES) {
+      stats.badPackets++;
+      return;
+    }
+  }
+  universe -= firstUniverse;
+  if ((universe < 0) || (universe >= universeCount)) {
+    stats.badPackets++;
+    return;
+  }
+
+  if (stats.packets == 0) {
+    stats.firstPacket = now;
+  }
+  stats.packets++;
+  stats.lastPacket = now;
+
+  // A new frame.  Whatever didn't arrive of the last one is lost.
+  if (seq != lastSequence) {
+    if (lastSequence >= 0) {
+      stats.lostPackets += universeCount - universesSeen;
+    }
+    lastSequence = seq;
+    universesSeen = 0;
+  }
+
+  if (++universesSeen == universeCount) {
+    stats.frames++;
+    stats.latencySum += now - sentAt[seq];
+    if ((now - sentAt[seq]) > stats.latencyMax) stats.latencyMax = now - sentAt[seq];
+    lastSequence = -1;
+  }
+}
+
+
+static double Now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+
+static void Put16(unsigned char *p, int value) {
+  p[0] = (value >> 8) & 0xff;
+  p[1] = value & 0xff;
+}
+
+#endif /* EMULATE */
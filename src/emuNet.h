@@ -0,0 +1,36 @@
+// File:   emuNet.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Networked LED controller output (E1.31 / Art-Net) for the EMULATE target.
+
+#ifndef EMUNET_H
+#define	EMUNET_H
+
+  #include "display.h"
+
+  // Protocols.
+  typedef enum { NET_E131, NET_ARTNET } netProtocol_e;
+
+  // Each DMX universe carries 170 RGB pixels (510 of its 512 channels).
+  #define DMX_CHANNELS 512
+  #define PIXELS_PER_UNIVERSE (DMX_CHANNELS / BYTES_PER_PIXEL)
+
+  // Loopback statistics, gathered by the bundled receiver.  Times are in
+  // seconds.
+  typedef struct {
+    long int packets;       // Universe packets received.
+    long int badPackets;    // Packets that didn't parse.
+    long int frames;        // Frames with every universe received.
+    long int lostPackets;   // Universe packets that never arrived.
+    double firstPacket, lastPacket;    // Receive times.
+    double latencySum, latencyMax;     // Send to last universe of a frame.
+  } netStats_t;
+
+  // Prototypes
+  int EmuNetOpen(netProtocol_e protocol, const char *host, const topology_t *topology);
+  int EmuNetIsOpen(void);
+  void EmuNetSend(galaxyData_t *galaxy, outputMapping_e map);
+  void EmuNetPrintStats(void);
+
+#endif	/* EMUNET_H */
@@ -0,0 +1,413 @@
+// File: emuPlugin.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Pattern plugins.  Each shared object (.so) in the plugin directory (see
+// --plugins) holds a pattern, described by a pattern_t it exports (see
+// emuPlugin.h).  The plugins run in turn in place of the playlist.  Rebuild
+// one while the emulator is running, and it's swapped for the new build
+// between one frame and the next, without stopping the window or the frame
+// clock.  A plugin keeps its state across a reload if the state is the same
+// size, so a tweak shows up mid-run; otherwise the state starts over, as if
+// the pattern had just been picked.
+//
+// A watcher thread waits on inotify for plugins to be written (or moved into
+// the directory) and loads them.  Each is copied and loaded from the copy, as
+// the dynamic loader won't load a file again while the old one is open.  The
+// loaded plugin is handed to the pattern thread by an atomic exchange, which
+// the pattern thread picks up at the start of its next frame, so a reload
+// never holds up a frame.  The old build is unloaded once the new one's in.
+//
+// Plugins call back into the emulator for the pattern support functions
+// (Shift(), ColorAll(), PIXEL_BLACK, ...), so the emulator exports its
+// symbols (see src/CMakeLists.txt).  A plugin is built like this:
+//
+//   gcc -shared -fPIC -DEMULATE -I../src -o plugins/Twinkle.so Twinkle.c
+//
+// Build it to another name and mv it into place, or the watcher may load it
+// half written.  The frame times of each plugin are reported on exit.
+
+#ifdef EMULATE
+
+// Includes
+#include "emuPlugin.h"
+#include "patternSupport.h"
+#include "pattern.h"
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+// Defines
+#define PLUGIN_MAX 32
+#define NAME_LENGTH 64
+
+// Types
+// A loaded build of a plugin.
+typedef struct {
+  void *handle;
+  const pattern_t *pattern;
+} build_t;
+
+typedef struct {
+  char file[NAME_LENGTH];
+  _Atomic(build_t *) pending;  // New build, from the watcher.
+  build_t *build;              // Pattern thread only, from here down.
+  void *state;
+  unsigned int stateSize;
+  unsigned char fresh;         // State starts over on the next frame.
+  long int frames, reloads;
+  double totalNs, maxNs;
+} plugin_t;
+
+// Globals
+static char pluginDir[PATH_MAX - NAME_LENGTH];
+static int watchFd = -1;
+static pthread_t watchThread;
+static plugin_t plugins[PLUGIN_MAX];
+static atomic_int pluginCount = 0;
+static build_t removed;        // Pending, when a plugin's file goes away.
+static int current = -1;       // Pattern thread only.
+static long int currentFrames;
+
+// Prototypes
+static void *Watch(void *arg);
+static void Load(const char *file);
+static build_t *Open(const char *file);
+static void Close(build_t *build);
+static int Find(const char *file, unsigned char add);
+static unsigned char IsPlugin(const char *file);
+static void Swap(plugin_t *p);
+
+
+// Load the plugins in dir, and watch it for more.  Returns 0 if successful.
+int EmuPluginOpen(const char *dir) {
+  DIR *d;
+  struct dirent *entry;
+
+  if (strlen(dir) >= sizeof(pluginDir)) {
+    fprintf(stderr, "Plugin directory name too long!\n");
+    return -1;
+  }
+  strcpy(pluginDir, dir);
+
+  // Watch first, so nothing written while the rest load is missed.
+  watchFd = inotify_init1(IN_CLOEXEC);
+  if ((watchFd < 0) ||
+      (inotify_add_watch(watchFd, dir, IN_CLOSE_WRITE | IN_MOVED_TO |
+                                       IN_MOVED_FROM | IN_DELETE) < 0)) {
+    fprintf(stderr, "Unable to watch \"%s\": %s\n", dir, strerror(errno));
+    return -1;
+  }
+
+  d = opendir(dir);
+  if (d == NULL) {
+    fprintf(stderr, "Unable to open \"%s\": %s\n", dir, strerror(errno));
+    return -1;
+  }
+  while ((entry = readdir(d)) != NULL) {
+    if (IsPlugin(entry->d_name)) {
+      Load(entry->d_name);
+    }
+  }
+  closedir(d);
+
+  if (pthread_create(&watchThread, NULL, Watch, NULL) != 0) {
+    fprintf(stderr, "Unable to start the plugin watcher thread!\n");
+    return -1;
+  }
+  pthread_detach(watchThread);
+  printf("Plugins: %i from %s, watching for changes.\n",
+         atomic_load(&pluginCount), dir);
+  return 0;
+}
+
+
+// Are plugins in use?
+unsigned char EmuPluginIsOpen(void) {
+  return watchFd >= 0;
+}
+
+
+// Run the current plugin for a frame, or the next one if next is set, or the
+// current one has had its turn (or gone).  Any new builds go in first.
+// Returns the frame's hold (us).
+long int EmuPluginFrame(galaxyData_t *galaxy, unsigned char next, outputMapping_e *map) {
+  int i, count = atomic_load(&pluginCount);
+  unsigned char initial = FALSE;
+  plugin_t *p;
+  struct timespec start, end;
+  long int hold;
+  double ns;
+
+  for (i = 0; i < count; i++) {
+    Swap(&plugins[i]);
+  }
+
+  // Whose turn is it?
+  if ((current >= 0) && (plugins[current].build != NULL) &&
+      (currentFrames >= plugins[current].build->pattern->iterations)) {
+    next = TRUE;
+  }
+  if (next || (current < 0) || (plugins[current].build == NULL)) {
+    for (i = 1; i <= count; i++) {
+      if (plugins[(current + i) % count].build != NULL) {
+        current = (current + i) % count;
+        currentFrames = 0;
+        initial = TRUE;
+        break;
+      }
+    }
+  }
+  if ((current < 0) || (plugins[current].build == NULL)) {
+    return 0;
+  }
+
+  p = &plugins[current];
+  if (p->fresh) {
+    initial = TRUE;
+    p->fresh = FALSE;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  hold = p->build->pattern->patternFunction(galaxy, p->state, initial, map);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ns = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+  p->frames++;
+  p->totalNs += ns;
+  if (ns > p->maxNs) {
+    p->maxNs = ns;
+  }
+  currentFrames++;
+  return hold;
+}
+
+
+// Print each plugin's frame times.
+void EmuPluginPrintStats(void) {
+  int i, count = atomic_load(&pluginCount);
+
+  if (count == 0) {
+    return;
+  }
+  printf("Plugin frame times:\n");
+  printf("  %-16s %8s %10s %10s %8s\n", "Plugin", "Frames", "Mean us", "Max us",
+         "Reloads");
+  for (i = 0; i < count; i++) {
+    printf("  %-16s %8li %10.2f %10.2f %8li\n",
+           (plugins[i].build != NULL) ? plugins[i].build->pattern->name : plugins[i].file,
+           plugins[i].frames,
+           (plugins[i].frames > 0) ? plugins[i].totalNs / plugins[i].frames / 1000 : 0,
+           plugins[i].maxNs / 1000, plugins[i].reloads);
+  }
+}
+
+
+// The watcher thread.  Loads each plugin as it's written, and drops it if it
+// goes away.
+static void *Watch(void *arg) {
+  char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *event;
+  build_t *old;
+  ssize_t length;
+  char *at;
+  int i;
+
+  FOREVER {
+    length = read(watchFd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      if ((length < 0) && (errno == EINTR)) {
+        continue;
+      }
+      fprintf(stderr, "Plugin watcher stopped: %s\n", strerror(errno));
+      return NULL;
+    }
+
+    for (at = buffer; at < buffer + length;
+         at += sizeof(struct inotify_event) + event->len) {
+      event = (const struct inotify_event *) at;
+      if ((event->len == 0) || !IsPlugin(event->name)) {
+        continue;
+      }
+      if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        Load(event->name);
+      } else if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+        i = Find(event->name, FALSE);
+        if (i >= 0) {
+          old = atomic_exchange(&plugins[i].pending, &removed);
+          Close(old);
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+
+// Load a build of file, and hand it to the pattern thread.  A build that
+// won't load is reported, and the one running carries on.
+static void Load(const char *file) {
+  build_t *build;
+  int i;
+
+  build = Open(file);
+  if (build == NULL) {
+    return;
+  }
+  i = Find(file, TRUE);
+  if (i < 0) {
+    Close(build);
+    return;
+  }
+
+  // If the last build never got picked up, it's not needed now.
+  Close(atomic_exchange(&plugins[i].pending, build));
+}
+
+
+// Load a copy of file.  Returns NULL if it can't.
+static build_t *Open(const char *file) {
+  char path[PATH_MAX], copy[] = "/tmp/galaxyPluginXXXXXX";
+  unsigned char bytes[4096];
+  FILE *in;
+  int out;
+  size_t length;
+  unsigned char failed = FALSE;
+  build_t *build;
+
+  snprintf(path, sizeof(path), "%s/%s", pluginDir, file);
+  in = fopen(path, "rb");
+  out = mkstemp(copy);
+  if ((in == NULL) || (out < 0)) {
+    fprintf(stderr, "Unable to copy plugin \"%s\": %s\n", path, strerror(errno));
+    if (in != NULL) {
+      fclose(in);
+    }
+    if (out >= 0) {
+      close(out);
+      unlink(copy);
+    }
+    return NULL;
+  }
+  while ((length = fread(bytes, 1, sizeof(bytes), in)) > 0) {
+    if (write(out, bytes, length) != (ssize_t) length) {
+      failed = TRUE;
+      break;
+    }
+  }
+  fclose(in);
+  if ((close(out) != 0) || failed) {
+    fprintf(stderr, "Unable to copy plugin \"%s\"!\n", path);
+    unlink(copy);
+    return NULL;
+  }
+
+  // Once it's loaded, the copy isn't needed by name.
+  build = malloc(sizeof(build_t));
+  if (build == NULL) {
+    unlink(copy);
+    return NULL;
+  }
+  build->handle = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+  unlink(copy);
+  if (build->handle == NULL) {
+    fprintf(stderr, "Unable to load plugin \"%s\": %s\n", path, dlerror());
+    free(build);
+    return NULL;
+  }
+  build->pattern = dlsym(build->handle, PLUGIN_SYMBOL);
+  if ((build->pattern == NULL) || (build->pattern->patternFunction == NULL)) {
+    fprintf(stderr, "Plugin \"%s\" has no %s pattern_t!\n", path, PLUGIN_SYMBOL);
+    Close(build);
+    return NULL;
+  }
+  printf("Plugin %s loaded from %s.\n",
+         (build->pattern->name != NULL) ? build->pattern->name : file, file);
+  return build;
+}
+
+
+// Unload a build (not the one that says the plugin's gone).
+static void Close(build_t *build) {
+  if ((build == NULL) || (build == &removed)) {
+    return;
+  }
+  dlclose(build->handle);
+  free(build);
+}
+
+
+// The place of the plugin in file, adding it if asked.  Returns -1 if it's
+// not there (or there's no room for it).  Watcher thread (or before it starts)
+// only.
+static int Find(const char *file, unsigned char add) {
+  int i, count = atomic_load(&pluginCount);
+
+  for (i = 0; i < count; i++) {
+    if (strcmp(plugins[i].file, file) == 0) {
+      return i;
+    }
+  }
+  if (!add) {
+    return -1;
+  }
+  if ((count == PLUGIN_MAX) || (strlen(file) >= NAME_LENGTH)) {
+    fprintf(stderr, "No room for plugin \"%s\"!\n", file);
+    return -1;
+  }
+  strcpy(plugins[count].file, file);
+  atomic_init(&plugins[count].pending, NULL);
+  atomic_store(&pluginCount, count + 1);
+  return count;
+}
+
+
+// Does file look like a plugin?
+static unsigned char IsPlugin(const char *file) {
+  size_t length = strlen(file);
+
+  return (file[0] != '.') && (length > 3) && (strcmp(file + length - 3, ".so") == 0);
+}
+
+
+// Put in a plugin's new build, if it has one, and unload the old build.
+static void Swap(plugin_t *p) {
+  build_t *build = atomic_exchange(&p->pending, NULL);
+  void *state;
+
+  if (build == NULL) {
+    return;
+  }
+  if (build == &removed) {
+    build = NULL;
+  }
+  if (p->build != NULL) {
+    p->reloads += (build != NULL);
+    Close(p->build);
+  }
+  p->build = build;
+
+  // Fresh state, unless it's the same size as the last.
+  if ((build != NULL) && ((p->state == NULL) || (build->pattern->stateSize != p->stateSize))) {
+    state = calloc(1, build->pattern->stateSize + 1);
+    if (state == NULL) {
+      fprintf(stderr, "Unable to allocate the state of plugin \"%s\"!\n", p->file);
+      Close(build);
+      p->build = NULL;
+      return;
+    }
+    free(p->state);
+    p->state = state;
+    p->stateSize = build->pattern->stateSize;
+    p->fresh = TRUE;
+  }
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,25 @@
+// File:   emuPlugin.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Pattern plugins for the EMULATE target.  Pattern functions loaded from
+// shared objects, and reloaded whenever they're rebuilt.
+
+#ifndef EMUPLUGIN_H
+#define	EMUPLUGIN_H
+
+  #include "galaxyConfig.h"
+  #include "display.h"
+
+  // The symbol a plugin exports: a pattern_t (see pattern.h), e.g.
+  //   const pattern_t galaxyPattern = { Twinkle, 500, "Twinkle", sizeof(twinkleState_t) };
+  // The iterations are how many frames it runs before the next plugin's turn.
+  #define PLUGIN_SYMBOL "galaxyPattern"
+
+  // Prototypes
+  int EmuPluginOpen(const char *dir);
+  unsigned char EmuPluginIsOpen(void);
+  long int EmuPluginFrame(galaxyData_t *galaxy, unsigned char next, outputMapping_e *map);
+  void EmuPluginPrintStats(void);
+
+#endif	/* EMUPLUGIN_H */
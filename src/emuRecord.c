@@ -0,0 +1,411 @@
+// File: emuRecord.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Show recorder and playback.  The recorder saves every frame handed to
+// WriteLights(), along with how long the frame before it showed, so an expensive
+// show can be rendered once (in --headless mode, as fast as it will go) and
+// played back later with no pattern code running at all.  Playback maps the
+// file into memory and copies each frame into the galaxy's pixels, so nothing
+// is allocated or read per frame, and it goes to whichever outputs are open
+// just like a live pattern would.
+//
+// File layout.  All numbers are little endian.
+//   Header, HEADER_BYTES:
+//     0  "GXYR"
+//     4  u16 version (1)
+//     6  u16 header size
+//     8  u16 arms, u16 pixels per arm, u16 slaves, u16 unused
+//    16  u32 random seed
+//    20  u32 wire time of a full frame (us) - the fastest frame rate there is
+//    24  u32 frame record size
+//    28  u32 frames per index entry
+//    32  u32 frame count, u32 index entry count
+//    40  u64 index offset
+//    48  u64 length of the show (us)
+//   Frame records, one after another, each the same size:
+//     0  u32 delay (us) - how long the frame before showed (its hold or its
+//        time on the wire, whichever was longer)
+//     4  u8 output map, u8 pattern, u16 unused
+//     8  r, g, b for each pixel, in MAP_FULL order
+//   Index, INDEX_BYTES per entry, one every INDEX_INTERVAL frames:
+//     0  u32 frame, u32 unused
+//     8  u64 time the frame starts (us)
+// The counts, index and length are filled in when the recording is closed.
+// If that never happened, playback works out the frame count from the file
+// size and does without the index.
+
+#ifdef EMULATE
+
+// Includes
+#include "deviceConfig.h"  // BIT_RATE
+#include "galaxyConfig.h"
+#include "emuRecord.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Defines
+#define HEADER_BYTES 64
+#define RECORD_HEADER_BYTES 8
+#define INDEX_BYTES 16
+#define INDEX_INTERVAL 256
+#define RECORD_VERSION 1
+
+// Globals - recording
+static FILE *recordFile = NULL;
+static unsigned char *record = NULL;
+static long int recordBytes;
+static unsigned long int lastShown;     // us, the last frame recorded's.
+static unsigned long int frameCount;
+static unsigned long long int elapsed;  // us
+static unsigned char *recordIndex = NULL;
+static long int indexCount = 0, indexSize = 0;
+
+// Globals - playback
+static const unsigned char *show = NULL;
+static size_t showBytes;
+static long int playRecordBytes, playFrames, playFrame = 0;
+static const unsigned char *playIndex = NULL;
+static long int playIndexCount = 0;
+static int playPixels;
+
+// Prototypes
+static const unsigned char *PlaybackRecord(long int frame);
+static int PlaybackFail(void);
+static void Put16(unsigned char *p, unsigned int v);
+static void Put32(unsigned char *p, unsigned long int v);
+static void Put64(unsigned char *p, unsigned long long int v);
+static unsigned int Get16(const unsigned char *p);
+static unsigned long int Get32(const unsigned char *p);
+static unsigned long long int Get64(const unsigned char *p);
+
+
+// Start recording to a file.  Returns 0 if successful.
+int EmuRecordOpen(const char *path, const topology_t *topology, unsigned int seed) {
+  unsigned char header[HEADER_BYTES];
+
+  recordBytes = RECORD_HEADER_BYTES + (GetPixelCount(topology) * BYTES_PER_PIXEL);
+  record = calloc(recordBytes, 1);
+  recordFile = fopen(path, "wb");
+  if ((record == NULL) || (recordFile == NULL)) {
+    fprintf(stderr, "Unable to record to \"%s\"!\n", path);
+    return -1;
+  }
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "GXYR", 4);
+  Put16(header + 4, RECORD_VERSION);
+  Put16(header + 6, HEADER_BYTES);
+  Put16(header + 8, topology->armCount);
+  Put16(header + 10, topology->pixelsPerArm);
+  Put16(header + 12, topology->slaveCount);
+  Put32(header + 16, seed);
+  Put32(header + 20, GetFrameBytes(topology) * BITS_PER_BYTE * BIT_RATE * 1e6);
+  Put32(header + 24, recordBytes);
+  Put32(header + 28, INDEX_INTERVAL);
+  if (fwrite(header, sizeof(header), 1, recordFile) != 1) {
+    fprintf(stderr, "Unable to record to \"%s\"!\n", path);
+    return -1;
+  }
+
+  frameCount = 0;
+  elapsed = 0;
+  lastShown = 0;
+  return 0;
+}
+
+
+// Record a frame, which shows for shown seconds (the longer of its hold and
+// its time on the wire).
+void EmuRecordFrame(galaxyData_t *galaxy, outputMapping_e map, int pattern,
+                    double shown) {
+  int i;
+  unsigned char *p;
+  unsigned long int us;
+
+  if (recordFile == NULL) {
+    return;
+  }
+
+  // The frame goes out once the last one's time is up.
+  us = lastShown;
+  lastShown = (shown * 1e6) + 0.5;
+  elapsed += us;
+
+  // Index the frame, if it's time.
+  if ((frameCount % INDEX_INTERVAL) == 0) {
+    if (indexCount == indexSize) {
+      indexSize = indexSize ? indexSize * 2 : 64;
+      recordIndex = realloc(recordIndex, indexSize * INDEX_BYTES);
+      if (recordIndex == NULL) {
+        fprintf(stderr, "Unable to allocate the recording's index!\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    p = recordIndex + (indexCount * INDEX_BYTES);
+    memset(p, 0, INDEX_BYTES);
+    Put32(p, frameCount);
+    Put64(p + 8, elapsed);
+    indexCount++;
+  }
+
+  Put32(record, us);
+  record[4] = map;
+  record[5] = pattern;
+  p = record + RECORD_HEADER_BYTES;
+  for (i = 0; i < galaxy->size; i++) {
+    *p++ = galaxy->pixels[i]->r;
+    *p++ = galaxy->pixels[i]->g;
+    *p++ = galaxy->pixels[i]->b;
+  }
+  if (fwrite(record, recordBytes, 1, recordFile) != 1) {
+    fprintf(stderr, "Unable to write to the recording!\n");
+    fclose(recordFile);
+    recordFile = NULL;
+    return;
+  }
+  frameCount++;
+}
+
+
+// Write out the index and the totals, and close the file.
+void EmuRecordClose(void) {
+  unsigned char header[HEADER_BYTES - 32];
+  long int indexOffset;
+
+  if (recordFile == NULL) {
+    return;
+  }
+  indexOffset = ftell(recordFile);
+  Put32(header, frameCount);
+  Put32(header + 4, indexCount);
+  Put64(header + 8, indexOffset);
+  Put64(header + 16, elapsed + lastShown);
+  memset(header + 24, 0, sizeof(header) - 24);
+  if ((indexOffset < 0) ||
+      (fwrite(recordIndex, INDEX_BYTES, indexCount, recordFile) != (size_t) indexCount) ||
+      (fseek(recordFile, 32, SEEK_SET) != 0) ||
+      (fwrite(header, sizeof(header), 1, recordFile) != 1)) {
+    fprintf(stderr, "Unable to write the recording's index and totals!\n");
+    fclose(recordFile);
+  } else if (fclose(recordFile) != 0) {
+    fprintf(stderr, "Unable to finish the recording!\n");
+  } else {
+    printf("Recorded %lu frames, %.2f s\n", frameCount, (elapsed + lastShown) / 1e6);
+  }
+  recordFile = NULL;
+}
+
+
+// Open a recording for playback.  It must have been made on a topology with
+// the same arms and pixels.  Returns 0 if successful.
+int EmuPlaybackOpen(const char *path, const topology_t *topology) {
+  int fd;
+  struct stat st;
+  const unsigned char *h;
+  unsigned long long int indexOffset;
+  long int i;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to open \"%s\"!\n", path);
+    return -1;
+  }
+  if ((fstat(fd, &st) != 0) || (st.st_size < HEADER_BYTES)) {
+    fprintf(stderr, "\"%s\" isn't a recording!\n", path);
+    close(fd);
+    return -1;
+  }
+  showBytes = st.st_size;
+  show = mmap(NULL, showBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (show == MAP_FAILED) {
+    fprintf(stderr, "Unable to map \"%s\"!\n", path);
+    show = NULL;
+    return -1;
+  }
+  madvise((void *) show, showBytes, MADV_SEQUENTIAL);
+
+  // Check the header.
+  h = show;
+  if ((memcmp(h, "GXYR", 4) != 0) || (Get16(h + 4) != RECORD_VERSION) ||
+      (Get16(h + 6) < HEADER_BYTES)) {
+    fprintf(stderr, "\"%s\" isn't a recording this version can play!\n", path);
+    return PlaybackFail();
+  }
+  if ((Get16(h + 8) != topology->armCount) ||
+      (Get16(h + 10) != topology->pixelsPerArm)) {
+    fprintf(stderr, "\"%s\" was recorded with --topology %u,%u,%u\n", path,
+            Get16(h + 8), Get16(h + 10), Get16(h + 12));
+    return PlaybackFail();
+  }
+  playPixels = GetPixelCount(topology);
+  playRecordBytes = Get32(h + 24);
+  if ((playRecordBytes != RECORD_HEADER_BYTES + (playPixels * BYTES_PER_PIXEL)) ||
+      (Get16(h + 6) > showBytes)) {
+    fprintf(stderr, "\"%s\" is damaged!\n", path);
+    return PlaybackFail();
+  }
+
+  // Count the frames, and find the index, if the recording was finished.
+  playFrames = Get32(h + 32);
+  indexOffset = Get64(h + 40);
+  if ((playFrames == 0) ||
+      ((Get16(h + 6) + ((size_t) playFrames * playRecordBytes)) > showBytes)) {
+    playFrames = (showBytes - Get16(h + 6)) / playRecordBytes;
+  } else {
+    playIndexCount = Get32(h + 36);
+    playIndex = show + indexOffset;
+    if ((indexOffset > showBytes) ||
+        (((size_t) playIndexCount * INDEX_BYTES) > (showBytes - indexOffset))) {
+      playIndex = NULL;
+      playIndexCount = 0;
+    }
+  }
+  if (playFrames == 0) {
+    fprintf(stderr, "\"%s\" has no frames!\n", path);
+    return PlaybackFail();
+  }
+
+  // Seeks go straight to the frames the index names, so they had better be
+  // there.
+  for (i = 0; i < playIndexCount; i++) {
+    if (Get32(playIndex + (i * INDEX_BYTES)) >= (unsigned long int) playFrames) {
+      fprintf(stderr, "\"%s\" is damaged!\n", path);
+      return PlaybackFail();
+    }
+  }
+
+  printf("Playing %li frames (%.2f s) recorded with seed %lu.\n", playFrames,
+         Get64(h + 48) / 1e6, Get32(h + 16));
+  playFrame = 0;
+  return 0;
+}
+
+
+int EmuPlaybackIsOpen(void) {
+  return (show != NULL) && (playFrames > 0);
+}
+
+
+// Copy the next frame into the galaxy's pixels, and get its map and the delay
+// (seconds) to wait before it goes out.  Returns the pattern it came from.  At
+// the end, the show starts over.
+int EmuPlaybackFrame(galaxyData_t *galaxy, outputMapping_e *map, double *delay) {
+  int i;
+  const unsigned char *r, *p;
+
+  r = PlaybackRecord(playFrame);
+  *delay = Get32(r) / 1e6;
+  *map = (r[4] == MAP_MIRROR) ? MAP_MIRROR : MAP_FULL;
+  p = r + RECORD_HEADER_BYTES;
+  for (i = 0; i < playPixels; i++) {
+    galaxy->pixels[i]->r = *p++;
+    galaxy->pixels[i]->g = *p++;
+    galaxy->pixels[i]->b = *p++;
+  }
+
+  playFrame++;
+  if (playFrame >= playFrames) {
+    playFrame = 0;
+  }
+  return r[5];
+}
+
+
+// Skip ahead to the next pattern.
+void EmuPlaybackSkip(void) {
+  unsigned char pattern;
+  long int i;
+
+  pattern = PlaybackRecord(playFrame)[5];
+  for (i = 0; i < playFrames; i++) {
+    if (PlaybackRecord(playFrame)[5] != pattern) {
+      return;
+    }
+    playFrame = (playFrame + 1) % playFrames;
+  }
+}
+
+
+// Go to the frame that's showing at the given time into the show.  The index
+// gets close, and the records are walked from there.
+void EmuPlaybackSeek(double seconds) {
+  unsigned long long int target, t;
+  long int low, high, mid;
+
+  target = seconds * 1e6;
+  playFrame = 0;
+  t = Get32(PlaybackRecord(0));
+  if (playIndexCount > 0) {
+    low = 0;
+    high = playIndexCount - 1;
+    while (low < high) {
+      mid = (low + high + 1) / 2;
+      if (Get64(playIndex + (mid * INDEX_BYTES) + 8) <= target) {
+        low = mid;
+      } else {
+        high = mid - 1;
+      }
+    }
+    playFrame = Get32(playIndex + (low * INDEX_BYTES));
+    t = Get64(playIndex + (low * INDEX_BYTES) + 8);
+  }
+  while ((playFrame < playFrames - 1) &&
+         ((t + Get32(PlaybackRecord(playFrame + 1))) <= target)) {
+    playFrame++;
+    t += Get32(PlaybackRecord(playFrame));
+  }
+}
+
+
+// Give up on a recording that's been mapped but can't be played.
+static int PlaybackFail(void) {
+  munmap((void *) show, showBytes);
+  show = NULL;
+  playFrames = 0;
+  playIndex = NULL;
+  playIndexCount = 0;
+  return -1;
+}
+
+
+static const unsigned char *PlaybackRecord(long int frame) {
+  return show + Get16(show + 6) + ((size_t) frame * playRecordBytes);
+}
+
+
+// Little endian helpers.
+static void Put16(unsigned char *p, unsigned int v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void Put32(unsigned char *p, unsigned long int v) {
+  Put16(p, v & 0xffff);
+  Put16(p + 2, v >> 16);
+}
+
+static void Put64(unsigned char *p, unsigned long long int v) {
+  Put32(p, v & 0xffffffffUL);
+  Put32(p + 4, v >> 32);
+}
+
+static unsigned int Get16(const unsigned char *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned long int Get32(const unsigned char *p) {
+  return Get16(p) | ((unsigned long int) Get16(p + 2) << 16);
+}
+
+static unsigned long long int Get64(const unsigned char *p) {
+  return Get32(p) | ((unsigned long long int) Get32(p + 4) << 32);
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,23 @@
+// File:   emuRecord.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Show recorder and playback for the EMULATE target.
+
+#ifndef EMURECORD_H
+#define	EMURECORD_H
+
+  #include "display.h"
+
+  // Prototypes
+  int EmuRecordOpen(const char *path, const topology_t *topology, unsigned int seed);
+  void EmuRecordFrame(galaxyData_t *galaxy, outputMapping_e map, int pattern,
+                      double shown);
+  void EmuRecordClose(void);
+  int EmuPlaybackOpen(const char *path, const topology_t *topology);
+  int EmuPlaybackIsOpen(void);
+  int EmuPlaybackFrame(galaxyData_t *galaxy, outputMapping_e *map, double *delay);
+  void EmuPlaybackSkip(void);
+  void EmuPlaybackSeek(double seconds);
+
+#endif	/* EMURECORD_H */
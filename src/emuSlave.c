@@ -0,0 +1,250 @@
+// File: emuSlave.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Reference slave decoder.  This does what the LED modulator slaves do with
+// the bytes on the serial line: watch for its address, store the data bytes
+// that follow it as LED intensities, and act on the broadcast control codes.
+// The emulator display is drawn from the result, so what you see in the window
+// is what the wire says, not what the pattern code meant to say.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuSlave.h"
+#include "patternSupport.h"  // The palette.
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Decoder states.
+typedef enum {
+  IGNORE, RECEIVE_DATA, RECEIVE_OPCODE, RECEIVE_OPERANDS, RECEIVE_ENCODING,
+  RECEIVE_RLE, RECEIVE_PALETTE
+} decoderState_e;
+
+// Globals
+static pthread_mutex_t slaveLock = PTHREAD_MUTEX_INITIALIZER;
+static const topology_t *topology = NULL;
+static unsigned char **slaveLeds = NULL;  // One array per slave, in its byte order.
+static int slaveByAddress[256];           // Slave index for each address, or -1.
+static unsigned char slaveBrightness = 255;
+
+// Prototypes
+void ExecuteBroadcast(unsigned char opcode, const unsigned char *operands);
+int FindSlave(unsigned char address);
+int WriteRun(int slave, int position, int run, const unsigned char *triplet);
+
+
+// Set up a slave for each one in the topology, all dark.
+void EmuSlavesInit(const topology_t *t) {
+  int slave, i;
+
+  pthread_mutex_lock(&slaveLock);
+  topology = t;
+  slaveLeds = malloc(t->slaveCount * sizeof(unsigned char *));
+  if (slaveLeds == NULL) {
+    fprintf(stderr, "Unable to allocate the emulated slaves!\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < 256; i++) {
+    slaveByAddress[i] = -1;
+  }
+  for (slave = 0; slave < t->slaveCount; slave++) {
+    slaveLeds[slave] = calloc(t->slaves[slave].count * BYTES_PER_PIXEL, 1);
+    if (slaveLeds[slave] == NULL) {
+      fprintf(stderr, "Unable to allocate the emulated slaves!\n");
+      exit(EXIT_FAILURE);
+    }
+    slaveByAddress[t->slaves[slave].address] = slave;
+  }
+  slaveBrightness = 255;
+  pthread_mutex_unlock(&slaveLock);
+}
+
+
+// Decode a packet.  The decoder state doesn't carry over between packets,
+// since a packet always starts with an address.
+void EmuSlavesReceive(const packet_t *packet) {
+  int i, c, slave = 0, position = 0, operandCount = 0;
+  unsigned char value, opcode = 0;
+  unsigned char operands[1 + BYTES_PER_PIXEL];
+  unsigned char triplet[BYTES_PER_PIXEL];
+  const color_t *color;
+  decoderState_e state = IGNORE;
+
+  pthread_mutex_lock(&slaveLock);
+  for (i = 0; i < packet->length; i++) {
+    value = packet->bytes[i];
+
+    // An address byte wakes up the slave it belongs to (or all of them).
+    if (PACKET_IS_ADDRESS(packet, i)) {
+      position = 0;
+      if (value == BROADCAST_ADDRESS) {
+        state = RECEIVE_OPCODE;
+      } else if ((value & ENCODED_BLOCK) == ENCODED_BLOCK) {
+        slave = FindSlave(value & ~ENCODED_BLOCK);
+        state = (slave < 0) ? IGNORE : RECEIVE_ENCODING;
+      } else {
+        slave = FindSlave(value);
+        state = (slave < 0) ? IGNORE : RECEIVE_DATA;
+      }
+      continue;
+    }
+
+    switch (state) {
+      case RECEIVE_DATA:
+        // Extra bytes beyond the slave's LEDs are dropped.
+        if (position < (topology->slaves[slave].count * BYTES_PER_PIXEL)) {
+          slaveLeds[slave][position++] = value;
+        }
+        break;
+
+      case RECEIVE_ENCODING:
+        if (value == ENC_RLE) {
+          state = RECEIVE_RLE;
+          operandCount = 0;
+        } else if (value == ENC_PALETTE) {
+          state = RECEIVE_PALETTE;
+        } else {
+          state = IGNORE;
+        }
+        break;
+
+      case RECEIVE_RLE:
+        // Run length, then the color.
+        operands[operandCount++] = value;
+        if (operandCount > BYTES_PER_PIXEL) {
+          position = WriteRun(slave, position, operands[0], &operands[1]);
+          operandCount = 0;
+        }
+        break;
+
+      case RECEIVE_PALETTE:
+        if ((value & PALETTE_INDEX_MASK) < PALETTE_SIZE) {
+          color = PaletteColor(value & PALETTE_INDEX_MASK);
+          for (c = 0; c < BYTES_PER_PIXEL; c++) {
+            triplet[c] = color->chan[topology->slaves[slave].byteOrder[c]];
+          }
+          position = WriteRun(slave, position, (value >> PALETTE_RUN_SHIFT) + 1, triplet);
+        }
+        break;
+
+      case RECEIVE_OPCODE:
+        opcode = value;
+        position = 0;
+        operandCount = OPERAND_COUNT(opcode);
+        if (operandCount == 0) {
+          ExecuteBroadcast(opcode, operands);
+          state = IGNORE;
+        } else {
+          state = RECEIVE_OPERANDS;
+        }
+        break;
+
+      case RECEIVE_OPERANDS:
+        operands[position++] = value;
+        if (position >= operandCount) {
+          ExecuteBroadcast(opcode, operands);
+          state = IGNORE;
+        }
+        break;
+
+      case IGNORE:
+      default:
+        break;
+    }
+  }
+  pthread_mutex_unlock(&slaveLock);
+}
+
+
+// Carry out a broadcast command on every slave.
+void ExecuteBroadcast(unsigned char opcode, const unsigned char *operands) {
+  int slave, i, value;
+  const colorChannel_e *byteOrder;
+
+  if (opcode == OP_SCALE) {
+    slaveBrightness = operands[0];
+    return;
+  }
+
+  for (slave = 0; slave < topology->slaveCount; slave++) {
+    byteOrder = topology->slaves[slave].byteOrder;
+    for (i = 0; i < (topology->slaves[slave].count * BYTES_PER_PIXEL); i++) {
+      switch (opcode) {
+        case OP_BLANK:
+          slaveLeds[slave][i] = 0;
+          break;
+
+        case OP_FILL:
+          slaveLeds[slave][i] = operands[byteOrder[i % BYTES_PER_PIXEL]];
+          break;
+
+        case OP_FADE:
+          if (byteOrder[i % BYTES_PER_PIXEL] != operands[0]) break;
+          value = slaveLeds[slave][i];
+          if (operands[2] == FADE_RAISE) {
+            value += operands[1];
+            if (value > 255) value = 255;
+          } else if (operands[2] == FADE_LOWER) {
+            value -= operands[1];
+            if (value < 0) value = 0;
+          } else {
+            value += operands[1];  // Modular, truncated below.
+          }
+          slaveLeds[slave][i] = value;
+          break;
+
+        default:
+          // Unknown opcodes are ignored.
+          return;
+      }
+    }
+  }
+}
+
+
+// Write a run of one color into a slave's LEDs, starting at byte position.
+// Returns the position after the run.
+int WriteRun(int slave, int position, int run, const unsigned char *triplet) {
+  int c, end = topology->slaves[slave].count * BYTES_PER_PIXEL;
+
+  while ((run-- > 0) && (position < end)) {
+    for (c = 0; c < BYTES_PER_PIXEL; c++) {
+      slaveLeds[slave][position++] = triplet[c];
+    }
+  }
+  return position;
+}
+
+
+// Look up a slave by its address.  Returns -1 if there isn't one.
+int FindSlave(unsigned char address) {
+  return slaveByAddress[address];
+}
+
+
+// Copy out the galaxy as the slaves are showing it, in MAP_FULL order (see
+// topology_t), with the global brightness applied.
+void EmuSlavesGetFrame(color_t *frame) {
+  int slave, triplet, pixel, c;
+  unsigned char *leds;
+  const slave_t *s;
+
+  pthread_mutex_lock(&slaveLock);
+  for (slave = 0; slave < topology->slaveCount; slave++) {
+    s = &topology->slaves[slave];
+    leds = slaveLeds[slave];
+    for (triplet = 0; triplet < s->count; triplet++) {
+      pixel = s->first + (triplet * s->step);
+      for (c = 0; c < BYTES_PER_PIXEL; c++) {
+        frame[pixel].chan[s->byteOrder[c]] = (*leds++ * slaveBrightness) / 255;
+      }
+    }
+  }
+  pthread_mutex_unlock(&slaveLock);
+}
+
+#endif /* EMULATE */
@@ -0,0 +1,17 @@
+// File:   emuSlave.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Reference slave decoder for the EMULATE target.
+
+#ifndef EMUSLAVE_H
+#define	EMUSLAVE_H
+
+  #include "display.h"
+
+  // Prototypes
+  void EmuSlavesInit(const topology_t *t);
+  void EmuSlavesReceive(const packet_t *packet);
+  void EmuSlavesGetFrame(color_t *frame);
+
+#endif	/* EMUSLAVE_H */
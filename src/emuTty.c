@@ -0,0 +1,351 @@
+// File: emuTty.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Serial output to a real serial port, so a PC can stand in for the PIC as the
+// galaxy's master.  A PC serial port can't send 9 bit bytes, but it can send
+// 8 data bits and a parity bit that's stuck at 1 (MARK) or 0 (SPACE), which is
+// 11 bits a byte, same as the PIC's 9 bit mode, with the parity bit where the
+// 9th bit goes.  So each packet is sent as runs of bytes of the same kind: the
+// address runs with MARK parity, the data runs with SPACE.  The bytes go out as
+// they are.  The port can only change parity between writes, once what's been
+// written has gone out (TCSETSW2 drains the output first, the same as
+// tcdrain() then tcsetattr()), so there's a short gap on the wire at each
+// change, the slaves not minding an idle line between bytes.
+//
+// The packets are handed over by the emulated UART (emuUart.c), which still
+// paces them at the galaxy's frame rate.
+//
+// For testing without hardware, the output can be looped back through a pty
+// to a reader thread, which checks each frame against what was written, and
+// checks that the frames are spaced by at least their wire time.  A pty
+// doesn't do parity at all, so the 9th bit can only be checked on a real port,
+// which has to take MARK and SPACE parity when it's opened.
+
+#ifdef EMULATE
+
+#define _GNU_SOURCE  // posix_openpt() and friends.
+
+// Includes
+#include "deviceConfig.h"  // BIT_RATE
+#include "galaxyConfig.h"
+#include "emuTty.h"
+#include <asm/termbits.h>  // termios2, for the galaxy's non-standard baud rate.
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Frames written but not yet checked by the loopback reader.  The writer
+// waits for the reader if it gets this far ahead.
+#define EXPECTED_FRAMES 64
+typedef struct {
+  unsigned char *bytes;      // As written.
+  int length;
+  double written;            // When write() was first called.
+  double wireTime;           // How long the frame takes to shift out.
+} expected_t;
+
+// Globals
+static int ttyFd = -1;
+static unsigned char *frameBuffer = NULL;
+static int frameBufferSize = 0;
+static struct termios2 ttyTio;         // The port's settings...
+static unsigned char ttyMark = FALSE;  // ... and whether it's on MARK parity.
+static long int parityChanges = 0;
+
+static int loopbackFd = -1;
+static pthread_t readerThread;
+static pthread_mutex_t ttyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ttyCond = PTHREAD_COND_INITIALIZER;
+static expected_t expected[EXPECTED_FRAMES];
+static long int expectedHead = 0, expectedTail = 0;
+static ttyStats_t stats;
+
+// Prototypes
+void *LoopbackReader(void *arg);
+static int SetParity(unsigned char mark);
+static double Now(void);
+
+
+// Open a serial port for output: the galaxy's baud rate, 8 data bits, SPACE
+// parity, 1 stop bit, no flow control, no processing.  Returns 0 on success.
+int EmuTtyOpen(const char *device) {
+  struct termios2 tio;
+
+  ttyFd = open(device, O_WRONLY | O_NOCTTY);
+  if (ttyFd < 0) {
+    fprintf(stderr, "Unable to open %s: %s\n", device, strerror(errno));
+    return -1;
+  }
+
+  if (ioctl(ttyFd, TCGETS2, &tio) != 0) {
+    fprintf(stderr, "%s is not a tty: %s\n", device, strerror(errno));
+    close(ttyFd);
+    ttyFd = -1;
+    return -1;
+  }
+  tio.c_iflag = 0;
+  tio.c_oflag = 0;
+  tio.c_lflag = 0;
+  tio.c_cflag = CS8 | CREAD | CLOCAL | PARENB | CMSPAR | BOTHER;
+  tio.c_ispeed = tio.c_ospeed = (unsigned int) (1.0 / BIT_RATE + 0.5);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  if (ioctl(ttyFd, TCSETS2, &tio) != 0) {
+    fprintf(stderr, "Unable to set up %s: %s\n", device, strerror(errno));
+    close(ttyFd);
+    ttyFd = -1;
+    return -1;
+  }
+  ttyTio = tio;
+  ttyMark = FALSE;
+
+  // Did it take?  Some ports can't do MARK and SPACE parity, and a pty (the
+  // loopback) can't do parity at all.
+  if ((ioctl(ttyFd, TCGETS2, &tio) != 0) ||
+      ((tio.c_cflag & (PARENB | CMSPAR)) != (PARENB | CMSPAR))) {
+    if (loopbackFd < 0) {
+      fprintf(stderr, "%s can't do MARK and SPACE parity, so it can't send the"
+                      " slave addresses.\n", device);
+      close(ttyFd);
+      ttyFd = -1;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+// Open a pty pair, send the output into one end and check what comes out
+// the other.  Returns 0 on success.
+int EmuTtyLoopback(void) {
+  int fd;
+  const char *name;
+
+  fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0) ||
+      ((name = ptsname(fd)) == NULL)) {
+    fprintf(stderr, "Unable to open a pty: %s\n", strerror(errno));
+    return -1;
+  }
+  loopbackFd = fd;
+  if (EmuTtyOpen(name) != 0) {
+    close(fd);
+    loopbackFd = -1;
+    return -1;
+  }
+
+  stats.intervalMin = 1e9;
+  if (pthread_create(&readerThread, NULL, LoopbackReader, NULL) != 0) {
+    fprintf(stderr, "Unable to start the loopback reader thread!\n");
+    return -1;
+  }
+  pthread_detach(readerThread);
+  printf("Serial output looped back through %s\n", name);
+  return 0;
+}
+
+
+// Is there a tty to write to?
+int EmuTtyIsOpen(void) {
+  return ttyFd >= 0;
+}
+
+
+// Send a packet out the tty, a run at a time, with the parity bit as its 9th
+// bit.  wireTime is how long the emulated UART is giving it, for the loopback
+// reader to check against.
+void EmuTtyWrite(const packet_t *packet, double wireTime) {
+  int n, done, end;
+  unsigned char mark, *grown;
+  expected_t *e;
+
+  if ((ttyFd < 0) || (packet->length == 0)) {
+    return;
+  }
+
+  if (frameBufferSize < packet->length) {
+    grown = realloc(frameBuffer, packet->length);
+    if (grown == NULL) {
+      fprintf(stderr, "Unable to allocate the tty frame buffer!\n");
+      exit(EXIT_FAILURE);
+    }
+    frameBuffer = grown;
+    frameBufferSize = packet->length;
+  }
+  memcpy(frameBuffer, packet->bytes, packet->length);
+
+  // Tell the loopback reader what's coming.
+  if (loopbackFd >= 0) {
+    pthread_mutex_lock(&ttyLock);
+    while ((expectedHead - expectedTail) >= EXPECTED_FRAMES) {
+      pthread_cond_wait(&ttyCond, &ttyLock);
+    }
+    e = &expected[expectedHead % EXPECTED_FRAMES];
+    e->bytes = malloc(packet->length);
+    if (e->bytes == NULL) {
+      fprintf(stderr, "Unable to allocate the tty loopback check!\n");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(e->bytes, frameBuffer, packet->length);
+    e->length = packet->length;
+    e->written = Now();
+    e->wireTime = wireTime;
+    expectedHead++;
+    pthread_mutex_unlock(&ttyLock);
+  }
+
+  // A write() for each run of addresses or data, with the parity to match.
+  done = 0;
+  while (done < packet->length) {
+    mark = PACKET_IS_ADDRESS(packet, done) ? TRUE : FALSE;
+    for (end = done + 1; end < packet->length; end++) {
+      if ((PACKET_IS_ADDRESS(packet, end) ? TRUE : FALSE) != mark) {
+        break;
+      }
+    }
+    if (SetParity(mark) != 0) {
+      return;
+    }
+    while (done < end) {
+      n = write(ttyFd, frameBuffer + done, end - done);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        fprintf(stderr, "Serial write failed: %s\n", strerror(errno));
+        return;
+      }
+      done += n;
+    }
+  }
+}
+
+
+// Put the port on MARK (address) or SPACE (data) parity, once what's been
+// written so far has gone out.  Returns 0 on success.
+static int SetParity(unsigned char mark) {
+  if (mark == ttyMark) {
+    return 0;
+  }
+  if (mark) {
+    ttyTio.c_cflag |= PARODD;
+  } else {
+    ttyTio.c_cflag &= ~PARODD;
+  }
+  if (ioctl(ttyFd, TCSETSW2, &ttyTio) != 0) {
+    fprintf(stderr, "Unable to change the serial parity: %s\n", strerror(errno));
+    return -1;
+  }
+  ttyMark = mark;
+  parityChanges++;
+  return 0;
+}
+
+
+// Print what the loopback reader saw.
+void EmuTtyPrintStats(void) {
+  ttyStats_t s;
+  long int intervals;
+
+  if (ttyFd < 0) {
+    return;
+  }
+  printf("Tty: %li parity changes between address and data runs.\n", parityChanges);
+  if (loopbackFd < 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&ttyLock);
+  s = stats;
+  pthread_mutex_unlock(&ttyLock);
+  if (s.frames == 0) {
+    return;
+  }
+
+  printf("  Loopback: %li frames, %li bytes, %li byte errors\n",
+         s.frames, s.bytes, s.byteErrors);
+  intervals = s.frames - 1;
+  if (intervals > 0) {
+    printf("  Frame interval %.2f ms average (%.2f min, %.2f max) for %.2f ms of wire time,"
+           " %li early\n", 1000.0 * s.intervalSum / intervals, 1000.0 * s.intervalMin,
+           1000.0 * s.intervalMax, 1000.0 * s.wireSum / intervals, s.early);
+  }
+  printf("  Latency, write() to last byte read: %.3f ms average, %.3f ms max\n",
+         1000.0 * s.latencySum / s.frames, 1000.0 * s.latencyMax);
+}
+
+
+// The far end of the loopback.  Each byte read is matched up with the next
+// byte written, and has to be the same.  A frame may not start until the one
+// before it has had its wire time.
+void *LoopbackReader(void *arg) {
+  unsigned char buffer[4096];
+  int n, i, position = 0;
+  double now, interval, lastStart = -1, lastWire = 0;
+  expected_t *e;
+
+  FOREVER {
+    n = read(loopbackFd, buffer, sizeof(buffer));
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    now = Now();
+
+    pthread_mutex_lock(&ttyLock);
+    for (i = 0; i < n; i++) {
+      stats.bytes++;
+      if (expectedTail == expectedHead) {
+        stats.byteErrors++;  // Nothing was written.
+        continue;
+      }
+      e = &expected[expectedTail % EXPECTED_FRAMES];
+
+      // Start of a frame.  A little slack for the scheduler.
+      if (position == 0) {
+        if (lastStart >= 0) {
+          interval = now - lastStart;
+          stats.intervalSum += interval;
+          stats.wireSum += lastWire;
+          if (interval < stats.intervalMin) stats.intervalMin = interval;
+          if (interval > stats.intervalMax) stats.intervalMax = interval;
+          if (interval < (lastWire * 0.9)) stats.early++;
+        }
+        lastStart = now;
+        lastWire = e->wireTime;
+      }
+
+      if (buffer[i] != e->bytes[position]) stats.byteErrors++;
+
+      // End of a frame.
+      if (++position >= e->length) {
+        stats.frames++;
+        stats.latencySum += now - e->written;
+        if ((now - e->written) > stats.latencyMax) stats.latencyMax = now - e->written;
+        free(e->bytes);
+        expectedTail++;
+        position = 0;
+        pthread_cond_broadcast(&ttyCond);
+      }
+    }
+    pthread_mutex_unlock(&ttyLock);
+  }
+
+  return NULL;
+}
+
+
+static double Now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+#endif /* EMULATE */
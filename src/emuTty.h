@@ -0,0 +1,31 @@
+// File:   emuTty.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Serial output to a real tty for the EMULATE target.
+
+#ifndef EMUTTY_H
+#define	EMUTTY_H
+
+  #include "display.h"
+
+  // Loopback statistics, gathered by the reader on the far end of a pty.
+  // Times are in seconds.
+  typedef struct {
+    long int frames;        // Frames received.
+    long int bytes;         // Bytes received.
+    long int byteErrors;    // Bytes that weren't what was written.
+    long int early;         // Frames that started before the last one's wire time was up.
+    double intervalMin, intervalMax, intervalSum;  // Start to start.
+    double wireSum;         // Wire time of the frames those intervals follow.
+    double latencyMax, latencySum;  // write() to last byte read.
+  } ttyStats_t;
+
+  // Prototypes
+  int EmuTtyOpen(const char *device);
+  int EmuTtyLoopback(void);
+  int EmuTtyIsOpen(void);
+  void EmuTtyWrite(const packet_t *packet, double wireTime);
+  void EmuTtyPrintStats(void);
+
+#endif	/* EMUTTY_H */
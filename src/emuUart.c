@@ -0,0 +1,175 @@
+// File: emuUart.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Emulated USART transmitter.  On the PIC, the transmit interrupt shifts a
+// packet out in the background while the pattern code works on the next frame.
+// This models the same thing with a thread that takes a packet and holds onto
+// it for as long as the real serial port would need to shift it out at our baud
+// rate (BIT_RATE, 83.3 kbps).  The master blocks only if it hands over a new
+// packet before the last one is finished, just like it does on the PIC.
+
+#ifdef EMULATE
+
+// Includes
+#include "deviceConfig.h"
+#include "galaxyConfig.h"
+#include "emuUart.h"
+#include "emuSlave.h"
+#include "emuTty.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+// Globals
+static pthread_t uartThread;
+static pthread_mutex_t uartLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t uartCond = PTHREAD_COND_INITIALIZER;
+static const packet_t *txPacket = NULL;  // Packet being shifted out, or NULL.
+static float timeScale = 1.0;            // Emulation speed (1.0 is real time).
+static uartStats_t stats;
+
+// Prototypes
+void *UartThread(void *arg);
+static double TimespecToSeconds(const struct timespec *t);
+static void AddSeconds(struct timespec *t, double s);
+
+
+// Start the transmitter thread.
+void EmuUartInit(void) {
+  if (pthread_create(&uartThread, NULL, UartThread, NULL) != 0) {
+    fprintf(stderr, "Unable to start the emulated UART thread!\n");
+    return;
+  }
+  pthread_detach(uartThread);
+}
+
+
+// Hand a packet to the transmitter.  Like the PIC version of TransmitPacket(),
+// this waits for the previous packet to finish, then returns as soon as the new
+// one has started going out.  The packet must be left alone until the next
+// call, which is why WriteLights() double buffers.
+void EmuUartSend(const packet_t *packet) {
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_mutex_lock(&uartLock);
+  while (txPacket != NULL) {
+    pthread_cond_wait(&uartCond, &uartLock);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  stats.stallTime += TimespecToSeconds(&end) - TimespecToSeconds(&start);
+
+  txPacket = packet;
+  pthread_cond_broadcast(&uartCond);
+  pthread_mutex_unlock(&uartLock);
+}
+
+
+// Set the emulation speed.  Wire time is multiplied by the scale, so 2.0 is
+// half speed and 0 shifts packets out instantly.
+void EmuUartSetTimeScale(float scale) {
+  pthread_mutex_lock(&uartLock);
+  timeScale = scale;
+  pthread_mutex_unlock(&uartLock);
+}
+
+
+// Copy out the link statistics.
+void EmuUartGetStats(uartStats_t *s) {
+  pthread_mutex_lock(&uartLock);
+  *s = stats;
+  pthread_mutex_unlock(&uartLock);
+}
+
+
+// Print a summary of how busy the link was and how long the master waited on
+// it.  If the link is busy nearly all the time and the master spends most of
+// each frame stalled, pattern computation is completely hidden by the wire.
+void EmuUartPrintStats(void) {
+  uartStats_t s;
+  double total;
+
+  EmuUartGetStats(&s);
+  total = s.busyTime + s.idleTime;
+  if ((s.packets == 0) || (total <= 0)) {
+    return;
+  }
+
+  printf("Serial link: %li packets, %li bytes, %.1f bytes/packet\n",
+         s.packets, s.bytes, (double) s.bytes / s.packets);
+  printf("  Link busy %.1f%% of the time, %.2f ms/packet on the wire\n",
+         100.0 * s.busyTime / total, 1000.0 * s.busyTime / s.packets);
+  printf("  Master stalled on the link %.2f ms/packet (compute overlapped with transmit)\n",
+         1000.0 * s.stallTime / s.packets);
+}
+
+
+// The transmitter.  Waits for a packet, then sleeps until the time the last
+// stop bit would have left the port.  Transmission of a packet starts either
+// when it is handed over, or when the previous packet ends, whichever is later,
+// so wire time never drifts due to scheduling.
+void *UartThread(void *arg) {
+  struct timespec lineFree, now;
+  double wireTime, waitStart, nowS;
+  const packet_t *packet;
+
+  clock_gettime(CLOCK_MONOTONIC, &lineFree);
+
+  FOREVER {
+    // Wait for a packet.
+    pthread_mutex_lock(&uartLock);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    waitStart = TimespecToSeconds(&now);
+    while (txPacket == NULL) {
+      pthread_cond_wait(&uartCond, &uartLock);
+    }
+    packet = txPacket;
+    wireTime = packet->length * BITS_PER_BYTE * BIT_RATE * timeScale;
+    pthread_mutex_unlock(&uartLock);
+
+    // If the line has been idle, the packet starts now.
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    nowS = TimespecToSeconds(&now);
+    if (TimespecToSeconds(&lineFree) < nowS) {
+      lineFree = now;
+    }
+    AddSeconds(&lineFree, wireTime);
+
+    // Out a real serial port too, if there is one.  The port has its own
+    // buffer, so this returns right away unless we've gotten ahead of it.
+    EmuTtyWrite(packet, wireTime);
+
+    // Shift it out.  The slaves act on it once the last byte has arrived.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &lineFree, NULL) != 0);
+    EmuSlavesReceive(packet);
+
+    // Done - free the buffer and wake up the master if it is waiting.
+    pthread_mutex_lock(&uartLock);
+    stats.packets++;
+    stats.bytes += packet->length;
+    stats.busyTime += wireTime;
+    stats.idleTime += nowS - waitStart;
+    txPacket = NULL;
+    pthread_cond_broadcast(&uartCond);
+    pthread_mutex_unlock(&uartLock);
+  }
+
+  return NULL;
+}
+
+
+// Timespec helpers.
+static double TimespecToSeconds(const struct timespec *t) {
+  return t->tv_sec + (t->tv_nsec / 1e9);
+}
+
+static void AddSeconds(struct timespec *t, double s) {
+  long int ns;
+
+  ns = t->tv_nsec + (long int) (s * 1e9);
+  t->tv_sec += ns / 1000000000L;
+  t->tv_nsec = ns % 1000000000L;
+}
+
+#endif /* EMULATE */
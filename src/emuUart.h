@@ -0,0 +1,29 @@
+// File:   emuUart.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Emulated USART transmitter for the EMULATE target.
+
+#ifndef EMUUART_H
+#define	EMUUART_H
+
+  #include "display.h"
+
+  // Link statistics, for judging whether pattern computation is hidden behind
+  // the wire time.  All times are in seconds.
+  typedef struct {
+    long int packets;     // Packets shifted out.
+    long int bytes;       // Bytes shifted out.
+    double busyTime;      // Time the transmitter spent shifting bits.
+    double idleTime;      // Time the transmitter sat waiting for a packet.
+    double stallTime;     // Time the master sat waiting for the transmitter.
+  } uartStats_t;
+
+  // Prototypes
+  void EmuUartInit(void);
+  void EmuUartSend(const packet_t *packet);
+  void EmuUartSetTimeScale(float scale);
+  void EmuUartGetStats(uartStats_t *stats);
+  void EmuUartPrintStats(void);
+
+#endif	/* EMUUART_H */
@@ -0,0 +1,321 @@
+// File: emuVideo.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Video export.  Draws the galaxy the way the emulator window does, into
+// frames of a given size and rate, and streams them to a file or stdout, so a
+// run can be reviewed (or turned into an mp4 with ffmpeg) without screen
+// capture.  The format comes from the file name:
+// - .y4m, or "-" for stdout - YUV4MPEG2, 4:2:0.  ffmpeg and most players take
+//   it as is.
+// - .ppm - A stream of binary PPM images.
+// - Anything else - Raw 24 bit RGB, no headers.
+// If the video goes to stdout, the emulator's own messages go to stderr.
+//
+// Video frames are evenly spaced in galaxy time, so each one shows whatever the
+// lights were showing at that moment.  A galaxy frame that lasts a while ends
+// up in several video frames, and a quick one may not make it into any.
+//
+// Drawing and writing are pipelined.  The caller draws frames into a ring of
+// SLOT_COUNT frame buffers, and a writer thread converts and writes them out
+// in order, so the next frame is drawn while the last is being written.  The
+// background of every buffer is black from the start, and the squares are in
+// the same place every frame, so drawing a frame is just filling in the
+// squares.
+
+#ifdef EMULATE
+
+// Includes
+#include "galaxyConfig.h"
+#include "emuVideo.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Defines
+#define SLOT_COUNT 3
+
+// Types
+typedef enum { VIDEO_Y4M, VIDEO_PPM, VIDEO_RGB } videoFormat_e;
+
+// Globals
+static FILE *videoFile = NULL;
+static videoFormat_e format;
+static int width, height, frameRate;
+static const emuPoint_t *layout;
+static int squareSize, pixels;
+static color_t *current = NULL;        // What the lights are showing now.
+static long int framesOut = 0;         // Frames drawn so far.
+static long int bytesOut = 0;
+static unsigned char *slots[SLOT_COUNT];
+static unsigned char *yuv = NULL;      // Writer thread's conversion buffer.
+static int head = 0, tail = 0, filled = 0;
+static unsigned char finished = FALSE, failed = FALSE;
+static pthread_t videoThread;
+static pthread_mutex_t videoLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t videoCond = PTHREAD_COND_INITIALIZER;
+
+// Prototypes
+void *VideoThread(void *arg);
+static void Submit(void);
+static void Draw(unsigned char *frame);
+static void Encode(const unsigned char *frame);
+
+
+// Open a video.  map is the layout of the pixels in a w by h frame, and
+// pixSize their size (see LayoutPixels() in master.c).  Returns 0 if
+// successful.
+int EmuVideoOpen(const char *path, int w, int h, int fps,
+                 const emuPoint_t *map, int pixSize, int pixelCount) {
+  int i, fd;
+  const char *extension;
+
+  // 4:2:0 needs even sizes.
+  width = w & ~1;
+  height = h & ~1;
+  frameRate = fps;
+  if ((width < 2) || (height < 2) || (frameRate < 1)) {
+    fprintf(stderr, "Bad video size or frame rate!\n");
+    return -1;
+  }
+  layout = map;
+  squareSize = pixSize;
+  pixels = pixelCount;
+
+  extension = strrchr(path, '.');
+  if ((strcmp(path, "-") == 0) || ((extension != NULL) && (strcmp(extension, ".y4m") == 0))) {
+    format = VIDEO_Y4M;
+  } else if ((extension != NULL) && (strcmp(extension, ".ppm") == 0)) {
+    format = VIDEO_PPM;
+  } else {
+    format = VIDEO_RGB;
+  }
+
+  // The video gets stdout to itself.
+  if (strcmp(path, "-") == 0) {
+    fflush(stdout);
+    fd = dup(STDOUT_FILENO);
+    if ((fd < 0) || (dup2(STDERR_FILENO, STDOUT_FILENO) < 0)) {
+      fprintf(stderr, "Unable to take over stdout for the video!\n");
+      return -1;
+    }
+    videoFile = fdopen(fd, "wb");
+  } else {
+    videoFile = fopen(path, "wb");
+  }
+  if (videoFile == NULL) {
+    fprintf(stderr, "Unable to write video to \"%s\"!\n", path);
+    return -1;
+  }
+
+  current = calloc(pixels, sizeof(color_t));
+  yuv = malloc(width * height * 3 / 2);
+  for (i = 0; i < SLOT_COUNT; i++) {
+    slots[i] = calloc(width * height, BYTES_PER_PIXEL);
+    if (slots[i] == NULL) {
+      break;
+    }
+  }
+  if ((current == NULL) || (yuv == NULL) || (i < SLOT_COUNT)) {
+    fprintf(stderr, "Unable to allocate the video frames!\n");
+    return -1;
+  }
+
+  if (format == VIDEO_Y4M) {
+    bytesOut += fprintf(videoFile, "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg\n",
+                        width, height, frameRate);
+  }
+
+  if (pthread_create(&videoThread, NULL, VideoThread, NULL) != 0) {
+    fprintf(stderr, "Unable to start the video thread!\n");
+    fclose(videoFile);
+    videoFile = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+
+int EmuVideoIsOpen(void) {
+  return (videoFile != NULL);
+}
+
+
+// The lights changed to leds at t seconds of galaxy time.  Any video frames
+// due before then show what they were showing up until now.
+void EmuVideoFrame(const color_t *leds, double t) {
+  if (videoFile == NULL) {
+    return;
+  }
+  while (((double) framesOut / frameRate) < t) {
+    Submit();
+  }
+  memcpy(current, leds, pixels * sizeof(color_t));
+}
+
+
+// Write out the last frame, wait for the writer to finish, and close the file.
+void EmuVideoClose(void) {
+  if (videoFile == NULL) {
+    return;
+  }
+  Submit();
+
+  pthread_mutex_lock(&videoLock);
+  finished = TRUE;
+  pthread_cond_broadcast(&videoCond);
+  pthread_mutex_unlock(&videoLock);
+  pthread_join(videoThread, NULL);
+
+  if ((fclose(videoFile) != 0) || failed) {
+    fprintf(stderr, "Unable to finish writing the video!\n");
+  } else {
+    printf("Video: %li frames, %ix%i at %i fps (%.2f s), %.1f MB\n", framesOut,
+           width, height, frameRate, (double) framesOut / frameRate,
+           bytesOut / 1e6);
+  }
+  videoFile = NULL;
+}
+
+
+// Draw the current picture into the next free slot and queue it for writing.
+// Waits if the writer is SLOT_COUNT frames behind.
+static void Submit(void) {
+  int slot;
+
+  pthread_mutex_lock(&videoLock);
+  while (filled == SLOT_COUNT) {
+    pthread_cond_wait(&videoCond, &videoLock);
+  }
+  slot = head;
+  pthread_mutex_unlock(&videoLock);
+
+  // The writer leaves the slot alone until it's counted as filled.
+  Draw(slots[slot]);
+
+  pthread_mutex_lock(&videoLock);
+  head = (head + 1) % SLOT_COUNT;
+  filled++;
+  framesOut++;
+  pthread_cond_broadcast(&videoCond);
+  pthread_mutex_unlock(&videoLock);
+}
+
+
+// Fill in each pixel's square in an RGB frame.
+static void Draw(unsigned char *frame) {
+  int i, x, y, x0, x1, y0, y1;
+  unsigned char *p;
+
+  for (i = 0; i < pixels; i++) {
+    x0 = layout[i].x - squareSize;
+    x1 = layout[i].x + squareSize;
+    y0 = layout[i].y - squareSize;
+    y1 = layout[i].y + squareSize;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= width) x1 = width - 1;
+    if (y1 >= height) y1 = height - 1;
+    for (y = y0; y <= y1; y++) {
+      p = frame + (((y * width) + x0) * BYTES_PER_PIXEL);
+      for (x = x0; x <= x1; x++) {
+        *p++ = current[i].r;
+        *p++ = current[i].g;
+        *p++ = current[i].b;
+      }
+    }
+  }
+}
+
+
+// The writer.  Converts and writes out the frames in the order they were
+// drawn, until the video is closed.
+void *VideoThread(void *arg) {
+  int slot;
+
+  FOREVER {
+    pthread_mutex_lock(&videoLock);
+    while ((filled == 0) && !finished) {
+      pthread_cond_wait(&videoCond, &videoLock);
+    }
+    if (filled == 0) {
+      pthread_mutex_unlock(&videoLock);
+      break;
+    }
+    slot = tail;
+    pthread_mutex_unlock(&videoLock);
+
+    if (!failed) {
+      Encode(slots[slot]);
+    }
+
+    pthread_mutex_lock(&videoLock);
+    tail = (tail + 1) % SLOT_COUNT;
+    filled--;
+    pthread_cond_broadcast(&videoCond);
+    pthread_mutex_unlock(&videoLock);
+  }
+  return NULL;
+}
+
+
+// Write a frame out in the video's format.  Y4M is converted to full range
+// BT.601 (what C420jpeg means), each chroma sample from the average of 2x2
+// pixels.
+static void Encode(const unsigned char *frame) {
+  int x, y, r, g, b, size;
+  const unsigned char *p, *q;
+  unsigned char *yp, *up, *vp;
+  char header[32];
+
+  size = width * height * BYTES_PER_PIXEL;
+  switch (format) {
+    case VIDEO_PPM:
+      snprintf(header, sizeof(header), "P6\n%i %i\n255\n", width, height);
+      if ((fputs(header, videoFile) == EOF) ||
+          (fwrite(frame, size, 1, videoFile) != 1)) {
+        failed = TRUE;
+      }
+      bytesOut += strlen(header) + size;
+      break;
+
+    case VIDEO_RGB:
+      if (fwrite(frame, size, 1, videoFile) != 1) {
+        failed = TRUE;
+      }
+      bytesOut += size;
+      break;
+
+    case VIDEO_Y4M:
+    default:
+      yp = yuv;
+      for (p = frame; p < frame + size; p += BYTES_PER_PIXEL) {
+        *yp++ = ((77 * p[0]) + (150 * p[1]) + (29 * p[2]) + 128) >> 8;
+      }
+      up = yuv + (width * height);
+      vp = up + (width * height / 4);
+      for (y = 0; y < height; y += 2) {
+        p = frame + (y * width * BYTES_PER_PIXEL);
+        q = p + (width * BYTES_PER_PIXEL);
+        for (x = 0; x < width; x += 2) {
+          r = (p[0] + p[3] + q[0] + q[3] + 2) >> 2;
+          g = (p[1] + p[4] + q[1] + q[4] + 2) >> 2;
+          b = (p[2] + p[5] + q[2] + q[5] + 2) >> 2;
+          *up++ = ((-43 * r) - (85 * g) + (128 * b) + 32768) >> 8;
+          *vp++ = ((128 * r) - (107 * g) - (21 * b) + 32768) >> 8;
+          p += 2 * BYTES_PER_PIXEL;
+          q += 2 * BYTES_PER_PIXEL;
+        }
+      }
+      if ((fputs("FRAME\n", videoFile) == EOF) ||
+          (fwrite(yuv, width * height * 3 / 2, 1, videoFile) != 1)) {
+        failed = TRUE;
+      }
+      bytesOut += 6 + (width * height * 3 / 2);
+      break;
+  }
+}
+
+#endif /* EMULATE */
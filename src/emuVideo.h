@@ -0,0 +1,22 @@
+// File:   emuVideo.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Video export of the emulator's picture of the galaxy for the EMULATE target.
+
+#ifndef EMUVIDEO_H
+#define	EMUVIDEO_H
+
+  #include "galaxyConfig.h"
+
+  // Where a pixel is drawn, in the window or a video frame.
+  typedef struct { int x, y; } emuPoint_t;
+
+  // Prototypes
+  int EmuVideoOpen(const char *path, int w, int h, int fps,
+                   const emuPoint_t *map, int pixSize, int pixelCount);
+  int EmuVideoIsOpen(void);
+  void EmuVideoFrame(const color_t *leds, double t);
+  void EmuVideoClose(void);
+
+#endif	/* EMUVIDEO_H */
@@ -12,7 +12,10 @@
   #define FALSE 0
   #define TRUE 1
 
-  // Hardware defines. There are 42 LED triplets total, 21 on each arm.
+  // Hardware defines. There are 42 LED triplets total, 21 on each arm.  These
+  // describe the galaxy itself (see galaxyTopology in topology.c) and size the
+  // PIC's buffers.  Anything that walks the lights should go by the galaxy's
+  // topology instead, so that it works for any size of installation.
   #define PIXEL_COUNT 42
   #define ARM_COUNT 2
   #define PIXELS_PER_ARM (PIXEL_COUNT / ARM_COUNT)
@@ -26,6 +29,19 @@
   #define BITS_PER_BYTE 11  // USART 9 bit addressing - 1 Start, 8 Data, 1 Address select, 1 Stop
   #define PACKET_TIME (PACKET_BYTES * BITS_PER_BYTE * BIT_RATE * 1000)  // ms
 
+  // Slave firmware support for the broadcast address (0x00), its commands
+  // (including global brightness) and compressed blocks (ENCODED_BLOCK, see
+  // display.h).  The slaves on the galaxy only know plain address and data
+  // runs, so the PIC leaves these off until they've been reflashed with
+  // support for them.  The emulator's slaves (see emuSlave.c) have it.
+  #ifndef SLAVE_EXTENSIONS
+    #ifdef EMULATE
+      #define SLAVE_EXTENSIONS TRUE
+    #else
+      #define SLAVE_EXTENSIONS FALSE
+    #endif
+  #endif
+
   // Convenience types
   // Color channels - Placing CHANNEL_COUNT at the end automatically makes this
   // enumeration value available to use as the proper count.
@@ -41,17 +57,38 @@
                                         // using an anonymous struct.
   } color_t;
 
+  // A slave and the run of pixel triplets it drives.  Pixels are numbered as
+  // in MAP_FULL (see display.h).
+  typedef struct {
+    unsigned char address;  // Slave address on the serial bus.
+    int first;              // First pixel driven by the slave.
+    int count;              // Number of pixel triplets driven by the slave.
+    int step;               // Distance from one pixel to the next.
+    colorChannel_e byteOrder[BYTES_PER_PIXEL];  // Order the slave wants each
+                                                // triplet's bytes in.
+  } slave_t;
+
+  // The layout of the lights.  Pixels are numbered arm by arm, armCount *
+  // pixelsPerArm of them.  Even numbered arms run from the tip in to the
+  // center, odd numbered arms from the center out to the tip, so the pixel
+  // array snakes in and out through the center of the galaxy.  The slaves
+  // are listed in the order they are addressed on the wire.
+  typedef struct {
+    int armCount;
+    int pixelsPerArm;
+    int slaveCount;
+    const slave_t *slaves;
+  } topology_t;
+
   // The galaxy's pixel array.  Note this is only an array of pointers.  The
   // actual pixels must be seperately allocated (see main() in master.c).
   typedef struct {
-    color_t *pixels[PIXEL_COUNT];  // Array of pointers to the galaxy's pixels.
+    color_t **pixels;  // Array of pointers to the galaxy's pixels.
     int size;
+    const topology_t *topology;  // How the pixels are laid out and wired.
   } galaxyData_t;
 
+  // Pixels per arm of a galaxy.
+  #define ARM_SIZE(galaxy) ((galaxy)->topology->pixelsPerArm)
 
-  // So that Delay() can be used outside of master.c
-  #ifndef _MAIN_C_
-  extern void Delay(long int d);  
-  #endif
-  
 #endif	/* GALAXY_H */
@@ -13,13 +13,23 @@ void HardwareInit(void) {
 #ifndef EMULATE
 
   // Assign the I/O port senses.  On startup, all ports default to input (1).
-  DEBUG_LED_PORTCTRL = PORT_OUTPUT;  // Address transmit LED (for debug).
+  DEBUG_LED_PORTCTRL = PORT_OUTPUT;  // Transmit wait LED (for debug).
 
-  // Open the serial port
+  // Open the serial port.  The transmit interrupt starts off.  TransmitPacket()
+  // turns it on for each packet, and the ISR turns it back off when done.
   OpenUSART(USART_TX_INT_OFF  & USART_RX_INT_OFF & \
             USART_ASYNCH_MODE & USART_NINE_BIT & \
             BAUDMODE, BAUDVALUE_X);
 
+  // Start the frame hold timer (see HoldFrame() in master.c).  It just runs,
+  // and the pattern loop reads it.
+  OpenTimer0(TIMER_INT_OFF & T0_16BIT & T0_SOURCE_INT & T0_PS_1_64);
+
+  // Interrupts.  Single priority (compatibility) mode, peripherals enabled.
+  RCONbits.IPEN = 0;
+  INTCONbits.PEIE = 1;
+  INTCONbits.GIE = 1;
+
 #endif /* EMULATE */
 
 }
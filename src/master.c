@@ -28,13 +28,31 @@
 #include "galaxyConfig.h"   // Useful defines, galaxy specifics, coefficients
 #include "init.h"           // Hardware initialization functions
 #include "display.h"        // Display output functions
+#include "topology.h"       // Light layouts
 #include "patternSupport.h"         // Pattern support - array manipulations.
+#include "playlist.h"       // Which pattern next, and for how long.
 #include "pattern.h"
+#include "composite.h"      // Pattern layers.
+#include "transition.h"     // Crossfades between patterns.
+#include "vm.h"             // Pattern programs.
+#include "master.h"         // Pattern states, and what the run modes share.
 #include <stdlib.h>         // srand(), rand(), exit(), EXIT_SUCCESS
 
+// Layers there's room for.  The PIC runs all PATTERN_LAYERS of them, the
+// emulator as many of its MAX_LAYERS as it's asked to (--layers).
+#ifdef EMULATE
+  #define LAYERS MAX_LAYERS
+#else
+  #define LAYERS PATTERN_LAYERS
+#endif
+
 // Function Prototypes
 void GeneratePattern(galaxyData_t *galaxy);
-void Delay (long int d);
+void InitPatternStates(arena_t *arena, void *state[]);
+int NextPattern(playlist_t *playlist, void *state[]);
+color_t *InitLayers(galaxyData_t *galaxy, layer_t *layers, int count);
+void ChooseOverlays(layer_t *layers, int *patterns, int count, void *state[]);
+void HoldFrame(long int us);
 
 // Emulation support
 #ifdef EMULATE
@@ -43,12 +61,23 @@ void Delay (long int d);
 #include <SDL.h>
 #include <SDL2_gfxPrimitives.h>
 #include <math.h> // sin(), cos(), M_PI
-#include <time.h> // timespec, nanosleep()
+#include <time.h> // clock_gettime()
 #include "version.h"
-
-// Types
-typedef struct { int x, y; } emuPoint_t;
-typedef enum { DOEXIT, DONOTHING, DONEXTPATTERN, DOPAUSE } command_e;
+#include "emuUart.h"
+#include "emuSlave.h"
+#include "emuTty.h"
+#include "emuNet.h"
+#include "emuClock.h"
+#include "emuFrames.h"
+#include "emuCommand.h"
+#include "emuRecord.h"
+#include "emuVideo.h"
+#include "emuFleet.h"
+#include "emuBake.h"
+#include "emuAsm.h"
+#include "emuPlugin.h"
+#include "emuModes.h"
+#include <pthread.h>
 
 // Defines
 #define MARGIN_PERCENTAGE 0.08     // Margin around the galaxy diagram.
@@ -56,52 +85,337 @@ typedef enum { DOEXIT, DONOTHING, DONEXTPATTERN, DOPAUSE } command_e;
 #define INITIAL_WINDOW_HEIGHT 432  // Initial window height
 #define PIX_SIZE 5                 // Emu pixel size is a square with sides PIX_SIZE * 2
 
+// SDL 2.0.18 and up can draw every pixel in a single call to the renderer.
+// Older versions draw them one box at a time.
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  #define EMU_GEOMETRY
+#endif
+
 // Globals
 SDL_Window *sdlWindow = NULL;
 SDL_Renderer *sdlRenderer = NULL;
-emuPoint_t pixelMap[PIXEL_COUNT];
+const topology_t *emuTopology = NULL;  // Layout being emulated.
+emuPoint_t *pixelMap = NULL;           // Window position of each pixel.
+int pixSize = PIX_SIZE;
+#ifdef EMU_GEOMETRY
+SDL_Vertex *emuVertices = NULL;        // 4 corners for each pixel.
+int *emuIndices = NULL;                // 2 triangles for each pixel.
+#endif
 int delayMultiplier = 10;
+int speedSetting = 10;                  // The display thread's delayMultiplier.
+int brightness = 255;
+int layerCount = 1;                     // Pattern layers to run (--layers).
+int transitionFrames = TRANSITION_FRAMES;  // Crossfade length (--transition).
+long int fadeFrames = 0;                // Crossfade frames run...
+double fadeNs = 0;                      // ... and the extra time they took.
+long int patternFrames[PATTERN_COUNT];  // Frames run, by pattern.
+long int patternBytes[PATTERN_COUNT];   // Bytes sent to the slaves, by pattern.
+unsigned char *vmProgram = NULL;        // Pattern program to run (--vm).
+long int playlistClock = -1;            // Time of day to start at (--clock).
+unsigned char rawSlaves = FALSE;        // Real slaves on the line (--tty).
 
 // Prototypes
 command_e HandleEvents(void);
+void PostCommand(command_e command, int value);
 void GeneratePixelMap(int w, int h);
-void UpdateEmuOutput(galaxyData_t *gData, outputMapping_e mapType);
-Uint32 ExpireTimer(Uint32 interval, void *param);
-void DelayINSTR(int instructionCount);
-void DelayMS(int ms);
+int LayoutPixels(int w, int h, emuPoint_t *map);
+void UpdateEmuOutput(const color_t *leds);
+void Present(galaxyData_t *galaxy);
+void *PatternThread(void *arg);
+void PrintWireStats(galaxyData_t *galaxy);
+void DelayMS(double ms);
 void WindowTitle(int dMult);
 
 #endif /* EMULATE */
 
 
 // Main - Set things up, call the pattern generator.
+#ifdef EMULATE
+int main (int argc, char *argv[]) {
+#else
 int main (void) {
+#endif
 
   int i;
 
   // Reserve the pixel data memory.
-  galaxyData_t galaxy;                // Contains an array of pointers to pixels.
-  color_t actualPixels[PIXEL_COUNT];  // Sets aside memory for the actual pixels.
+  galaxyData_t galaxy;                  // Contains an array of pointers to pixels.
+#ifdef EMULATE
+  color_t *actualPixels;                // The emulator sizes these to the
+  color_t **pixelPointers;              // topology, below.
+#ifdef EMU_GEOMETRY
+  int j;
+#endif
+  unsigned char wireBenchmark = FALSE;
+  const char *bakePath = NULL;
+  unsigned char blendBenchmark = FALSE;
+  unsigned char mathBenchmark = FALSE;
+  unsigned char transitionCheck = FALSE;
+  unsigned char headless = FALSE;
+  long int headlessFrames = -1;
+  double headlessSeconds = -1;
+  int fleetCount = 0, fleetThreads = 0;
+  unsigned char fleetPaced = TRUE;
+  unsigned int seed = 25;
+  unsigned char ttyLoopback = FALSE;
+  const char *ttyDevice = NULL;
+  const char *netHost = NULL;
+  netProtocol_e netProtocol = NET_E131;
+  const char *recordPath = NULL;
+  const char *playPath = NULL;
+  double playFrom = 0;
+  const char *videoPath = NULL;
+  int videoWidth = INITIAL_WINDOW_WIDTH, videoHeight = INITIAL_WINDOW_HEIGHT;
+  int videoRate = 30;
+  const char *vmPath = NULL;
+  const char *vmBenchmarkDir = NULL;
+  const char *assemblePath = NULL;
+  const char *pluginDir = NULL;
+  unsigned int vmLength;
+  emuPoint_t *videoMap;
+  int hours, minutes;
+  time_t now;
+  struct tm *local;
+#else
+  color_t actualPixels[PIXEL_COUNT];    // Sets aside memory for the actual pixels.
+  color_t *pixelPointers[PIXEL_COUNT];  // And for the pointers to them.
+#endif
 
-  galaxy.size = PIXEL_COUNT;
+  galaxy.topology = &galaxyTopology;
+
+#ifdef EMULATE
+  // Command line options.
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "--topology") == 0) && (i + 1 < argc)) {
+      galaxy.topology = ParseTopology(argv[++i]);
+      if (galaxy.topology == NULL) {
+        exit(EXIT_FAILURE);
+      }
+    } else if (strcmp(argv[i], "--wire-benchmark") == 0) {
+      wireBenchmark = TRUE;
+    } else if ((strcmp(argv[i], "--bake") == 0) && (i + 1 < argc)) {
+      bakePath = argv[++i];
+    } else if (strcmp(argv[i], "--blend-benchmark") == 0) {
+      blendBenchmark = TRUE;
+    } else if (strcmp(argv[i], "--math-benchmark") == 0) {
+      mathBenchmark = TRUE;
+    } else if ((strcmp(argv[i], "--vm") == 0) && (i + 1 < argc)) {
+      vmPath = argv[++i];
+    } else if ((strcmp(argv[i], "--vm-benchmark") == 0) && (i + 1 < argc)) {
+      vmBenchmarkDir = argv[++i];
+    } else if ((strcmp(argv[i], "--assemble") == 0) && (i + 2 < argc)) {
+      vmPath = argv[++i];
+      assemblePath = argv[++i];
+    } else if ((strcmp(argv[i], "--plugins") == 0) && (i + 1 < argc)) {
+      pluginDir = argv[++i];
+    } else if (strcmp(argv[i], "--transition-check") == 0) {
+      transitionCheck = TRUE;
+    } else if ((strcmp(argv[i], "--transition") == 0) && (i + 1 < argc)) {
+      transitionFrames = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--layers") == 0) && (i + 1 < argc)) {
+      layerCount = atoi(argv[++i]);
+      if ((layerCount < 1) || (layerCount > MAX_LAYERS)) {
+        fprintf(stderr, "--layers should be from 1 to %i\n", MAX_LAYERS);
+        exit(EXIT_FAILURE);
+      }
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = TRUE;
+    } else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc)) {
+      headlessFrames = atol(argv[++i]);
+    } else if ((strcmp(argv[i], "--seconds") == 0) && (i + 1 < argc)) {
+      headlessSeconds = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) {
+      seed = strtoul(argv[++i], NULL, 0);
+    } else if ((strcmp(argv[i], "--fleet") == 0) && (i + 1 < argc)) {
+      fleetCount = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+      fleetThreads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--unpaced") == 0) {
+      fleetPaced = FALSE;
+    } else if ((strcmp(argv[i], "--tty") == 0) && (i + 1 < argc)) {
+      ttyDevice = argv[++i];
+    } else if (strcmp(argv[i], "--tty-loopback") == 0) {
+      ttyLoopback = TRUE;
+    } else if (((strcmp(argv[i], "--e131") == 0) ||
+                (strcmp(argv[i], "--artnet") == 0)) && (i + 1 < argc)) {
+      netProtocol = (argv[i][2] == 'e') ? NET_E131 : NET_ARTNET;
+      netHost = argv[++i];
+    } else if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc)) {
+      recordPath = argv[++i];
+    } else if ((strcmp(argv[i], "--play") == 0) && (i + 1 < argc)) {
+      playPath = argv[++i];
+    } else if ((strcmp(argv[i], "--from") == 0) && (i + 1 < argc)) {
+      playFrom = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "--video") == 0) && (i + 1 < argc)) {
+      videoPath = argv[++i];
+    } else if ((strcmp(argv[i], "--video-size") == 0) && (i + 1 < argc)) {
+      if (sscanf(argv[++i], "%ix%i", &videoWidth, &videoHeight) != 2) {
+        fprintf(stderr, "Video size should be WIDTHxHEIGHT\n");
+        exit(EXIT_FAILURE);
+      }
+    } else if ((strcmp(argv[i], "--video-fps") == 0) && (i + 1 < argc)) {
+      videoRate = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--clock") == 0) && (i + 1 < argc)) {
+      if ((sscanf(argv[++i], "%d:%d", &hours, &minutes) != 2) ||
+          (hours < 0) || (hours > 23) || (minutes < 0) || (minutes > 59)) {
+        fprintf(stderr, "Clock should be HH:MM\n");
+        exit(EXIT_FAILURE);
+      }
+      playlistClock = (hours * 3600L) + (minutes * 60L);
+    } else {
+      fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Size everything to the topology.
+  emuTopology = galaxy.topology;
+  i = GetPixelCount(emuTopology);
+  actualPixels = malloc(i * sizeof(color_t));
+  pixelPointers = malloc(i * sizeof(color_t *));
+  pixelMap = malloc(i * sizeof(emuPoint_t));
+  if ((actualPixels == NULL) || (pixelPointers == NULL) ||
+      (pixelMap == NULL) || (EmuFramesInit(i) != 0)) {
+    fprintf(stderr, "Unable to allocate %i pixels!\n", i);
+    exit(EXIT_FAILURE);
+  }
+#ifdef EMU_GEOMETRY
+  emuVertices = calloc(i * 4, sizeof(SDL_Vertex));
+  emuIndices = malloc(i * 6 * sizeof(int));
+  if ((emuVertices == NULL) || (emuIndices == NULL)) {
+    fprintf(stderr, "Unable to allocate %i pixels!\n", i);
+    exit(EXIT_FAILURE);
+  }
+
+  // The corners go top left, top right, bottom right, bottom left, and the
+  // triangles never change.
+  for (j = 0; j < i; j++) {
+    emuIndices[j * 6 + 0] = j * 4 + 0;
+    emuIndices[j * 6 + 1] = j * 4 + 1;
+    emuIndices[j * 6 + 2] = j * 4 + 2;
+    emuIndices[j * 6 + 3] = j * 4 + 0;
+    emuIndices[j * 6 + 4] = j * 4 + 2;
+    emuIndices[j * 6 + 5] = j * 4 + 3;
+  }
+#endif
+#endif
+
+  galaxy.size = GetPixelCount(galaxy.topology);
+  galaxy.pixels = pixelPointers;
 
   // Map the array of pointers to the actual pixel memory.
-  for (i = 0; i < PIXEL_COUNT; i++) {
+  for (i = 0; i < galaxy.size; i++) {
     galaxy.pixels[i] = &actualPixels[i];
   }
 
   // Seed the pseudorandom number generator.
+#ifdef EMULATE
+  srand(seed);
+#else
   srand(25);
+#endif
 
   // Initialize the PIC hardware
   HardwareInit();
 
   // Initialize the emulator hardware.
 #ifdef EMULATE
+  // Recording and playback.
+  if (playPath != NULL) {
+    if (EmuPlaybackOpen(playPath, galaxy.topology) != 0) {
+      exit(EXIT_FAILURE);
+    }
+    if (playFrom > 0) {
+      EmuPlaybackSeek(playFrom);
+    }
+  }
+  if (recordPath != NULL) {
+    if (EmuRecordOpen(recordPath, galaxy.topology, seed) != 0) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Video export, laid out like the window.
+  if (videoPath != NULL) {
+    videoMap = malloc(galaxy.size * sizeof(emuPoint_t));
+    if (videoMap == NULL) {
+      fprintf(stderr, "Unable to allocate %i pixels!\n", galaxy.size);
+      exit(EXIT_FAILURE);
+    }
+    if (EmuVideoOpen(videoPath, videoWidth, videoHeight, videoRate, videoMap,
+                     LayoutPixels(videoWidth & ~1, videoHeight & ~1, videoMap),
+                     galaxy.size) != 0) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Command line run modes that don't need a window.  These start the playlist
+  // at the PIC's power on time, so that they're repeatable.
+  if (playlistClock < 0) {
+    playlistClock = PLAYLIST_START;
+    if (!wireBenchmark && !blendBenchmark && !mathBenchmark && !transitionCheck &&
+        !headless && (fleetCount == 0) && (bakePath == NULL) &&
+        (vmBenchmarkDir == NULL) && (assemblePath == NULL)) {
+      // The window goes by the time of day here.
+      now = time(NULL);
+      local = localtime(&now);
+      playlistClock = (local->tm_hour * 3600L) + (local->tm_min * 60L) + local->tm_sec;
+    }
+  }
+  if (wireBenchmark) {
+    WireBenchmark(&galaxy);
+    exit(EXIT_SUCCESS);
+  }
+  if (blendBenchmark) {
+    BlendBenchmark(&galaxy);
+    exit(EXIT_SUCCESS);
+  }
+  if (mathBenchmark) {
+    MathBenchmark();
+    exit(EXIT_SUCCESS);
+  }
+  if (transitionCheck) {
+    exit((TransitionCheck(&galaxy) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  if (bakePath != NULL) {
+    Bake(&galaxy, bakePath, seed, headlessFrames);
+    exit(EXIT_SUCCESS);
+  }
+  if (vmBenchmarkDir != NULL) {
+    VmBenchmark(&galaxy, vmBenchmarkDir);
+    exit(EXIT_SUCCESS);
+  }
+  if (vmPath != NULL) {
+    if (EmuAsmLoad(vmPath, &vmProgram, &vmLength) != 0) {
+      exit(EXIT_FAILURE);
+    }
+    if (assemblePath != NULL) {
+      exit((EmuAsmWriteC(assemblePath, vmPath, vmProgram, vmLength) == 0) ?
+           EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+  if (headless) {
+    // Without a limit, run for 10000 frames.
+    if ((headlessFrames < 0) && (headlessSeconds < 0)) {
+      headlessFrames = 10000;
+    }
+    Headless(&galaxy, seed, headlessFrames, headlessSeconds);
+    exit(EXIT_SUCCESS);
+  }
+  if (fleetCount > 0) {
+    // Without a limit, run for 10 seconds.
+    if ((headlessFrames < 0) && (headlessSeconds < 0)) {
+      headlessSeconds = 10;
+    }
+    Fleet(galaxy.topology, fleetCount, fleetThreads, seed, headlessFrames,
+          headlessSeconds, fleetPaced);
+    exit(EXIT_SUCCESS);
+  }
+
   // Init the display window.
   // SDL, Simple DirectMedia Layer, is a library for access to the keyboard,
   // and graphics hardware.  See www.libsdl.org  
-  if (SDL_Init(SDL_INIT_AUDIO|SDL_INIT_VIDEO|SDL_INIT_TIMER) < 0) {
+  if (SDL_Init(SDL_INIT_AUDIO|SDL_INIT_VIDEO) < 0) {
     fprintf(stderr, "Unable to init SDL: %s\n", SDL_GetError());
     exit(EXIT_FAILURE);
   } else {
@@ -120,6 +434,39 @@ int main (void) {
   // Set the window title
   WindowTitle(delayMultiplier);
 
+  // Start the emulated serial port and the slaves on the other end of it.
+  EmuSlavesInit(galaxy.topology);
+
+  // And a real one, if we were given one.  That's the galaxy's own slaves,
+  // which only take raw slave blocks (see SLAVE_EXTENSIONS in galaxyConfig.h).
+  if ((ttyDevice != NULL) || ttyLoopback) {
+    if (ttyLoopback) {
+      i = EmuTtyLoopback();
+    } else {
+      i = EmuTtyOpen(ttyDevice);
+    }
+    if (i != 0) {
+      exit(EXIT_FAILURE);
+    }
+    rawSlaves = TRUE;
+  }
+
+  // Networked LED controllers.
+  if (netHost != NULL) {
+    if (EmuNetOpen(netProtocol, netHost, galaxy.topology) != 0) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Pattern plugins.
+  if (pluginDir != NULL) {
+    if (EmuPluginOpen(pluginDir) != 0) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  EmuUartSetTimeScale(delayMultiplier / 10.0);
+  EmuUartInit();
+
   // Clear the window to black.
   SDL_SetRenderDrawColor(sdlRenderer, 0, 0, 0, 255);
   SDL_RenderClear(sdlRenderer);
@@ -138,13 +485,21 @@ int main (void) {
   printf("      +                - Increase emulation speed\n");
   printf("      -                - Decrease emulation speed\n");
   printf("      0                - Set emulation speed to 100%%\n");
+  printf("      [ ]              - Decrease / increase galaxy brightness\n");
   printf("      p                - Pause / unpause the simulation\n");
   printf("      SPACE            - Go to another pattern\n");
   printf("The emulator window must have focus for the key presses to work.\n");
+  printf("Topology: %i arms of %i pixels, %i slaves.\n", galaxy.topology->armCount,
+         galaxy.topology->pixelsPerArm, galaxy.topology->slaveCount);
 #endif
 
-  // Hand off control to the pattern generator.
+  // Hand off control to the pattern generator.  The emulator runs it on a
+  // thread of its own, and draws the window from this one.
+#ifdef EMULATE
+  Present(&galaxy);
+#else
   GeneratePattern(&galaxy);
+#endif
 
   // We can only get this far on the emulator.
   exit(EXIT_SUCCESS);  // Required on the emu target for SDL cleanup.
@@ -159,84 +514,437 @@ void GeneratePattern(galaxyData_t *galaxy) {
   int pattern = 0;
   int initial = TRUE;
   outputMapping_e currentOutputMap = MAP_FULL;
-  long int timer = 0;
+  playlist_t playlist;
+  long int shown = 0;
+  static stateSet_t states[LAYERS];
+  layer_t layers[LAYERS];
+  int layerPattern[LAYERS];
+  color_t *scratch = NULL;
+  int i, next;
+  galaxyData_t *output = galaxy;
+  outputMapping_e outputMap = MAP_FULL;
+  transition_t transition;
+  long int hold = 0, nextHold;
+  static link_t galaxyLink;
 #ifdef EMULATE
+  int layerTotal = layerCount;
+  int fadeLength = transitionFrames;
+  long int startClock = playlistClock;
   unsigned char pause = FALSE;
+  int bytesSent;
+  command_t command;
+  vmState_t vmState = {{0}};
+  double delay;
+  struct timespec start, now;
+#else
+  int layerTotal = PATTERN_LAYERS;
+  int fadeLength = TRANSITION_FRAMES;
+  long int startClock = PLAYLIST_START;
 #endif /* EMULATE */
 
+  // Each pattern gets a state block, in every layer.  The bottom layer's
+  // patterns come off the playlist, and crossfade from one to the next,
+  // unless layered.
+  PatternSetup(&states[0], &playlist, startClock, &transition, galaxy,
+               (layerTotal == 1) ? fadeLength : 0);
+  for (i = 1; i < LAYERS; i++) {
+    PatternSetup(&states[i], NULL, 0, NULL, NULL, 0);
+  }
+
+  // With more than one layer, the patterns draw into layers of their own, and
+  // the galaxy gets the blend of them.
+  if (layerTotal > 1) {
+    scratch = InitLayers(galaxy, layers, layerTotal);
+    ChooseOverlays(layers, layerPattern, layerTotal, states[0].state);
+  }
+
+  // The link to the slaves.  Real ones (--tty) only take raw slave blocks.
+  LinkInit(&galaxyLink);
+#ifdef EMULATE
+  if (rawSlaves) {
+    SetCompression(&galaxyLink, FALSE);
+    SetBroadcast(&galaxyLink, FALSE);
+  }
+#endif
+
+  // The first pattern.
+  pattern = NextPattern(&playlist, states[0].state);
+
   // Set the initial pixel state to all black.
   ColorAll(galaxy, PIXEL_BLACK);
+#ifdef EMULATE
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
 
   // Run the pattern loop.
   FOREVER {
 
 #ifdef EMULATE
-    // Handle keyboard and window events.
-    switch(HandleEvents()) {
-      case DOEXIT:
-        return;  // Return to the main function for exit.
-      case DONEXTPATTERN:
-        // Pick a new pattern.
-        pattern = rand() % PATTERN_COUNT;
-        initial = TRUE;
-        timer = 0;
-        // printf("Pattern: %i\n", pattern);
-        break;
-      case DOPAUSE:
-        pause = pause ? FALSE : TRUE;
-        WindowTitle(pause ? 1000000 : delayMultiplier);  // Kludge
-        break;
-      case DONOTHING:
-      default:
-        break;
+    // A new frame, as far as the frame scheduler is concerned.
+    EmuClockFrame();
+
+    // Carry out the commands from the keyboard (see HandleEvents()).
+    while (EmuCommandTake(&command)) {
+      switch(command.command) {
+        case DOEXIT:
+          PrintWireStats(galaxy);
+          PrintTransitionStats();
+          EmuUartPrintStats();
+          EmuTtyPrintStats();
+          EmuNetPrintStats();
+          EmuClockPrintStats();
+          EmuFramesPrintStats();
+          EmuPluginPrintStats();
+          EmuRecordClose();
+          EmuVideoClose();
+          return;  // Return to the main function for exit.
+        case DONEXTPATTERN:
+          // Pick a new pattern.
+          if (EmuPlaybackIsOpen()) {
+            EmuPlaybackSkip();
+            break;
+          }
+          next = NextPattern(&playlist, states[0].state);
+          if (next != pattern) {
+            TransitionStart(&transition, galaxy, &patternList[pattern],
+                            states[0].state[pattern], currentOutputMap);
+          }
+          pattern = next;
+          ChooseOverlays(layers, layerPattern, layerTotal, states[0].state);
+          initial = TRUE;
+          // printf("Pattern: %i\n", pattern);
+          break;
+        case DOPAUSE:
+          pause = pause ? FALSE : TRUE;
+          break;
+        case DOSPEED:
+          delayMultiplier = command.value;
+          EmuUartSetTimeScale(delayMultiplier / 10.0);
+          break;
+        case DOBRIGHTNESS:
+          SetBrightness(&galaxyLink, command.value);
+          break;
+        case DONOTHING:
+        default:
+          break;
+      }
     }
 
-    // Write to the emulator output.
-    UpdateEmuOutput(galaxy, currentOutputMap);
+    // Pass what the slaves have decoded from the serial line so far to the
+    // display thread, and the video, if one is being made.
+    EmuSlavesGetFrame(EmuFramesBack());
+    if (EmuVideoIsOpen()) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      EmuVideoFrame(EmuFramesBack(), (now.tv_sec - start.tv_sec) +
+                                     ((now.tv_nsec - start.tv_nsec) / 1e9));
+    }
+    EmuFramesPublish();
+
+    // Write to the (emulated) serial port.  The frame shows for its hold, or
+    // its time on the wire, whichever is longer, as far as the playlist is
+    // concerned.
+    bytesSent = WriteLights(&galaxyLink, output, outputMap);
+    shown = (long int) (bytesSent * BITS_PER_BYTE * BIT_RATE * 1e6);
+    if (hold > shown) {
+      shown = hold;
+    }
+
+    // And to the network, if it's in use.  This carries on while paused, since
+    // network controllers go dark if they don't hear from us for a while.
+    EmuNetSend(output, outputMap);
 
     // If paused, restart (continue) the FOREVER loop without further processing.
-    if (pause) continue; 
+    // Nothing changes while paused, so nothing goes out the emulated serial
+    // port to hold up the loop.  Wait out a packet time instead.
+    if (pause) {
+      DelayMS(GetFrameBytes(galaxy->topology) * BITS_PER_BYTE * BIT_RATE * 1000);
+      continue;
+    }
+
+    // Pattern plugins (--plugins), or a pattern program (--vm), run on their
+    // own, in place of the playlist.
+    if (EmuPluginIsOpen()) {
+      nextHold = EmuPluginFrame(galaxy, initial, &outputMap);
+      initial = FALSE;
+      HoldFrame(hold);
+      hold = nextHold;
+      continue;
+    }
+    if (vmProgram != NULL) {
+      nextHold = VmRun(galaxy, &vmState, vmProgram, initial, &outputMap);
+      initial = FALSE;
+      HoldFrame(hold);
+      hold = nextHold;
+      continue;
+    }
+
+    // Keep track of the wire bytes each pattern costs.
+    patternFrames[pattern]++;
+    patternBytes[pattern] += bytesSent;
+
+    // And save the frame, if there's a recording being made.
+    EmuRecordFrame(output, outputMap, pattern, shown / 1e6);
+
+    // When playing a recording back, the frames come from that instead of
+    // the patterns.  The frames go out for as long as they were recorded.
+    if (EmuPlaybackIsOpen()) {
+      pattern = EmuPlaybackFrame(galaxy, &outputMap, &delay);
+      if (pattern >= PATTERN_COUNT) {
+        pattern = 0;
+      }
+      DelayMS(delay * 1000);
+      continue;
+    }
 
 #else /* EMULATE */
-    
-    // Write to the serial port.
-    WriteLights(galaxy, currentOutputMap);
+
+    // Write to the serial port.  This returns once the frame is on its way
+    // out, so the pattern code below overlaps the transmission.  The frame's
+    // hold is timed from here, and the last one is over.
+    WriteLights(&galaxyLink, output, outputMap);
+    shown = HOLD_US(ReadTimer0());
+    WriteTimer0(0);
 
 #endif /* EMULATE */
 
-    // Run the selected pattern from the patternFunctions array.
-    patternList[pattern].patternFunction(galaxy, initial, &currentOutputMap);
+    // Run the selected pattern from the patternFunctions array, and during a
+    // crossfade, the outgoing one too.  With layers, each layer runs its own
+    // pattern.  Only the bottom (or incoming) pattern's hold counts.
+    if (layerTotal == 1) {
+      nextHold = patternList[pattern].patternFunction(galaxy, states[0].state[pattern],
+                                                      initial, &currentOutputMap);
+      output = RunTransition(&transition, galaxy, currentOutputMap, &outputMap);
+    } else {
+      layerPattern[0] = pattern;
+      nextHold = patternList[pattern].patternFunction(&layers[0].galaxy,
+          states[0].state[pattern], initial, &layers[0].map);
+      for (i = 1; i < layerTotal; i++) {
+        patternList[layerPattern[i]].patternFunction(&layers[i].galaxy,
+            states[i].state[layerPattern[i]], initial, &layers[i].map);
+      }
+      outputMap = CompositeLayers(galaxy, layers, layerTotal, scratch);
+    }
 
     // Set for the first pass when a new pattern is chosen, but can be unset now.
     initial = FALSE;  
 
     // Have we run the pattern long enough?
-    timer++;
-    if (timer >= patternList[pattern].iterations) {
-      // Timer expired.  Choose a new pattern and set the initial flag.
-      pattern = rand() % PATTERN_COUNT;
+    if (PlaylistTick(&playlist, shown)) {
+      // Time's up.  Move on down the playlist and set the initial flag.  The
+      // old pattern fades out, unless it came up again.
+      next = NextPattern(&playlist, states[0].state);
+      if (next != pattern) {
+        TransitionStart(&transition, galaxy, &patternList[pattern],
+                        states[0].state[pattern], currentOutputMap);
+      }
+      pattern = next;
+      ChooseOverlays(layers, layerPattern, layerTotal, states[0].state);
       initial = TRUE;
-      timer = 0;
     }
+
+    // Let the frame that's out show for as long as it asked, then on to the
+    // one just made.
+    HoldFrame(hold);
+    hold = nextHold;
   } // End of FOREVER Loop
 } // End GeneratePattern()
 
 
-// A simple delay loop.  It should be noted that this loop may not work at
-// higher levels of compiler optimization.  Below is a version for each target.
-void Delay(long int d) {
+// Set up the pixels for count layers the size of the galaxy, all black, and
+// return a frame's worth of scratch pixels for the compositor.  The PIC only
+// has the memory set aside if PATTERN_LAYERS calls for it.
+color_t *InitLayers(galaxyData_t *galaxy, layer_t *layers, int count) {
+#if defined(EMULATE) || (PATTERN_LAYERS > 1)
+
+  // Vars
+  int i, j;
+  color_t *pixels, *scratch;
+#ifdef EMULATE
+  color_t **pointers;
+#else
+  static color_t layerPixels[PATTERN_LAYERS][PIXEL_COUNT];
+  static color_t *layerPointers[PATTERN_LAYERS][PIXEL_COUNT];
+  static color_t scratchPixels[PIXEL_COUNT];
+#endif
+
+  for (i = 0; i < count; i++) {
+#ifdef EMULATE
+    pixels = malloc(galaxy->size * sizeof(color_t));
+    pointers = malloc(galaxy->size * sizeof(color_t *));
+    if ((pixels == NULL) || (pointers == NULL)) {
+      fprintf(stderr, "Unable to allocate %i layers!\n", count);
+      exit(EXIT_FAILURE);
+    }
+    layers[i].galaxy.pixels = pointers;
+#else
+    pixels = layerPixels[i];
+    layers[i].galaxy.pixels = layerPointers[i];
+#endif
+    layers[i].galaxy.size = galaxy->size;
+    layers[i].galaxy.topology = galaxy->topology;
+    for (j = 0; j < galaxy->size; j++) {
+      layers[i].galaxy.pixels[j] = &pixels[j];
+    }
+    ColorAll(&layers[i].galaxy, PIXEL_BLACK);
+    layers[i].map = MAP_FULL;
+    layers[i].mode = BLEND_ALPHA;
+    layers[i].alpha = 255;
+  }
+
+#ifdef EMULATE
+  scratch = malloc(galaxy->size * sizeof(color_t));
+  if (scratch == NULL) {
+    fprintf(stderr, "Unable to allocate %i layers!\n", count);
+    exit(EXIT_FAILURE);
+  }
+#else
+  scratch = scratchPixels;
+#endif
+  return scratch;
+
+#else
+  return NULL;
+#endif
+}
+
+
+// Give the outgoing pattern of a crossfade its frame, and blend it with the
+// incoming one's in galaxy.  Returns the pixels to send, and in outMap, how.
+// The incoming pattern keeps the time.
+galaxyData_t *RunTransition(transition_t *t, galaxyData_t *galaxy,
+                            outputMapping_e map, outputMapping_e *outMap) {
+
+  // Vars
+  galaxyData_t *output;
+#ifdef EMULATE
+  struct timespec start, end;
+  unsigned char fading = (t->pattern != NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+  if (t->pattern != NULL) {
+    t->pattern->patternFunction(&t->galaxy, t->state, FALSE, &t->map);
+  }
+  output = TransitionBlend(t, galaxy, map, outMap);
+
+#ifdef EMULATE
+  // Keep track of what the crossfades cost.
+  if (fading) {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fadeNs += ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+    fadeFrames++;
+  }
+#endif
+  return output;
+}
+
+
+// Choose a pattern, a blend and an opacity for each layer above the bottom
+// one.  The bottom layer's pattern is chosen as usual.
+void ChooseOverlays(layer_t *layers, int *patterns, int count, void *state[]) {
+  int i;
+
+  for (i = 1; i < count; i++) {
+    do {
+      patterns[i] = rand() % PATTERN_COUNT;
+    } while (!PATTERN_RUNNABLE(patterns[i], state));
+    layers[i].mode = rand() % BLEND_COUNT;
+    layers[i].alpha = 128 + (rand() % 128);
+  }
+}
+
+
+// Set up a run of the patterns: a state block for each pattern, and if they're
+// given, the playlist from clock (seconds after midnight) and crossfades of
+// fade frames on the galaxy.  Used by the pattern loop and by each of the
+// emulator's run modes (see emuModes.c), so they all start the same way.
+void PatternSetup(stateSet_t *states, playlist_t *playlist, long int clock,
+                  transition_t *transition, const galaxyData_t *galaxy,
+                  int fade) {
+
+  // Vars
+  arena_t arena;
+
+  ArenaInit(&arena, states->memory, sizeof(states->memory));
+  InitPatternStates(&arena, states->state);
+  if (transition != NULL) {
+    TransitionInit(transition, galaxy, fade);
+  }
+  if (playlist != NULL) {
+    PlaylistInit(playlist, playlistEntries, PLAYLIST_COUNT, PLAYLIST_NO_REPEAT,
+                 clock);
+  }
+}
+
+
+// Give each pattern its own state block from the arena.  A pattern with no
+// state gets NULL.  The arena is sized by patternStates_t (see pattern.h), so
+// a pattern whose state type isn't in there may not fit.  The emulator says
+// so and stops.  The PIC can't, so the pattern is left out (see
+// NextPattern()).
+void InitPatternStates(arena_t *arena, void *state[]) {
+  int i;
+
+  for (i = 0; i < PATTERN_COUNT; i++) {
+    state[i] = NULL;
+    if (patternList[i].stateSize != 0) {
+      state[i] = ArenaAlloc(arena, patternList[i].stateSize);
+#ifdef EMULATE
+      if (state[i] == NULL) {
+        fprintf(stderr, "%s's state (%u bytes) doesn't fit in the %u bytes set"
+                " aside for pattern states.  Add its state type to"
+                " patternStates_t in pattern.h.\n", patternList[i].name,
+                patternList[i].stateSize, (unsigned int) PATTERN_STATE_BYTES);
+        exit(EXIT_FAILURE);
+      }
+#endif
+    }
+  }
+}
+
+
+// The next pattern off the playlist that can run, passing over any that
+// didn't get a state block.  If the playlist has nothing else, the first
+// pattern that can run.
+int NextPattern(playlist_t *playlist, void *state[]) {
+  int pattern, tries;
+
+  for (tries = 0; tries < PLAYLIST_LENGTH; tries++) {
+    pattern = PlaylistNext(playlist);
+    if (PATTERN_RUNNABLE(pattern, state)) {
+      return pattern;
+    }
+  }
+  pattern = 0;
+  while ((pattern < PATTERN_COUNT - 1) && !PATTERN_RUNNABLE(pattern, state)) {
+    pattern++;
+  }
+  return pattern;
+}
+
+
+// Wait until the frame on the wire has been showing for us microseconds, as
+// its pattern asked (see pattern.h).  This is the only place the pattern loop
+// waits, and the hold runs from when the frame went out, so the time spent
+// making the next frame comes out of it rather than adding to it.  Anything
+// that can be done in the background belongs in the wait.
+void HoldFrame(long int us) {
 
 #ifndef EMULATE
-  // We'll delay by just sitting in a for loop for a while.
-  long int i;
-  for (i = 0; i < d; i++);
+  unsigned int ticks;
+
+  // Timer0 was zeroed as the frame went out (see GeneratePattern()).
+  if (us > HOLD_MAX_US) {
+    us = HOLD_MAX_US;
+  }
+  ticks = (unsigned int) HOLD_TICKS(us);
+  while (ReadTimer0() < ticks);
 
 #else /* EMULATE */
-  // Looking at the disassembly listing, and simulation output, it appears the
-  // above loop runs in ~21 instruction cycles on the PIC target.  From this
-  // we can approximate a delay on the emulation target.
-  #define DELAY_INSTRUCTIONS 21
-  DelayINSTR((int) (d * DELAY_INSTRUCTIONS));
+  // The frame scheduler times the hold from the start of the frame (see
+  // emuClock.c).
+  DelayMS(us / 1000.0);
 
 #endif /* EMULATE */
 }
@@ -246,12 +954,59 @@ void Delay(long int d) {
 #ifdef EMULATE
 
 
-// Handle messages from the SDL framework for keyboard and window events.
+// The display.  Starts the pattern generator on a thread of its own, then draws
+// the newest frame it has finished, whenever there is one.  The two trade
+// frames through a triple buffer (see emuFrames.c), so a slow present (vsync,
+// a busy compositor) never holds up the patterns, which keep to the wire's
+// timing.  SDL wants its events handled by the thread that made the window, so
+// that's done here too, and the commands queued up for the pattern thread.
+void Present(galaxyData_t *galaxy) {
+
+  // Vars
+  pthread_t patternThread;
+  const color_t *frame;
+
+  if (pthread_create(&patternThread, NULL, PatternThread, galaxy) != 0) {
+    fprintf(stderr, "Unable to start the pattern thread!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  FOREVER {
+    // Handle keyboard and window events.
+    if (HandleEvents() == DOEXIT) {
+      break;
+    }
+
+    // Draw the newest frame, or give the pattern thread a moment to make one.
+    frame = EmuFramesLatest();
+    if (frame != NULL) {
+      UpdateEmuOutput(frame);
+    } else {
+      SDL_Delay(1);
+    }
+  }
+
+  // Let the pattern thread print its stats and finish up.
+  pthread_join(patternThread, NULL);
+}
+
+
+// The pattern thread.
+void *PatternThread(void *arg) {
+  GeneratePattern((galaxyData_t *) arg);
+  return NULL;
+}
+
+
+// Handle messages from the SDL framework for keyboard and window events.  Key
+// presses are turned into commands for the pattern thread.  The window belongs
+// to this thread, so resizing is taken care of here.  Returns DOEXIT once
+// the pattern thread has been told to quit, otherwise DONOTHING.
 command_e HandleEvents(void) {
   
   // Vars
   SDL_Event event;
-  command_e returnValue = DONOTHING;
+  static unsigned char pause = FALSE;
 
   // Events that occured in SDL (button pushes, window resize, etc) are stored
   // in a queue as they happen.  SDL_PollEvent grabs the first event off the
@@ -271,56 +1026,75 @@ command_e HandleEvents(void) {
         if (((event.key.keysym.mod & KMOD_CTRL) && (event.key.keysym.sym == SDLK_c)) ||  // <ctrl> c
             (event.key.keysym.sym == SDLK_ESCAPE) ||   // ESC
             (event.key.keysym.sym == SDLK_q)) {
-          returnValue = DOEXIT;
+          PostCommand(DOEXIT, 0);
+          return (DOEXIT);
         }
 
         // + key increases emulation speed by decreasing delay multiplier.
         if ((event.key.keysym.sym == SDLK_EQUALS) ||
             (event.key.keysym.sym == SDLK_PLUS) ||
             (event.key.keysym.sym == SDLK_KP_PLUS)) {
-          delayMultiplier --;
-          if (delayMultiplier < 0) {
-            delayMultiplier = 0;
+          speedSetting --;
+          if (speedSetting < 0) {
+            speedSetting = 0;
           }
-          WindowTitle(delayMultiplier);
-          // printf("Delay Multiplier: %f\n", delayMultiplier / 10.0);
+          WindowTitle(speedSetting);
+          PostCommand(DOSPEED, speedSetting);
+          // printf("Delay Multiplier: %f\n", speedSetting / 10.0);
         }
 
         // - key decreases emulation speed by increasing delay multiplier.
         if ((event.key.keysym.sym == SDLK_MINUS) ||
             (event.key.keysym.sym == SDLK_KP_MINUS)) {
-          delayMultiplier ++;
-          if (delayMultiplier > 100) {
-            delayMultiplier = 100;
+          speedSetting ++;
+          if (speedSetting > 100) {
+            speedSetting = 100;
           }
-          WindowTitle(delayMultiplier);
-          // printf("Delay Multiplier: %4.1f\n", delayMultiplier / 10.0);
+          WindowTitle(speedSetting);
+          PostCommand(DOSPEED, speedSetting);
+          // printf("Delay Multiplier: %4.1f\n", speedSetting / 10.0);
         }
 
         // 0 key reset emulation speed to 1.
         if ((event.key.keysym.sym == SDLK_0) ||
             (event.key.keysym.sym == SDLK_KP_0)) {
-          delayMultiplier = 10;
-          WindowTitle(delayMultiplier);
-          // printf("Delay Multiplier: %4.1f\n", delayMultiplier / 10.0);
+          speedSetting = 10;
+          WindowTitle(speedSetting);
+          PostCommand(DOSPEED, speedSetting);
+          // printf("Delay Multiplier: %4.1f\n", speedSetting / 10.0);
+        }
+
+        // [ and ] decrease and increase the galaxy's brightness.
+        if ((event.key.keysym.sym == SDLK_LEFTBRACKET) ||
+            (event.key.keysym.sym == SDLK_RIGHTBRACKET)) {
+          brightness += (event.key.keysym.sym == SDLK_LEFTBRACKET) ? -16 : 16;
+          if (brightness < 0) {
+            brightness = 0;
+          }
+          if (brightness > 255) {
+            brightness = 255;
+          }
+          PostCommand(DOBRIGHTNESS, brightness);
         }
 
         // Space goes to next pattern.
         if (event.key.keysym.sym == SDLK_SPACE) {
-          returnValue = DONEXTPATTERN;
+          PostCommand(DONEXTPATTERN, 0);
         }
 
         // p pauses the simulation.
         if (event.key.keysym.sym == SDLK_p) {
-          returnValue = DOPAUSE;
+          pause = pause ? FALSE : TRUE;
+          WindowTitle(pause ? 1000000 : speedSetting);  // Kludge
+          PostCommand(DOPAUSE, 0);
         }
         
         break;
         
       // Someone closed the window, pressed <ctrl c> in the terminal, or killed the process.
       case SDL_QUIT:
-        returnValue = DOEXIT;
-        break;
+        PostCommand(DOEXIT, 0);
+        return (DOEXIT);
 
       // Some other thing happened to the window.
       case SDL_WINDOWEVENT:
@@ -336,19 +1110,58 @@ command_e HandleEvents(void) {
         break;
     } // End event type switch
   } // End event polling loop.
-  return (returnValue);
+  return (DONOTHING);
 } // End HandleEvents()
 
 
+// Queue a command for the pattern thread.  It takes them every frame, so if
+// the queue is full, it won't be for long.
+void PostCommand(command_e command, int value) {
+  while (!EmuCommandPost(command, value)) {
+    SDL_Delay(1);
+  }
+}
+
+
 // Generate the pixel layout of the galaxy based on window dimension, place
 // the layout into global pixelMap.  This is called on startup and whenever
 // the window is resized.
 void GeneratePixelMap(int w, int h) {
 
   // Vars
-  int i, r;
-  int c1x, c1y, c2x, c2y;
-  float aspect, theta;
+  int i, pixelCount;
+  float x, y;
+
+  pixSize = LayoutPixels(w, h, pixelMap);
+
+#ifdef EMU_GEOMETRY
+  // The corners of each pixel's square, covering the same screen pixels as
+  // boxRGBA() would.
+  pixelCount = GetPixelCount(emuTopology);
+  for (i = 0; i < pixelCount; i++) {
+    x = pixelMap[i].x;
+    y = pixelMap[i].y;
+    emuVertices[i * 4 + 0].position.x = x - pixSize;
+    emuVertices[i * 4 + 0].position.y = y - pixSize;
+    emuVertices[i * 4 + 1].position.x = x + pixSize + 1;
+    emuVertices[i * 4 + 1].position.y = y - pixSize;
+    emuVertices[i * 4 + 2].position.x = x + pixSize + 1;
+    emuVertices[i * 4 + 2].position.y = y + pixSize + 1;
+    emuVertices[i * 4 + 3].position.x = x - pixSize;
+    emuVertices[i * 4 + 3].position.y = y + pixSize + 1;
+  }
+#endif
+}
+
+
+// Lay the galaxy's pixels out in a w by h picture (the window, or a video
+// frame).  Fills in map, and returns the pixel size - each is a square with
+// sides size * 2 + 1.
+int LayoutPixels(int w, int h, emuPoint_t *map) {
+
+  // Vars
+  int i, pixelCount, size;
+  float r, aspect, x, y, xMax, yMax, xScale, yScale;
 
   // r is the radius of a galactic arm.  Its half the screen width minus the margin.
   r = (((w/2) - (MARGIN_PERCENTAGE / 2 * w)) / 2);
@@ -357,143 +1170,142 @@ void GeneratePixelMap(int w, int h) {
   // can be stretched in w or h independently.
   aspect = h / ((w/2) + (MARGIN_PERCENTAGE / 2 * w));
 
-  // c1x is the center (x) of the left arm.
-  c1x = w/2 - (((w/2) - (MARGIN_PERCENTAGE / 2 * w)) / 2);
-
-  // c2x is the center (x) of the right arm.
-  c2x = w/2 + (((w/2) - (MARGIN_PERCENTAGE / 2 * w)) / 2);
-  
-  // c1y, c2y is the center (y) of the arms.
-  c1y = c2y = h/2;
-
-  //printf("%i, %i\n%i, %i\n", c1x, c1y, c2x, c2y);
-  //printf("r = %i\n", r);
-
-  // Calculates the location of each of the galaxy pixels in the map by placing
-  // them in sine-like arcs.
-  for (i = 0 ; i < PIXELS_PER_ARM ; i++) {
-    theta = (i + 1) * (180.0 / PIXELS_PER_ARM);
-    pixelMap[i].x = c1x + (r * cosf(theta * M_PI / 180));
-    pixelMap[i].y = c1y - (aspect*(r * sinf(theta * M_PI / 180)));
-    pixelMap[i + PIXELS_PER_ARM].x = c2x - (r * cosf(theta * M_PI / 180));
-    pixelMap[i + PIXELS_PER_ARM].y = c2y + (aspect*(r * sinf(theta * M_PI / 180)));
-    //printf("Theta: %6.2f, x1 = %4i, y1 = %4i, x2 = %4i, y2 = %4i\n",
-    //       theta, pixelMap[i].x, pixelMap[i].y,
-    //       pixelMap[i+PIXELS_PER_ARM].x, pixelMap[i+PIXELS_PER_ARM].y);
+  // How far the arms reach from the center of the galaxy.
+  pixelCount = GetPixelCount(emuTopology);
+  xMax = yMax = 0;
+  for (i = 0; i < pixelCount; i++) {
+    UnitPixelPosition(i, &x, &y);
+    if (fabsf(x) > xMax) xMax = fabsf(x);
+    if (fabsf(y) > yMax) yMax = fabsf(y);
   }
-}
 
-
-// This is the emulator's version of WriteLights.  The output window is updated
-// here.  TODO: Reparameterize -> PIXELS_PER_ARM should come from (gData->size / 2).
-void UpdateEmuOutput(galaxyData_t *gData, outputMapping_e map) {
-
-  // Vars
-  int i;
-
-  // A word on mapping...  Layouts below are described as left to right.
-  // pixelMap is generated as 20 .. 0, 21 .. 41
-  // gData is 0 .. 41 in FULL, and 0 .. 20, 20 .. 0 in MIRROR.
-  if (map == MAP_MIRROR) {
-    // Mirrored output.
-    for (i = 0; i < PIXELS_PER_ARM ; i++) {
-      // Pixmap 0 .. 20.  gData 20 .. 0
-      boxRGBA(sdlRenderer, pixelMap[i].x - PIX_SIZE, pixelMap[i].y - PIX_SIZE,
-                           pixelMap[i].x + PIX_SIZE, pixelMap[i].y + PIX_SIZE,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->r,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->g,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->b, 255);
-
-      // Pixmap 21 .. 41.  gData 20 .. 0
-      boxRGBA(sdlRenderer, pixelMap[i + PIXELS_PER_ARM].x - PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].y - PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].x + PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].y + PIX_SIZE,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->r,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->g,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->b, 255);
-    }
-  } else {
-    // Full output.
-    for (i = 0; i < PIXELS_PER_ARM ; i++) {
-      // Pixmap 0 .. 20.  gData 20 .. 0
-      boxRGBA(sdlRenderer, pixelMap[i].x - PIX_SIZE, pixelMap[i].y - PIX_SIZE,
-                           pixelMap[i].x + PIX_SIZE, pixelMap[i].y + PIX_SIZE,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->r,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->g,
-                           gData->pixels[PIXELS_PER_ARM - i - 1]->b, 255);
-
-      // Pixmap 21 .. 41.  gData 21 .. 41
-      boxRGBA(sdlRenderer, pixelMap[i + PIXELS_PER_ARM].x - PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].y - PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].x + PIX_SIZE,
-                           pixelMap[i + PIXELS_PER_ARM].y + PIX_SIZE,
-                           gData->pixels[PIXELS_PER_ARM + i]->r,
-                           gData->pixels[PIXELS_PER_ARM + i]->g,
-                           gData->pixels[PIXELS_PER_ARM + i]->b, 255);
-    }
+  // Scale the arms to fill the window.  Two arms (the galaxy) span 2 radii
+  // each way horizontally and 1 vertically.  More arms reach further up and
+  // down, so the vertical is squeezed to fit inside the margin.
+  xScale = r * 2 / xMax;
+  yScale = aspect * xScale;
+  if ((yMax * yScale) > (h / 2 - (MARGIN_PERCENTAGE / 2 * h))) {
+    yScale = (h / 2 - (MARGIN_PERCENTAGE / 2 * h)) / yMax;
   }
 
-  // Render the scene to the window.
-  SDL_RenderPresent(sdlRenderer);
+  // Calculates the location of each of the galaxy pixels in the map.
+  for (i = 0; i < pixelCount; i++) {
+    UnitPixelPosition(i, &x, &y);
+    map[i].x = w/2 + (xScale * x);
+    map[i].y = h/2 + (yScale * y);
+    //printf("Pixel %i: x = %4i, y = %4i\n", i, map[i].x, map[i].y);
+  }
 
-  // Set the timer to emulate the serial transmission time.
-  DelayMS((int) PACKET_TIME);
+  // Shrink the pixels if there are too many to fit along the arms.
+  size = (M_PI * xScale / emuTopology->pixelsPerArm) / 2;
+  if (size > PIX_SIZE) size = PIX_SIZE;
+  if (size < 1) size = 1;
+  return size;
 }
 
 
-// Emulation Timer - Introduce a delay on the emulator target.  Time is in
-// milliseconds.  Note, the SDL timers are only gauranteed a resulotion of 10ms.
-void DelayMS(int time_ms) {
+// Where a pixel sits in a galaxy of radius 1 arm arcs, relative to its center.
+// Each arm is a half circle (a sine-like arc) from the center out to its tip.
+// The first arm sweeps up and out to the left, and the others are copies of it
+// turned evenly around the center, so the galaxy's two arms make an S.  The
+// angles are worked in the pattern support fixed point (65536 to a turn).
+void UnitPixelPosition(int pixel, float *x, float *y) {
 
   // Vars
-  SDL_TimerID timerID;
-  volatile unsigned char timerRunning;
+  int arm, i, perArm, arms;
+  unsigned int theta, phi;
+  float ax, ay, c, s;
+
+  // i counts from the center out along the arm.
+  perArm = emuTopology->pixelsPerArm;
+  arms = emuTopology->armCount;
+  arm = pixel / perArm;
+  i = perArm - 1 - GetTipDistance(emuTopology, pixel);
+  theta = (((long int) (i + 1) * ANGLE_HALF) + (perArm / 2)) / perArm;
+  ax = ((float) Cos1616(theta) / FIXED1616_ONE) - 1;
+  ay = -(float) Sin1616(theta) / FIXED1616_ONE;
+
+  // Turn the arm into place.
+  phi = (((long int) arm * 4 * ANGLE_QUARTER) + (arms / 2)) / arms;
+  c = (float) Cos1616(phi) / FIXED1616_ONE;
+  s = (float) Sin1616(phi) / FIXED1616_ONE;
+  *x = (ax * c) - (ay * s);
+  *y = (ax * s) + (ay * c);
+}
 
-  // Note, timerRunning must be declared volatile.  This is a rule for any
-  // variable altered in an interrupt.  It tells the compiler's optimizer not to
-  // remove checks on it from blocks of code that don't alter it (like our
-  // while(timerRunning) block below).
 
-  // Factor in the emulation speed.
-  time_ms = time_ms * (delayMultiplier / 10.0);
-  
-  // Set the timer.
-  timerRunning = TRUE;
-  timerID = SDL_AddTimer(time_ms, ExpireTimer, (void *) &timerRunning);
+// This is the emulator's version of the galaxy.  The output window is updated
+// here, using a frame of LED values held by the emulated slaves.  These are in
+// MAP_FULL order.  Mirroring has already been done by the time the bytes hit
+// the wire.  pixelMap is in the same order.
+void UpdateEmuOutput(const color_t *leds) {
 
-  // Wait until it expires.
-  // while(timerRunning) ; //  This works, but uses 100% CPU.
-  while(timerRunning) {
-    // Sleep for 1ms (1000000 ns).  This prevents the processor from thrashing
-    // while we wait for the timer to expire.
-    nanosleep((struct timespec[]) {{0,1000000}}, NULL);
+  // Vars
+  int i, j, pixelCount;
+
+  pixelCount = GetPixelCount(emuTopology);
+#ifdef EMU_GEOMETRY
+  // Color in the squares and hand them all to the renderer at once.  Per pixel
+  // draw calls are what take the time on the software renderer once there are
+  // thousands of pixels.
+  for (i = 0; i < pixelCount; i++) {
+    for (j = i * 4; j < (i * 4) + 4; j++) {
+      emuVertices[j].color.r = leds[i].r;
+      emuVertices[j].color.g = leds[i].g;
+      emuVertices[j].color.b = leds[i].b;
+      emuVertices[j].color.a = 255;
+    }
   }
+  if (SDL_RenderGeometry(sdlRenderer, NULL, emuVertices, pixelCount * 4,
+                         emuIndices, pixelCount * 6) == 0) {
+    pixelCount = 0;
+  }
+#endif
 
-  // Remove the expired timer.
-  SDL_RemoveTimer(timerID);
+  // One box at a time, if the renderer can't do the above.
+  for (i = 0; i < pixelCount; i++) {
+    boxRGBA(sdlRenderer, pixelMap[i].x - pixSize, pixelMap[i].y - pixSize,
+                         pixelMap[i].x + pixSize, pixelMap[i].y + pixSize,
+                         leds[i].r, leds[i].g, leds[i].b, 255);
+  }
+
+  // Render the scene to the window.  The transmission time is taken care of
+  // by the emulated serial port in WriteLights().
+  SDL_RenderPresent(sdlRenderer);
 }
 
 
-// A delay wrapper that takes # of target instructions to delay rather than
-// a time in ms.
-void DelayINSTR(int instructionCount) {
-  DelayMS(instructionCount * INSTRUCTION_TIME * 1000);
-}
+// Print how many bytes each pattern sent to the slaves, compared to sending
+// a full frame every frame.
+void PrintWireStats(galaxyData_t *galaxy) {
 
+  // Vars
+  int i, frameBytes;
+  double average;
+
+  frameBytes = GetFrameBytes(galaxy->topology);
+  printf("Wire bytes per frame by pattern (a full frame is %i bytes):\n", frameBytes);
+  for (i = 0; i < PATTERN_COUNT; i++) {
+    if (patternFrames[i] == 0) continue;
+    average = (double) patternBytes[i] / patternFrames[i];
+    printf("  %-16s %8li frames %7.1f bytes/frame %5.1f%% saved\n",
+           patternList[i].name, patternFrames[i], average,
+           100.0 * (1.0 - (average / frameBytes)));
+  }
+}
 
-// Timer expiration callback.  
-Uint32 ExpireTimer(Uint32 interval, void *timerFlag) {
 
-  // Clear the timer flag
-  *(unsigned char *)timerFlag = FALSE;
+// Emulation Timer - Introduce a delay on the emulator target.  Time is in
+// milliseconds.  The delays are kept on a running deadline by the frame
+// scheduler (see emuClock.c), so they add up without drift.
+void DelayMS(double time_ms) {
 
-  // This tells the timer not to restart.  A repeating timer can be set up by
-  // providing the time in ms to wait for next in the return statement here.
-  return(0);
+  // Factor in the emulation speed.
+  EmuClockDelay((time_ms / 1000.0) * (delayMultiplier / 10.0));
 }
 
 
+
 // Updates the title of the window with the speed.
 void WindowTitle(int dMult) {
   // Vars
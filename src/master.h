@@ -0,0 +1,48 @@
+// File:   master.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// What the pattern loop in master.c shares with the emulator's run modes (see
+// emuModes.c).
+
+#ifndef MASTER_H
+#define	MASTER_H
+
+  #include "galaxyConfig.h"
+  #include "patternSupport.h"
+  #include "playlist.h"
+  #include "pattern.h"
+  #include "transition.h"
+
+  // Memory for one set of pattern states, in long ints so that it's aligned.
+  #define STATE_LONGS ((PATTERN_STATE_BYTES + sizeof(long int) - 1) / sizeof(long int))
+
+  // A state block for each pattern (NULL for none), and the memory they come
+  // from.  See PatternSetup().
+  typedef struct {
+    long int memory[STATE_LONGS];
+    void *state[PATTERN_COUNT];
+  } stateSet_t;
+
+  // Prototypes
+  void PatternSetup(stateSet_t *states, playlist_t *playlist, long int clock,
+                    transition_t *transition, const galaxyData_t *galaxy,
+                    int fade);
+  galaxyData_t *RunTransition(transition_t *t, galaxyData_t *galaxy,
+                              outputMapping_e map, outputMapping_e *outMap);
+
+#ifdef EMULATE
+  void UnitPixelPosition(int pixel, float *x, float *y);
+
+  // Emulator settings and stats, from the command line and the pattern loop.
+  extern const topology_t *emuTopology;
+  extern int delayMultiplier;
+  extern int transitionFrames;
+  extern long int fadeFrames;
+  extern double fadeNs;
+  extern long int patternFrames[PATTERN_COUNT];
+  extern long int patternBytes[PATTERN_COUNT];
+  extern long int playlistClock;
+#endif
+
+#endif	/* MASTER_H */
@@ -9,7 +9,6 @@
 #include "patternSupport.h"
 #include "galaxyConfig.h"
 #include "pattern.h"
-#include <stdlib.h>       // rand()
 
 // Coefficients - Pattern adjustments
 // COEF_FADER_SPREAD - Adjust this to make the fader more or less gentle. Higher
@@ -17,11 +16,16 @@
 #define COEF_FADER_SPREAD 5
 // COEF_FADE_VALUE - Amount of increase/decrease of pixel brightness per step.
 #define COEF_FADE_VALUE 3
-// COEF_RAINBOW_FADE_VALUE - Sharpness / speed of the rainbow fade.
-#define COEF_RAINBOW_FADE_VALUE 8
-#define COEF_STROBE_FREQ_STEP 700   // How fast to sweep the strobe frequencies
-#define COEF_MAX_STROBE_DELAY 15000 // Slowest strobe.
-#define COEF_MIN_STROBE_DELAY 0     // Fastest strobe.
+// COEF_RAINBOW_HUE_STEP - Speed of the rainbow fade, in 256ths of a hue per
+// step (256 hues to the color wheel).  Whole hues keep the steps along the arm
+// even, which the fade opcode sends cheaply.
+#define COEF_RAINBOW_HUE_STEP 256
+#define COEF_STROBE_FREQ_STEP 4900   // How fast to sweep the strobe frequencies (us)
+#define COEF_MAX_STROBE_DELAY 105000 // Slowest strobe (us).
+#define COEF_MIN_STROBE_DELAY 0      // Fastest strobe (us).
+// COEF_ROTATE_HOLD, COEF_MARQUEE_HOLD - How long each step shows (us).
+#define COEF_ROTATE_HOLD 210000
+#define COEF_MARQUEE_HOLD 140000
 
 
 // FaderMovingSeam - Initially fill the array with a color fade in one of the
@@ -29,39 +33,39 @@
 // each step, increase or decrease the brightness value of each pixel in the
 // array, allowing the value to roll over the limits (0-255).  This creates a
 // smoothly varying background with a travelling seam.
-void FaderMovingSeam(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
-  static colorChannel_e colorChannel = 0;
-  static unsigned char fadeDirection = 0;
+long int FaderMovingSeam(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  faderMovingSeamState_t *s = state;
   int i;
 
   // On the first time through, fill the array with our fade color.
   if (initial) {
     *map = MAP_MIRROR;  // Arms are mirrored.
-    colorChannel = rand() % 3;   // Choose a color channel.
-    if (rand() % 2) {            // Choose fade direction.
-      fadeDirection = -1;
+    s->colorChannel = PatternRand() % 3;   // Choose a color channel.
+    if (PatternRand() % 2) {               // Choose fade direction.
+      s->fadeDirection = -1;
     } else {
-      fadeDirection = 1;
+      s->fadeDirection = 1;
     }
 
     // Populate the arm with a colorwash on one of the channels, leaving the
     // other channels untouched.    
-    for (i = 0; i < (galaxy->size / 2); i++) {
-      galaxy->pixels[i]->chan[colorChannel] = i * COEF_FADER_SPREAD;
+    for (i = 0; i < ARM_SIZE(galaxy); i++) {
+      galaxy->pixels[i]->chan[s->colorChannel] = i * COEF_FADER_SPREAD;
     } // End of fill loop.
   } // End of pattern initialization block.
 
   // Do the fade up or down depending on what rnum ended up being.
   // Only fade the selected channel (section from the initialization block).
-  FadeChannel(galaxy, colorChannel, fadeDirection * COEF_FADE_VALUE, MODE_MODULAR);
+  FadeChannel(galaxy, s->colorChannel, s->fadeDirection * COEF_FADE_VALUE, MODE_MODULAR);
+  return 0;
 }
 
 
 // RGBSharpRotate - Initially fill the array with the pattern RGBRGB,...
 // On each step, rotate the pattern down (or up) the arms.
-void RGBSharpRotate(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
+long int RGBSharpRotate(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  rgbSharpRotateState_t *s = state;
   int i;
-  static sMode_e shiftDirection = SHIFT_POSITIVE;
 
   // Populate the arm with R,G,B,R,G,B,R,G,B,R,G,B,R,G,B,R,G,B,R,G,B
   // This only needs to be done once - the rest of the pattern just shifts
@@ -70,10 +74,10 @@ void RGBSharpRotate(galaxyData_t *galaxy, unsigned char initial, outputMapping_e
     *map = MAP_MIRROR;
 
     // Choose a direction.
-    if (rand() % 2) {
-      shiftDirection = SHIFT_POSITIVE;
+    if (PatternRand() % 2) {
+      s->shiftDirection = SHIFT_POSITIVE;
     } else {
-      shiftDirection = SHIFT_NEGATIVE;
+      s->shiftDirection = SHIFT_NEGATIVE;
     }
 
     // This may hurt your brain - its a somewhat obfuscated way of
@@ -87,7 +91,7 @@ void RGBSharpRotate(galaxyData_t *galaxy, unsigned char initial, outputMapping_e
     // } else {
     //   galaxy->pixels[i]->r = 0x00;
     // }
-    for (i = 0; i < PIXELS_PER_ARM; i++) {
+    for (i = 0; i < ARM_SIZE(galaxy); i++) {
       galaxy->pixels[i]->r = ((i + 0) % 3) == 0 ? 0xff : 0x00;
       galaxy->pixels[i]->g = ((i + 1) % 3) == 0 ? 0xff : 0x00;
       galaxy->pixels[i]->b = ((i + 2) % 3) == 0 ? 0xff : 0x00;
@@ -95,124 +99,45 @@ void RGBSharpRotate(galaxyData_t *galaxy, unsigned char initial, outputMapping_e
   } /* End initial */
   
   // Shift (rotate) the pixels.
-  Shift(galaxy, shiftDirection, *map);
+  Shift(galaxy, s->shiftDirection, *map);
 
-  // Delay - otherwise this things goes so fast all you see is a whiteish strobe.
-  Delay(30000);
+  // Hold - otherwise this things goes so fast all you see is a whiteish strobe.
+  return COEF_ROTATE_HOLD;
 }
 
 
 // RainbowFader - Red, Yellow, Green, Cyan, Blue, Magenta, repeat.
-// Fader works by coloring the first pixel (using the last pixel's value),
-// but then shifting the entire array down the arm.
-void RainbowFader(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
-  static int transition = 0;
+// Fader works by coloring the first pixel with the next hue round the color
+// wheel, but then shifting the entire array down the arm.  The hue is kept in
+// 8.8 fixed point, so it can move by fractions of a hue each step.
+long int RainbowFader(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  rainbowFaderState_t *s = state;
 
   if (initial) {
     *map = MAP_MIRROR;
+    s->hue = 0;
   }
 
-  // transition is used to remember which colors we are transitioning between
-  // in this pattern.  There are 6 transitions...
-  switch(transition) {
-    case 0:
-      // Red -> Yellow (Green increases)
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g + COEF_RAINBOW_FADE_VALUE;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b;
-
-      // Check if green has hit the end of the transition (fully saturated).
-      if (galaxy->pixels[0]->g > 255 - COEF_RAINBOW_FADE_VALUE) {
-        
-        // It has, so set it to max and move on to next section.
-        galaxy->pixels[0]->g = 255;
-        transition++;
-      }
-      break;
-    
-    case 1:
-      // Yellow -> Green (Red decreases)
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r - COEF_RAINBOW_FADE_VALUE;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b;
-      
-      if (galaxy->pixels[0]->r < COEF_RAINBOW_FADE_VALUE) {
-        galaxy->pixels[0]->r = 0;
-        transition++;
-      }
-      break;
-
-    case 2:
-      // Green -> Cyan (Blue increases)
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b + COEF_RAINBOW_FADE_VALUE;
-      
-      if (galaxy->pixels[0]->b > 255 - COEF_RAINBOW_FADE_VALUE) {
-        galaxy->pixels[0]->b = 255;
-        transition++;
-      }
-      break;
-
-    case 3:
-      // Cyan -> Blue (Green decreases)
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g - COEF_RAINBOW_FADE_VALUE;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b;
-      
-      if (galaxy->pixels[0]->g < COEF_RAINBOW_FADE_VALUE) {
-        galaxy->pixels[0]->r = 0;
-        transition++;
-      }
-      break;
-
-    case 4:
-      // Blue -> Magenta (Red increases)
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r + COEF_RAINBOW_FADE_VALUE;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b;
-      
-      if (galaxy->pixels[0]->r > 255 - COEF_RAINBOW_FADE_VALUE) {
-        galaxy->pixels[0]->r = 255;
-        transition++;
-      }
-      break;
-
-    case 5:
-      // Magenta -> Red (Blue decreases
-      galaxy->pixels[0]->r = galaxy->pixels[PIXELS_PER_ARM - 1]->r;
-      galaxy->pixels[0]->g = galaxy->pixels[PIXELS_PER_ARM - 1]->g;
-      galaxy->pixels[0]->b = galaxy->pixels[PIXELS_PER_ARM - 1]->b - COEF_RAINBOW_FADE_VALUE;
-
-      if (galaxy->pixels[0]->b < COEF_RAINBOW_FADE_VALUE) {
-        galaxy->pixels[0]->b = 0;
-        transition = 0;
-      }
-      break;
-
-    default:
-      // Shouldn't get here, but just in case...
-      transition = 0;
-      break;
-  }
-  
+  *galaxy->pixels[0] = HsvToRgb((unsigned char) (s->hue >> 8), 255, 255);
+  s->hue += COEF_RAINBOW_HUE_STEP;
+
   // Shift - Gotta be negative unless I change a bunch of things above?
   Shift(galaxy, SHIFT_NEGATIVE, *map);
+  return 0;
 }
 
 
 // SequenceTest - Shift a single pixel of color across the array.
-void SequenceTest(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
-
-  static sMode_e shiftDir = SHIFT_NEGATIVE;
+long int SequenceTest(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  sequenceTestState_t *s = state;
 
   if (initial) {
     *map = MAP_MIRROR;
 
-    if (rand() % 2) {
-      shiftDir = SHIFT_NEGATIVE;
+    if (PatternRand() % 2) {
+      s->shiftDir = SHIFT_NEGATIVE;
     } else {
-      shiftDir = SHIFT_POSITIVE;
+      s->shiftDir = SHIFT_POSITIVE;
     }
     
     // Clear to black.
@@ -223,77 +148,75 @@ void SequenceTest(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *
   }
 
   // Shifts the pixel set in the initialization block down the arm.
-  Shift(galaxy, shiftDir, *map);
+  Shift(galaxy, s->shiftDir, *map);
+  return 0;
 }
 
 
 // VarStrobe - Color strobe with changing frequency.  Chooses a color to strobe,
 // then goes between it and black at every step while sweeping the delay time
 // up and down to change the frequency.
-void VariableStrobe(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
-  static unsigned char phase = 0;
-  static int strobeDelay = 0, delayStep = 0;
-  static color_t tmp;
+long int VariableStrobe(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  variableStrobeState_t *s = state;
   int i;
   
   if (initial) {
     *map = MAP_MIRROR;
-    phase = 0;  // This is used to figure out if we are on or off this step.
-    strobeDelay = 0;
-    delayStep = COEF_STROBE_FREQ_STEP;
+    s->phase = 0;  // This is used to figure out if we are on or off this step.
+    s->strobeDelay = 0;
+    s->delayStep = COEF_STROBE_FREQ_STEP;
 
-    tmp = GetRandomColor(CMODE_TERTIARY_W);
+    s->color = GetRandomColor(CMODE_TERTIARY_W);
   } // End initialization block.
 
   // Are we on or off?
-  phase = (phase + 1) % 2;
-  if (phase) {
+  s->phase = (s->phase + 1) % 2;
+  if (s->phase) {
     // ON
-    for (i = 0; i < PIXELS_PER_ARM; i++) {
-      *galaxy->pixels[i] = tmp;
+    for (i = 0; i < ARM_SIZE(galaxy); i++) {
+      *galaxy->pixels[i] = s->color;
     }
   } else {
     // OFF
-    for (i = 0; i < PIXELS_PER_ARM; i++) {
+    for (i = 0; i < ARM_SIZE(galaxy); i++) {
       *galaxy->pixels[i] = PIXEL_BLACK;
     }
   }
 
-  strobeDelay = strobeDelay + delayStep;
+  s->strobeDelay = s->strobeDelay + s->delayStep;
   
   // If the delay has hit a limit, reverse the step.
-  if ((strobeDelay >= COEF_MAX_STROBE_DELAY) ||
-      (strobeDelay <= COEF_MIN_STROBE_DELAY)) {
-    delayStep = delayStep * -1;
+  if ((s->strobeDelay >= COEF_MAX_STROBE_DELAY) ||
+      (s->strobeDelay <= COEF_MIN_STROBE_DELAY)) {
+    s->delayStep = s->delayStep * -1;
   }
 
-  Delay(strobeDelay);
+  return s->strobeDelay;
 }
 
 
 // Scroll a sequence of random colors across the array in a random direction.
-void RandomMarquee(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map) {
-  static cMode_e colorMode;
-  static sMode_e direction;
+long int RandomMarquee(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map) {
+  randomMarqueeState_t *s = state;
 
   if (initial) {
     *map = MAP_FULL;
     
     // Choose a random color mode.
-    colorMode = rand() % CMODE_COUNT;
-    direction = rand() % 2;
+    s->colorMode = PatternRand() % CMODE_COUNT;
+    s->direction = PatternRand() % 2;
   }
 
   // Load a color into pixel 0.
-  if (direction == SHIFT_POSITIVE) {
-    *galaxy->pixels[galaxy->size - 1] = GetRandomColor(colorMode);
+  if (s->direction == SHIFT_POSITIVE) {
+    *galaxy->pixels[galaxy->size - 1] = GetRandomColor(s->colorMode);
   } else {
-    *galaxy->pixels[0] = GetRandomColor(colorMode);
+    *galaxy->pixels[0] = GetRandomColor(s->colorMode);
   }
 
   // Shift.
-  Shift(galaxy, direction, MAP_FULL);
+  Shift(galaxy, s->direction, MAP_FULL);
 
-  // Delay.
-  Delay(20000);
+  // Hold.
+  return COEF_MARQUEE_HOLD;
 }
@@ -5,39 +5,140 @@
 #ifndef PATTERN_H
 #define	PATTERN_H
 
+#include "baked.h"  // bakedState_t
+#include "vm.h"     // vmState_t
 
-// Pattern functions should all have the same signature.
-void FaderMovingSeam(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
-void RGBSharpRotate(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
-void RainbowFader(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
-void SequenceTest(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
-void VariableStrobe(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
-void RandomMarquee(galaxyData_t *galaxy, unsigned char initial, outputMapping_e *map);
 
+// Pattern state.  Anything a pattern needs to remember from one step to the
+// next goes in a state block of its own type, rather than in static variables,
+// so that any number of copies of a pattern can run side by side (on different
+// galaxies, say), each with its own block.  Blocks start out zeroed, and last
+// from one run of the pattern to the next.
+typedef struct {
+  colorChannel_e colorChannel;
+  unsigned char fadeDirection;
+} faderMovingSeamState_t;
+
+typedef struct {
+  sMode_e shiftDirection;
+} rgbSharpRotateState_t;
+
+typedef struct {
+  unsigned int hue;  // 8.8, 256 to the color wheel.
+} rainbowFaderState_t;
+
+typedef struct {
+  sMode_e shiftDir;
+} sequenceTestState_t;
+
+typedef struct {
+  unsigned char phase;
+  long int strobeDelay, delayStep;  // (us)
+  color_t color;
+} variableStrobeState_t;
+
+typedef struct {
+  cMode_e colorMode;
+  sMode_e direction;
+} randomMarqueeState_t;
+
+// Baked runs (see --bake) and pattern programs (see --assemble) in
+// patternList.  Each needs a state block too.
+#define BAKED_PATTERNS 0
+#define VM_PATTERNS 0
+
+// One of each, for sizing the memory they come from.  A pattern added to
+// patternList needs its state type added here too, once for each entry.
+typedef struct {
+  faderMovingSeamState_t faderMovingSeam;
+  rgbSharpRotateState_t rgbSharpRotate;
+  rainbowFaderState_t rainbowFader;
+  sequenceTestState_t sequenceTest;
+  variableStrobeState_t variableStrobe;
+  randomMarqueeState_t randomMarquee;
+#if (BAKED_PATTERNS > 0)
+  bakedState_t baked[BAKED_PATTERNS];
+#endif
+#if (VM_PATTERNS > 0)
+  vmState_t vm[VM_PATTERNS];
+#endif
+} patternStates_t;
+
+
+// Pattern functions should all have the same signature.  Each one draws the
+// next frame and returns how long it should be held (us), counted from when
+// the frame before it went out, or 0 to move on as soon as the frame is sent.
+// Patterns never wait themselves - the pattern loop does all the waiting (see
+// HoldFrame() in master.c).
+long int FaderMovingSeam(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
+long int RGBSharpRotate(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
+long int RainbowFader(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
+long int SequenceTest(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
+long int VariableStrobe(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
+long int RandomMarquee(galaxyData_t *galaxy, void *state, unsigned char initial, outputMapping_e *map);
 
-// This struct contains a pointer to a pattern function and the number of times
-// to run that pattern.
+
+// This struct contains a pointer to a pattern function, the number of frames
+// the wire benchmark runs it for, its name (for the emulator's reports), and
+// the size of its state block.  How long it runs on the galaxy is up to the
+// playlist, below.
 typedef struct {
-  void (*patternFunction)(galaxyData_t *, unsigned char, outputMapping_e *);
+  long int (*patternFunction)(galaxyData_t *, void *, unsigned char, outputMapping_e *);
   long int iterations;
+  const char *name;
+  unsigned int stateSize;
 } pattern_t;
 
+// The number of patterns to choose from.  It's spelled out, rather than
+// counted from patternList, so that the emulator's run modes (emuModes.c) can
+// size their arrays without the list.  A pattern added to patternList needs
+// counting here too.
+#define PATTERN_COUNT 6
+
+// Memory for one set of pattern states, allowing for alignment.
+#define PATTERN_STATE_BYTES (sizeof(patternStates_t) + (PATTERN_COUNT * ARENA_ALIGN))
+
 // This is the array of the pattern functions to run.  It should only be
 // allocated once in main.
 #ifdef _MAIN_C_
 
   const pattern_t patternList[] = {
-    { FaderMovingSeam, 1200 },
-    { RGBSharpRotate, 50 },
-    { RainbowFader, 1000 },
-    { SequenceTest, 600 },
-    { VariableStrobe, 400 },
-    { RandomMarquee, 100 }
+    { FaderMovingSeam, 1200, "FaderMovingSeam", sizeof(faderMovingSeamState_t) },
+    { RGBSharpRotate, 50, "RGBSharpRotate", sizeof(rgbSharpRotateState_t) },
+    { RainbowFader, 1000, "RainbowFader", sizeof(rainbowFaderState_t) },
+    { SequenceTest, 600, "SequenceTest", sizeof(sequenceTestState_t) },
+    { VariableStrobe, 400, "VariableStrobe", sizeof(variableStrobeState_t) },
+    { RandomMarquee, 100, "RandomMarquee", sizeof(randomMarqueeState_t) }
   };
 
-  // The number of patterns to choose from...
-  #define PATTERN_COUNT ((int)(sizeof(patternList ) / sizeof(pattern_t)))
+  // Won't compile if PATTERN_COUNT (above) doesn't match.
+  typedef char patternCountCheck_t[(sizeof(patternList) / sizeof(pattern_t) ==
+                                    PATTERN_COUNT) ? 1 : -1];
 
-#endif
+  // The playlist (see playlist.h): pattern, weight, seconds, and times of day.
+  // Every slot needs an entry.  The strobe is kept for after dark.
+  const playlistEntry_t playlistEntries[] = {
+    { 0, 3, 60, PLAYLIST_ALL_DAY },                    // FaderMovingSeam
+    { 1, 2, 15, PLAYLIST_ALL_DAY },                    // RGBSharpRotate
+    { 2, 3, 45, PLAYLIST_ALL_DAY },                    // RainbowFader
+    { 3, 1, 20, PLAYLIST_ALL_DAY },                    // SequenceTest
+    { 4, 1, 20, PLAYLIST_EVENING | PLAYLIST_NIGHT },   // VariableStrobe
+    { 5, 2, 30, PLAYLIST_ALL_DAY }                     // RandomMarquee
+  };
+  #define PLAYLIST_COUNT ((unsigned char)(sizeof(playlistEntries) / sizeof(playlistEntry_t)))
+
+  // Patterns that have to run before one comes round again.
+  #define PLAYLIST_NO_REPEAT 2
+
+  // Whether a pattern got its state block (see InitPatternStates() in
+  // master.c), or doesn't need one.
+  #define PATTERN_RUNNABLE(p, state) \
+    ((patternList[p].stateSize == 0) || ((state)[p] != NULL))
+
+#else /* _MAIN_C_ */
+
+  extern const pattern_t patternList[PATTERN_COUNT];
+
+#endif /* _MAIN_C_ */
 
 #endif	/* PATTERN_H */
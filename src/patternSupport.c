@@ -7,6 +7,50 @@
 #include "patternSupport.h"
 #include <stdlib.h> // rand();
 
+// Random numbers for the patterns.  They come from rand(), unless the emulator
+// has given the calling thread a generator of its own (see PatternRandUse()),
+// so that many galaxies can run at once, each with a repeatable sequence.
+#ifdef EMULATE
+static _Thread_local unsigned long int *randState = NULL;
+#endif
+
+// A quarter turn of sine, from 0 to a right angle in 64 steps, scaled to
+// 32768.  The rest of the turn is this, mirrored, and the points between are
+// interpolated.  It lives in flash on the PIC.
+static const unsigned int sineQuarter[65] = {
+      0,   804,  1608,  2411,  3212,  4011,  4808,  5602,
+   6393,  7180,  7962,  8740,  9512, 10279, 11039, 11793,
+  12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+  18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+  23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+  27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+  30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+  32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+  32768
+};
+
+
+// A random number from 0 to 32767, the least RAND_MAX is allowed to be.
+int PatternRand(void) {
+#ifdef EMULATE
+  if (randState != NULL) {
+    *randState = ((*randState * 1103515245UL) + 12345UL) & 0xFFFFFFFFUL;
+    return (int) ((*randState >> 16) & 0x7FFF);
+  }
+#endif
+  return rand();
+}
+
+
+#ifdef EMULATE
+// Draw the calling thread's pattern random numbers from state, or from rand()
+// again if state is NULL.
+void PatternRandUse(unsigned long int *state) {
+  randState = state;
+}
+#endif
+
+
 void FadeChannel(galaxyData_t *galaxy, colorChannel_e channel, int amount, aMode_e mode) {
 
   // Vars
@@ -55,88 +99,51 @@ void ColorAll(galaxyData_t *galaxy, color_t color) {
 }
 
 
-// Rotate the pixels down the arms based on the given map.
+// Rotate the pixels down the arms based on the given map.  MAP_FULL rotates
+// the whole array.  MAP_MIRROR rotates each arm along its own length.
 void Shift(galaxyData_t *galaxy, sMode_e dir, outputMapping_e map) {
-  color_t tmp1, tmp2;
-  int i;
-
-  // Save aside the last pixel(s).
-  if (dir == SHIFT_NEGATIVE) {
-    // Negative shift (left or outward)
-    tmp1 = *galaxy->pixels[0];                  // Both FULL and MIRROR.
-    tmp2 = *galaxy->pixels[galaxy->size - 1];   // Just for MIRROR.
-    // A note about the above constructs:  galaxy->pixels[0] is a pointer to a
-    // color_t structure (actually a union).  Structs and unions can be assigned
-    // in c just like ints and floats, without having to use memcpy().
-    // Dereferencing the pointer, (*galaxy->pixels[0]) gives us the color value
-    // of the pixel replete with all three color channels, permitting us to copy
-    // those values into the tmp vars in a single assignment.
-  } else {
-    // Positive shift (right or inward)
-    if (map == MAP_MIRROR) {
-      // inward
-      tmp1 = *galaxy->pixels[galaxy->size / 2 - 1];
-      tmp2 = *galaxy->pixels[galaxy->size / 2];
-    } else { // map == MAP_FULL
-      // right
-      tmp1 = *galaxy->pixels[galaxy->size - 1];
-    }
-  }
+  int arm, armSize;
 
-  // Do the shifts
   if (map == MAP_FULL) {
-    if (dir == SHIFT_POSITIVE) {
-      // Shift everything right.
-      for (i = galaxy->size - 1; i > 0; i--) {
-        *galaxy->pixels[i] = *galaxy->pixels[i - 1];
-      }
-    } else {
-      // Shift everything left.
-      for (i = 0; i < galaxy->size - 1; i++) {
-        *galaxy->pixels[i] = *galaxy->pixels[i + 1];
-      }
-    }
+    // Right or left.
+    Rotate(galaxy, 0, galaxy->size, dir == SHIFT_POSITIVE);
   } else {
-    if (dir == SHIFT_POSITIVE) {
-      // Shift left side inward.
-      for (i = galaxy->size / 2 - 1; i > 0; i--) {
-        *galaxy->pixels[i] = *galaxy->pixels[i - 1];
-      }
-      // Shift right side inward.
-      for (i = galaxy->size / 2; i < galaxy->size - 1; i++) {
-        *galaxy->pixels[i] = *galaxy->pixels[i + 1];
-      }
-    } else {
-      // Shift right side outward.
-      for (i = 0; i < galaxy->size / 2 - 1; i++) {
-        *galaxy->pixels[i] = *galaxy->pixels[i + 1];
-      }
-      // Shift left side outward.
-      for (i = galaxy->size - 1; i > galaxy->size / 2 + 1; i--) {
-        *galaxy->pixels[i] = *galaxy->pixels[i - 1];
-      }
+    // Inward or outward.  Even arms run tip to center and odd arms center to
+    // tip (see topology_t), so inward is up the array on even arms and down it
+    // on odd arms.
+    armSize = ARM_SIZE(galaxy);
+    for (arm = 0; arm < galaxy->topology->armCount; arm++) {
+      Rotate(galaxy, arm * armSize, armSize, (dir == SHIFT_POSITIVE) == ((arm % 2) == 0));
     }
   }
+}
 
-  // Restore the last pixel(s).
-  if (dir == SHIFT_NEGATIVE) {
-    if (map == MAP_MIRROR) {
-      // Outward
-      *galaxy->pixels[galaxy->size / 2 - 1] = tmp1;
-      *galaxy->pixels[galaxy->size / 2] = tmp2;
-    } else {
-      // Left
-      *galaxy->pixels[galaxy->size - 1] = tmp1;
+
+// Rotate count pixels starting at first by one place, up the array (toward
+// higher numbered pixels) or down it.  The pixel that falls off one end comes
+// back on the other.
+void Rotate(galaxyData_t *galaxy, int first, int count, unsigned char up) {
+  color_t tmp;
+  int i, last = first + count - 1;
+
+  if (up) {
+    tmp = *galaxy->pixels[last];
+    // A note about the above construct:  galaxy->pixels[last] is a pointer to a
+    // color_t structure (actually a union).  Structs and unions can be assigned
+    // in c just like ints and floats, without having to use memcpy().
+    // Dereferencing the pointer, (*galaxy->pixels[last]) gives us the color
+    // value of the pixel replete with all three color channels, permitting us
+    // to copy those values into tmp in a single assignment.
+    for (i = last; i > first; i--) {
+      *galaxy->pixels[i] = *galaxy->pixels[i - 1];
     }
+    *galaxy->pixels[first] = tmp;
   } else {
-    if (map == MAP_MIRROR) {
-      // Inward
-      *galaxy->pixels[0] = tmp1;
-      *galaxy->pixels[galaxy->size - 1] = tmp2;
-    } else {
-      // Right
-      *galaxy->pixels[0] = tmp1;
+    tmp = *galaxy->pixels[first];
+    for (i = first; i < last; i++) {
+      *galaxy->pixels[i] = *galaxy->pixels[i + 1];
     }
+    *galaxy->pixels[last] = tmp;
   }
 }
 
@@ -159,11 +166,11 @@ color_t GetRandomColor(cMode_e colorMode) {
   switch (colorMode) {
     case CMODE_PRIMARY:
       // 3 colors - (0,1,2) * 4 = (0,4,8) -> RED, GREEN, BLUE from the colors array.
-      returnValue = *colors[(rand() % 3) * 4];
+      returnValue = *colors[(PatternRand() % 3) * 4];
       break;
 
     case CMODE_PRIMARY_W:
-      a = rand() % 4;
+      a = PatternRand() % 4;
       if (a < 3) {
         returnValue = *colors[a * 4];
       } else {
@@ -172,11 +179,11 @@ color_t GetRandomColor(cMode_e colorMode) {
       break;
       
     case CMODE_SECONDARY:
-      returnValue = *colors[(rand() % 6) * 2];
+      returnValue = *colors[(PatternRand() % 6) * 2];
       break;
 
     case CMODE_SECONDARY_W:
-      a = rand() % 7;
+      a = PatternRand() % 7;
       if (a < 6) {
         returnValue = *colors[a * 2];
       } else {
@@ -185,11 +192,11 @@ color_t GetRandomColor(cMode_e colorMode) {
       break;
 
     case CMODE_TERTIARY:
-      returnValue = *colors[(rand() % 12)];
+      returnValue = *colors[(PatternRand() % 12)];
       break;
 
     case CMODE_TERTIARY_W:
-      a = rand() % 13;
+      a = PatternRand() % 13;
       if (a < 12) {
         returnValue = *colors[a];
       } else {
@@ -198,25 +205,211 @@ color_t GetRandomColor(cMode_e colorMode) {
       break;
 
     case CMODE_GREY:
-      returnValue = *colorsMono[(rand() % 4) + 1];
+      returnValue = *colorsMono[(PatternRand() % 4) + 1];
       break;
 
     case CMODE_GREY_B:
-      returnValue = *colorsMono[rand() % 5];
+      returnValue = *colorsMono[PatternRand() % 5];
       break;
 
     case CMODE_ANY_GREY:
-      a = rand() % 256;
+      a = PatternRand() % 256;
       returnValue.r = returnValue.g = returnValue.b = a;
       break;
 
     case CMODE_ANY:
     default:
-      returnValue.r = rand() % 256;
-      returnValue.g = rand() % 256;
-      returnValue.b = rand() % 256;
+      returnValue.r = PatternRand() % 256;
+      returnValue.g = PatternRand() % 256;
+      returnValue.b = PatternRand() % 256;
       break;
   }
 
   return returnValue;
 }
+
+
+// Set up an arena on a chunk of memory.  The memory should be aligned for
+// anything (from malloc(), or an array of long ints).
+void ArenaInit(arena_t *arena, void *memory, unsigned int size) {
+  arena->memory = memory;
+  arena->size = size;
+  arena->used = 0;
+}
+
+
+// Hand out a zeroed block from the arena, or NULL if there isn't room.
+void *ArenaAlloc(arena_t *arena, unsigned int size) {
+
+  // Vars
+  unsigned int start, i;
+
+  start = (arena->used + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+  if ((start > arena->size) || (size > arena->size - start)) {
+    return NULL;
+  }
+  for (i = start; i < start + size; i++) {
+    arena->memory[i] = 0;
+  }
+  arena->used = start + size;
+  return arena->memory + start;
+}
+
+
+// Give back everything the arena has handed out.
+void ArenaReset(arena_t *arena) {
+  arena->used = 0;
+}
+
+
+// Multiply two 8.8 numbers, rounded to the nearest.
+fixed88_t Fixed88Mul(fixed88_t a, fixed88_t b) {
+  return (fixed88_t) ((((long int) a * b) + 128) >> 8);
+}
+
+
+// Multiply two 16.16 numbers, rounded to the nearest.  The product needs 64
+// bits, which the PIC hasn't got, so it's put together from 16 bit halves.
+fixed1616_t Fixed1616Mul(fixed1616_t a, fixed1616_t b) {
+
+  // Vars
+  unsigned long int ua, ub, product;
+  unsigned char negative = FALSE;
+
+  if (a < 0) {
+    ua = (unsigned long int) -a;
+    negative = !negative;
+  } else {
+    ua = (unsigned long int) a;
+  }
+  if (b < 0) {
+    ub = (unsigned long int) -b;
+    negative = !negative;
+  } else {
+    ub = (unsigned long int) b;
+  }
+
+  product = (((ua >> 16) * (ub >> 16)) << 16) +
+            ((ua >> 16) * (ub & 0xFFFF)) +
+            ((ua & 0xFFFF) * (ub >> 16)) +
+            ((((ua & 0xFFFF) * (ub & 0xFFFF)) + 0x8000UL) >> 16);
+  return negative ? -(fixed1616_t) product : (fixed1616_t) product;
+}
+
+
+// Sine of angle (65536 to a turn), from -FIXED1616_ONE to FIXED1616_ONE.
+fixed1616_t Sin1616(unsigned int angle) {
+
+  // Vars
+  unsigned int within, index, fraction;
+  fixed1616_t value;
+
+  // Fold the angle into the first quarter.
+  within = angle & (ANGLE_QUARTER - 1);
+  if (angle & ANGLE_QUARTER) {
+    within = ANGLE_QUARTER - within;
+  }
+
+  // Then look it up, between two steps of the table.
+  index = within >> 8;
+  fraction = within & 0xFF;
+  value = sineQuarter[index];
+  if (fraction) {
+    value += (((long int) sineQuarter[index + 1] - value) * fraction) >> 8;
+  }
+  value <<= 1;
+
+  return (angle & ANGLE_HALF) ? -value : value;
+}
+
+
+// Cosine of angle, as Sin1616().
+fixed1616_t Cos1616(unsigned int angle) {
+  return Sin1616(angle + ANGLE_QUARTER);
+}
+
+
+// Sine of angle (256 to a turn), from 1 to 255, with 128 for 0.  Handy for
+// brightnesses and positions that swing back and forth.
+unsigned char Sin8(unsigned char angle) {
+  return (unsigned char) (128 + ((Sin1616((unsigned int) angle << 8) * 127 + 32768L) >> 16));
+}
+
+
+// Cosine of angle, as Sin8().
+unsigned char Cos8(unsigned char angle) {
+  return Sin8((unsigned char) (angle + 64));
+}
+
+
+// value * scale / 255, rounded to the nearest, so a scale of 255 leaves value
+// as it is and 0 turns it off.
+unsigned char Scale8(unsigned char value, unsigned char scale) {
+
+  // Vars
+  unsigned int product = (unsigned int) value * scale + 128;
+
+  return (unsigned char) ((product + (product >> 8)) >> 8);
+}
+
+
+// Scale each channel of color, in place, as Scale8().
+void NScale8(color_t *color, unsigned char scale) {
+
+  // Vars
+  int i;
+
+  for (i = 0; i < CHANNEL_COUNT; i++) {
+    color->chan[i] = Scale8(color->chan[i], scale);
+  }
+}
+
+
+// Part way from one value to another.  A fraction of 0 gives from, and 255
+// gives to.
+unsigned char Lerp8(unsigned char from, unsigned char to, unsigned char fraction) {
+  if (to >= from) {
+    return (unsigned char) (from + Scale8((unsigned char) (to - from), fraction));
+  } else {
+    return (unsigned char) (from - Scale8((unsigned char) (from - to), fraction));
+  }
+}
+
+
+// A color from its hue (256 to the color wheel, 0 is red, 85 green and 170
+// blue), saturation and value.  Six sectors of the wheel, each with one
+// channel rising or falling, and all of it 8 bit multiplies.
+color_t HsvToRgb(unsigned char hue, unsigned char saturation, unsigned char value) {
+
+  // Vars
+  color_t color;
+  unsigned int sector = (unsigned int) hue * 6;
+  unsigned char rise = (unsigned char) (sector & 0xFF);
+  unsigned char p, q, t;
+
+  p = Scale8(value, 255 - saturation);
+  q = Scale8(value, 255 - Scale8(saturation, rise));
+  t = Scale8(value, 255 - Scale8(saturation, 255 - rise));
+
+  switch (sector >> 8) {
+    case 0:
+      color.r = value; color.g = t; color.b = p;
+      break;
+    case 1:
+      color.r = q; color.g = value; color.b = p;
+      break;
+    case 2:
+      color.r = p; color.g = value; color.b = t;
+      break;
+    case 3:
+      color.r = p; color.g = q; color.b = value;
+      break;
+    case 4:
+      color.r = t; color.g = p; color.b = value;
+      break;
+    default:
+      color.r = value; color.g = p; color.b = q;
+      break;
+  }
+  return color;
+}
@@ -55,11 +55,13 @@
   typedef enum {
     COLOR_RED, COLOR_ORANGE, COLOR_YELLOW, COLOR_CHARTREUSE, COLOR_GREEN,
     COLOR_AQUA, COLOR_CYAN, COLOR_AZURE, COLOR_BLUE, COLOR_VIOLET,
-    COLOR_MAGENTA, COLOR_ROSE
+    COLOR_MAGENTA, COLOR_ROSE,
+    COLOR_COUNT // Must be last!
   } color_e;
 
   typedef enum {
-    COLOR_BLACK, COLOR_DARK_GREY, COLOR_GREY, COLOR_LT_GREY, COLOR_WHITE
+    COLOR_BLACK, COLOR_DARK_GREY, COLOR_GREY, COLOR_LT_GREY, COLOR_WHITE,
+    MONO_COUNT // Must be last!
   } mono_e;
 
   // Array manipulation modes.
@@ -80,10 +82,57 @@
     CMODE_COUNT // Must be last! If you add more, this number is kept up-to-date.
   } cMode_e;
 
+  // A simple arena.  Blocks are handed out one after the other from a chunk of
+  // memory, zeroed and aligned to ARENA_ALIGN.  They can't be freed one at a
+  // time, but the whole arena can be reset.  Pattern state comes from these.
+  #define ARENA_ALIGN sizeof(long int)
+  typedef struct {
+    unsigned char *memory;
+    unsigned int size;
+    unsigned int used;
+  } arena_t;
+
+  // Fixed point, for patterns that would otherwise want floats.  fixed88_t is
+  // 8.8 (8 bits of whole number, 8 of fraction, in 16), and fixed1616_t is
+  // 16.16 (in 32).  FIXED88() and FIXED1616() make constants of them, e.g.
+  // FIXED88(1.5), which the compiler works out, so no float code gets built.
+  // fixed1616_t is a long, which is 32 bits on the PIC but 64 on most hosts,
+  // so a Fixed1616Mul() whose result is out of range (past 32767.99) wraps on
+  // the galaxy but not in the emulator.  Keep 16.16 results in range.
+  typedef short fixed88_t;
+  typedef long int fixed1616_t;
+  #define FIXED88_ONE 256
+  #define FIXED1616_ONE 65536L
+  #define FIXED88(n) ((fixed88_t) ((n) * FIXED88_ONE))
+  #define FIXED1616(n) ((fixed1616_t) ((n) * FIXED1616_ONE))
+
+  // Angles for Sin1616() and Cos1616() go from 0 to 65535 for a full turn.
+  // Sin8() and Cos8() take the top byte of one (256 to a turn).
+  #define ANGLE_QUARTER 0x4000U
+  #define ANGLE_HALF 0x8000U
+
   // Prototypes
+  int PatternRand(void);
+#ifdef EMULATE
+  void PatternRandUse(unsigned long int *state);
+#endif
+  void ArenaInit(arena_t *arena, void *memory, unsigned int size);
+  void *ArenaAlloc(arena_t *arena, unsigned int size);
+  void ArenaReset(arena_t *arena);
   void FadeChannel(galaxyData_t *galaxy, colorChannel_e channel, int amount, aMode_e mode);
   void Shift(galaxyData_t *galaxy, sMode_e dir, outputMapping_e map);
+  void Rotate(galaxyData_t *galaxy, int first, int count, unsigned char up);
   void ColorAll(galaxyData_t *galaxy, color_t color);
   color_t GetRandomColor(cMode_e getColorMode);
+  fixed88_t Fixed88Mul(fixed88_t a, fixed88_t b);
+  fixed1616_t Fixed1616Mul(fixed1616_t a, fixed1616_t b);
+  fixed1616_t Sin1616(unsigned int angle);
+  fixed1616_t Cos1616(unsigned int angle);
+  unsigned char Sin8(unsigned char angle);
+  unsigned char Cos8(unsigned char angle);
+  unsigned char Scale8(unsigned char value, unsigned char scale);
+  void NScale8(color_t *color, unsigned char scale);
+  unsigned char Lerp8(unsigned char from, unsigned char to, unsigned char fraction);
+  color_t HsvToRgb(unsigned char hue, unsigned char saturation, unsigned char value);
   
 #endif	/* MANIPS_H */
@@ -0,0 +1,179 @@
+// File: playlist.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Pattern playlist.  Each entry has a weight, a running time, and the times of
+// day it may run in (see playlist.h), and the playlist has a no-repeat window:
+// an entry doesn't come up again until that many others have run.
+//
+// Rather than drawing each pattern as it's needed, the next PLAYLIST_LENGTH
+// are drawn at once into a table of entry numbers, and PlaylistNext() just
+// reads the next one off.  The table is drawn again once it's used up, or when
+// the time of day moves into another slot.  Each pick is a weighted draw from
+// the entries allowed in the slot that haven't run within the window (looking
+// back through the table, then through the ones that have played).  If
+// that leaves nothing, the window is ignored, and then the slots.
+//
+// Time is galaxy time - the frame lengths the caller passes to PlaylistTick().
+// The draws use PatternRand(), so a playlist plays the same on the PIC as on
+// the emulator, given the same seed and start time.
+
+// Includes
+#include "playlist.h"
+#include "patternSupport.h"  // PatternRand()
+#include <stdlib.h>          // NULL
+
+// Defines
+#define NO_ENTRY 0xFF
+
+// Prototypes
+static void Build(playlist_t *p, unsigned char slot);
+static int Draw(playlist_t *p, int position, unsigned char slot,
+                unsigned char window);
+static unsigned char Allowed(playlist_t *p, int e, int position,
+                             unsigned char slot, unsigned char window);
+static unsigned char Slot(long int clock);
+
+
+// Start playing count entries, with the given no-repeat window, at the time of
+// day clock (seconds after midnight).  The entries must stay put.
+void PlaylistInit(playlist_t *p, const playlistEntry_t *entries,
+                  unsigned char count, unsigned char noRepeat, long int clock) {
+
+  // Vars
+  int i;
+
+  p->entries = entries;
+  p->count = count;
+  p->noRepeat = (noRepeat > PLAYLIST_MAX_NO_REPEAT) ? PLAYLIST_MAX_NO_REPEAT : noRepeat;
+  p->position = PLAYLIST_LENGTH;  // Draw on the first pick.
+  p->slot = 0;
+  for (i = 0; i < PLAYLIST_MAX_NO_REPEAT; i++) {
+    p->recent[i] = NO_ENTRY;
+  }
+  p->current = NULL;
+  p->seconds = 0;
+  p->us = 0;
+  p->clock = clock % SECONDS_PER_DAY;
+  if (p->clock < 0) {
+    p->clock += SECONDS_PER_DAY;
+  }
+}
+
+
+// Move on to the next entry, and return its pattern.
+int PlaylistNext(playlist_t *p) {
+
+  // Vars
+  int i;
+  unsigned char slot = Slot(p->clock), entry;
+
+  if ((p->position >= PLAYLIST_LENGTH) || (slot != p->slot)) {
+    Build(p, slot);
+  }
+  entry = p->table[p->position++];
+
+  for (i = PLAYLIST_MAX_NO_REPEAT - 1; i > 0; i--) {
+    p->recent[i] = p->recent[i - 1];
+  }
+  p->recent[0] = entry;
+  p->current = &p->entries[entry];
+  p->seconds = 0;
+  return p->current->pattern;
+}
+
+
+// Count off a frame us long.  Returns TRUE once the current entry has run its
+// time.
+unsigned char PlaylistTick(playlist_t *p, long int us) {
+  p->us += us;
+  while (p->us >= 1000000L) {
+    p->us -= 1000000L;
+    p->seconds++;
+    p->clock++;
+    if (p->clock >= SECONDS_PER_DAY) {
+      p->clock = 0;
+    }
+  }
+  return (p->current != NULL) && (p->seconds >= p->current->seconds);
+}
+
+
+// Draw the table for the given slot.
+static void Build(playlist_t *p, unsigned char slot) {
+
+  // Vars
+  int i, entry;
+
+  for (i = 0; i < PLAYLIST_LENGTH; i++) {
+    entry = Draw(p, i, slot, TRUE);
+    if (entry < 0) {
+      entry = Draw(p, i, slot, FALSE);
+    }
+    if (entry < 0) {
+      entry = Draw(p, i, PLAYLIST_ALL_DAY, FALSE);
+    }
+    p->table[i] = (entry < 0) ? 0 : (unsigned char) entry;
+  }
+  p->position = 0;
+  p->slot = slot;
+}
+
+
+// Draw an entry for the table at position, from those allowed in slot, and
+// outside the no-repeat window if window is set.  Returns -1 if there are
+// none.
+static int Draw(playlist_t *p, int position, unsigned char slot,
+                unsigned char window) {
+
+  // Vars
+  int e;
+  long int total = 0, pick;
+
+  for (e = 0; e < p->count; e++) {
+    if (Allowed(p, e, position, slot, window)) {
+      total += p->entries[e].weight;
+    }
+  }
+  if (total == 0) {
+    return -1;
+  }
+
+  pick = PatternRand() % total;
+  for (e = 0; e < p->count; e++) {
+    if (Allowed(p, e, position, slot, window)) {
+      pick -= p->entries[e].weight;
+      if (pick < 0) {
+        return e;
+      }
+    }
+  }
+  return -1;  // Never happens.
+}
+
+
+// Can entry e go in the table at position?  See Draw().
+static unsigned char Allowed(playlist_t *p, int e, int position,
+                             unsigned char slot, unsigned char window) {
+
+  // Vars
+  int d;
+  unsigned char before;
+
+  if ((p->entries[e].weight == 0) || !(p->entries[e].slots & slot)) {
+    return FALSE;
+  }
+  for (d = 1; window && (d <= p->noRepeat); d++) {
+    before = (position >= d) ? p->table[position - d] : p->recent[d - position - 1];
+    if (before == e) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+// The slot bit for a time of day.
+static unsigned char Slot(long int clock) {
+  return (unsigned char) (1 << (clock / (PLAYLIST_SLOT_HOURS * 3600L)));
+}
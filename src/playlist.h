@@ -0,0 +1,64 @@
+// File:   playlist.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Pattern playlist.  Which pattern runs next, and for how long.
+
+#ifndef PLAYLIST_H
+#define	PLAYLIST_H
+
+  #include "galaxyConfig.h"
+
+  // Picks made at a time (see PlaylistNext()).  One byte each.
+  #define PLAYLIST_LENGTH 32
+
+  // Longest no-repeat window.
+  #define PLAYLIST_MAX_NO_REPEAT 4
+
+  // Times of day, 6 hours each.  An entry runs in the slots whose bits it has.
+  #define PLAYLIST_SLOT_HOURS 6
+  #define PLAYLIST_NIGHT 0x01      // 00:00 - 06:00
+  #define PLAYLIST_MORNING 0x02    // 06:00 - 12:00
+  #define PLAYLIST_AFTERNOON 0x04  // 12:00 - 18:00
+  #define PLAYLIST_EVENING 0x08    // 18:00 - 24:00
+  #define PLAYLIST_ALL_DAY 0x0F
+
+  // The PIC has no clock, so it takes the time it's switched on to be this
+  // (seconds after midnight).
+  #define PLAYLIST_START (18L * 3600)
+  #define SECONDS_PER_DAY 86400L
+
+  // A playlist entry.  The pattern (its place in patternList), its weight (its
+  // share of the picks, 0 for never), how long it runs once picked (seconds of
+  // galaxy time, however many frames that takes), and the times of day it
+  // may be picked in.
+  typedef struct {
+    unsigned char pattern;
+    unsigned char weight;
+    unsigned int seconds;
+    unsigned char slots;
+  } playlistEntry_t;
+
+  // A playlist being played.
+  typedef struct {
+    const playlistEntry_t *entries;
+    unsigned char count;
+    unsigned char noRepeat;   // Picks before an entry may come up again.
+    unsigned char table[PLAYLIST_LENGTH];  // Entries in the order they'll play.
+    unsigned char position;   // Next one to play.
+    unsigned char slot;       // Time of day the table was made for.
+    unsigned char recent[PLAYLIST_MAX_NO_REPEAT];  // Last entries played,
+                                                   // latest first.
+    const playlistEntry_t *current;
+    unsigned int seconds;     // How long the current entry has run.
+    long int clock;           // Time of day (s).
+    long int us;              // Time towards the next second.
+  } playlist_t;
+
+  // Prototypes
+  void PlaylistInit(playlist_t *p, const playlistEntry_t *entries,
+                    unsigned char count, unsigned char noRepeat, long int clock);
+  int PlaylistNext(playlist_t *p);
+  unsigned char PlaylistTick(playlist_t *p, long int us);
+
+#endif	/* PLAYLIST_H */
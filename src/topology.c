@@ -0,0 +1,141 @@
+// File: topology.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Light layouts.  The galaxy's own layout is fixed, and is all the PIC ever
+// drives.  The emulator can also make up larger ones to try the pattern and
+// display code against installations that don't exist yet.
+
+// Includes
+#include "galaxyConfig.h"
+#include "topology.h"
+#ifdef EMULATE
+  #include <stdio.h>
+  #include <stdlib.h>
+#endif
+
+// The galaxy's slaves, in the order they are addressed on the wire.  Pixel 0
+// is the tip of one arm, pixel 41 the tip of the other.
+//
+// The slave addresses were originally chosen because the initial pattern
+// generation platform did not properly support 9 bit serial addressing or
+// switching on the fly between MARK and SPACE parity.  I had to use ODD parity
+// with 8 data bits to emulate the 9 bit serial scheme that the PIC slaves use
+// to distinguish data bytes from address bytes in serial communications.  The
+// addresses below, therefore, all have the same parity to indicate that they
+// are addresses.  The data bytes (at the time) had to be constrained to avoid
+// this parity (effectively eliminating 1/2 the available intensity values.
+// Thankfully, this is no longer the case, however, the addresses remain as an
+// artifact of the earlier situation.
+static const slave_t galaxySlaves[SLAVE_COUNT] = {
+  {0x03, 20, 5, -1, {GREEN, BLUE, RED}},  // 20 - 16
+  {0x05, 15, 5, -1, {GREEN, BLUE, RED}},  // 15 - 11
+  {0x06, 10, 5, -1, {GREEN, BLUE, RED}},  // 10 - 6
+  {0x09,  5, 5, -1, {GREEN, BLUE, RED}},  //  5 - 1
+  {0x0a,  0, 2, 41, {GREEN, BLUE, RED}},  //  0, 41 - The end cap / shared chip
+                                          //  (slave #9 in the original galaxy).
+                                          //  It controls the last LED triplet
+                                          //  on each arm.
+  {0x0c, 21, 5,  1, {GREEN, BLUE, RED}},  // 21 - 25
+  {0x0f, 26, 5,  1, {GREEN, BLUE, RED}},  // 26 - 30
+  {0x11, 31, 5,  1, {GREEN, BLUE, RED}},  // 31 - 35
+  {0x12, 36, 5,  1, {GREEN, BLUE, RED}}   // 36 - 40
+};
+
+const topology_t galaxyTopology = {ARM_COUNT, PIXELS_PER_ARM, SLAVE_COUNT, galaxySlaves};
+
+
+// Number of pixels in a layout.
+int GetPixelCount(const topology_t *topology) {
+  return topology->armCount * topology->pixelsPerArm;
+}
+
+
+// Number of bytes in a full frame on the wire - every slave's address and
+// every triplet.
+int GetFrameBytes(const topology_t *topology) {
+  int slave, bytes = 0;
+
+  for (slave = 0; slave < topology->slaveCount; slave++) {
+    bytes += 1 + (topology->slaves[slave].count * BYTES_PER_PIXEL);
+  }
+  return bytes;
+}
+
+
+// How far a pixel is from the tip of its arm.  This is also the pixel in the
+// first arm that sits in the same spot, which is what MAP_MIRROR shows there.
+int GetTipDistance(const topology_t *topology, int pixel) {
+  int arm, position;
+
+  arm = pixel / topology->pixelsPerArm;
+  position = pixel % topology->pixelsPerArm;
+  if (arm % 2) {
+    // Odd arms run from the center out.
+    position = topology->pixelsPerArm - 1 - position;
+  }
+  return position;
+}
+
+
+#ifdef EMULATE
+// Make up a layout - armCount arms of pixelsPerArm pixels, split as evenly as
+// possible between slaveCount slaves, each taking the next run of pixels.
+// Addresses are handed out from 0x01, since 0x00 is the broadcast address and
+// the top two bits mark compressed blocks, which leaves room for 63 slaves.
+// Returns NULL if the layout can't be made.
+topology_t *CreateTopology(int armCount, int pixelsPerArm, int slaveCount) {
+  topology_t *topology;
+  slave_t *slaves;
+  int i, pixelCount, first;
+
+  pixelCount = armCount * pixelsPerArm;
+  if ((armCount < 1) || (pixelsPerArm < 1) || (slaveCount < 1) ||
+      (slaveCount > 0x3f) || (slaveCount > pixelCount)) {
+    return NULL;
+  }
+
+  topology = malloc(sizeof(topology_t));
+  slaves = malloc(slaveCount * sizeof(slave_t));
+  if ((topology == NULL) || (slaves == NULL)) {
+    free(topology);
+    free(slaves);
+    return NULL;
+  }
+
+  first = 0;
+  for (i = 0; i < slaveCount; i++) {
+    slaves[i].address = i + 1;
+    slaves[i].first = first;
+    slaves[i].count = (pixelCount * (i + 1) / slaveCount) - first;
+    slaves[i].step = 1;
+    slaves[i].byteOrder[0] = GREEN;
+    slaves[i].byteOrder[1] = BLUE;
+    slaves[i].byteOrder[2] = RED;
+    first += slaves[i].count;
+  }
+
+  topology->armCount = armCount;
+  topology->pixelsPerArm = pixelsPerArm;
+  topology->slaveCount = slaveCount;
+  topology->slaves = slaves;
+  return topology;
+}
+
+
+// Make a layout from a command line description, "arms,pixelsPerArm,slaves".
+// Returns NULL (after complaining) if it doesn't make sense.
+topology_t *ParseTopology(const char *spec) {
+  int armCount, pixelsPerArm, slaveCount;
+  topology_t *topology = NULL;
+
+  if (sscanf(spec, "%i,%i,%i", &armCount, &pixelsPerArm, &slaveCount) == 3) {
+    topology = CreateTopology(armCount, pixelsPerArm, slaveCount);
+  }
+  if (topology == NULL) {
+    fprintf(stderr, "Bad topology \"%s\".  Expected arms,pixelsPerArm,slaves"
+                    " with 1 to 63 slaves and at least one pixel each.\n", spec);
+  }
+  return topology;
+}
+#endif /* EMULATE */
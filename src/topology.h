@@ -0,0 +1,24 @@
+// File:   topology.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Light layouts (see topology_t in galaxyConfig.h).
+
+#ifndef TOPOLOGY_H
+#define	TOPOLOGY_H
+
+  #include "galaxyConfig.h"
+
+  // The galaxy - 2 arms of 21 pixels, 9 slaves.
+  extern const topology_t galaxyTopology;
+
+  // Prototypes
+  int GetPixelCount(const topology_t *topology);
+  int GetFrameBytes(const topology_t *topology);
+  int GetTipDistance(const topology_t *topology, int pixel);
+#ifdef EMULATE
+  topology_t *CreateTopology(int armCount, int pixelsPerArm, int slaveCount);
+  topology_t *ParseTopology(const char *spec);
+#endif
+
+#endif	/* TOPOLOGY_H */
@@ -0,0 +1,135 @@
+// File: transition.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Crossfades.  When a pattern's time is up, rather than cutting straight to
+// the next one, the outgoing pattern keeps running for a few frames in a copy
+// of the galaxy's pixels, while the incoming one starts up in the galaxy's own
+// as usual, and what goes out is a blend of the two, sliding from one to the
+// other.  The caller runs both patterns (see GeneratePattern() in master.c).
+//
+// The blend weight is 8 bits, stepping from outgoing towards incoming by
+// 255 / (frames + 1) each frame, and the blend is BLEND_ALPHA from the
+// compositor, so the emulator gets the SIMD version.
+//
+// The blend is made in pixels of its own, and sent from there, so both
+// patterns carry on from their own frames, as they would running alone.
+// Patterns that work from the last frame (Shift(), FadeChannel() and so on)
+// would otherwise pick up the other pattern's pixels.  That costs the PIC two
+// extra sets of pixels and pointers (10 bytes a pixel), and nothing if
+// TRANSITION_FRAMES is 0.
+
+// Includes
+#include "transition.h"
+#include <stdlib.h>  // NULL
+#ifdef EMULATE
+  #include <stdio.h>
+#endif
+
+
+// Set up for crossfades frames long on the galaxy.
+void TransitionInit(transition_t *t, const galaxyData_t *galaxy, int frames) {
+
+  // Vars
+  int i;
+  color_t *pixels, *blend;
+#ifndef EMULATE
+#if (TRANSITION_FRAMES > 0)
+  static color_t fadePixels[PIXEL_COUNT], blendPixels[PIXEL_COUNT];
+  static color_t *fadePointers[PIXEL_COUNT], *blendPointers[PIXEL_COUNT];
+#endif
+#endif
+
+  t->pattern = NULL;
+  t->frames = frames;
+  t->frame = 0;
+  t->scratch = NULL;
+  t->galaxy.size = galaxy->size;
+  t->galaxy.topology = galaxy->topology;
+  t->galaxy.pixels = NULL;
+  t->output = t->galaxy;
+  if (frames <= 0) {
+    return;
+  }
+
+#ifdef EMULATE
+  pixels = malloc(galaxy->size * sizeof(color_t));
+  t->galaxy.pixels = malloc(galaxy->size * sizeof(color_t *));
+  blend = malloc(galaxy->size * sizeof(color_t));
+  t->output.pixels = malloc(galaxy->size * sizeof(color_t *));
+  t->scratch = malloc(galaxy->size * sizeof(color_t));
+  if ((pixels == NULL) || (t->galaxy.pixels == NULL) || (blend == NULL) ||
+      (t->output.pixels == NULL) || (t->scratch == NULL)) {
+    fprintf(stderr, "Unable to allocate the crossfade pixels!\n");
+    exit(EXIT_FAILURE);
+  }
+#elif (TRANSITION_FRAMES > 0)
+  pixels = fadePixels;
+  t->galaxy.pixels = fadePointers;
+  blend = blendPixels;
+  t->output.pixels = blendPointers;
+#else
+  return;
+#endif
+
+  for (i = 0; i < galaxy->size; i++) {
+    t->galaxy.pixels[i] = &pixels[i];
+    t->output.pixels[i] = &blend[i];
+  }
+}
+
+
+// Start a crossfade away from pattern, which has been running in galaxy with
+// the given state and map.  Call before the incoming pattern's first frame.
+// The two patterns must have separate state blocks.
+void TransitionStart(transition_t *t, const galaxyData_t *galaxy,
+                     const pattern_t *pattern, void *state, outputMapping_e map) {
+
+  // Vars
+  int i;
+
+  if ((t->frames <= 0) || (t->galaxy.pixels == NULL)) {
+    return;
+  }
+  for (i = 0; i < galaxy->size; i++) {
+    *t->galaxy.pixels[i] = *galaxy->pixels[i];
+  }
+  t->pattern = pattern;
+  t->state = state;
+  t->map = map;
+  t->frame = 0;
+}
+
+
+// Blend the outgoing pattern's latest frame with the incoming one's, in galaxy
+// with map, and return the pixels to send, and (in outMap) how.  Between
+// crossfades that's just galaxy.  Call after both patterns have run.  Neither
+// pattern's pixels are changed.
+galaxyData_t *TransitionBlend(transition_t *t, galaxyData_t *galaxy,
+                              outputMapping_e map, outputMapping_e *outMap) {
+
+  // Vars
+  layer_t layers[2];
+
+  if (t->pattern == NULL) {
+    *outMap = map;
+    return galaxy;
+  }
+
+  layers[0].galaxy = t->galaxy;
+  layers[0].map = t->map;
+  layers[0].mode = BLEND_ALPHA;
+  layers[0].alpha = 255;
+  layers[1].galaxy = *galaxy;
+  layers[1].map = map;
+  layers[1].mode = BLEND_ALPHA;
+  layers[1].alpha = (unsigned char) ((255L * (t->frame + 1)) / (t->frames + 1));
+  *outMap = CompositeLayers(&t->output, layers, 2, t->scratch);
+
+  // That's the last of the outgoing pattern.
+  t->frame++;
+  if (t->frame >= t->frames) {
+    t->pattern = NULL;
+  }
+  return &t->output;
+}
@@ -0,0 +1,48 @@
+// File:   transition.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Crossfades from one pattern to the next.
+
+#ifndef TRANSITION_H
+#define	TRANSITION_H
+
+  #include "composite.h"
+  #include "patternSupport.h"
+  #include "pattern.h"
+
+  // Frames a crossfade lasts, or 0 for straight cuts from one pattern to the
+  // next.  The emulator takes --transition.  Crossfades cost the PIC 420 bytes
+  // of RAM (see transition.c), which it doesn't have to spare alongside the
+  // packet buffers and wire table, so they're off there unless built with
+  // -DTRANSITION_FRAMES=16 on a build whose memory report shows room.
+  #ifndef TRANSITION_FRAMES
+    #ifdef EMULATE
+      #define TRANSITION_FRAMES 16
+    #else
+      #define TRANSITION_FRAMES 0
+    #endif
+  #endif
+
+  // A crossfade.  The outgoing pattern carries on in pixels of its own while
+  // the incoming one starts up in the galaxy's, and the blend of the two goes
+  // out from a third set.
+  typedef struct {
+    galaxyData_t galaxy;       // The outgoing pattern's pixels.
+    galaxyData_t output;       // The blend.
+    outputMapping_e map;       // The outgoing pattern's output map.
+    const pattern_t *pattern;  // The outgoing pattern, or NULL between fades.
+    void *state;               // Its state block.
+    int frames;                // Length of a fade, 0 for cuts.
+    int frame;                 // How far into this one.
+    color_t *scratch;          // See CompositeLayers().  NULL on the PIC.
+  } transition_t;
+
+  // Prototypes
+  void TransitionInit(transition_t *t, const galaxyData_t *galaxy, int frames);
+  void TransitionStart(transition_t *t, const galaxyData_t *galaxy,
+                       const pattern_t *pattern, void *state, outputMapping_e map);
+  galaxyData_t *TransitionBlend(transition_t *t, galaxyData_t *galaxy,
+                                outputMapping_e map, outputMapping_e *outMap);
+
+#endif	/* TRANSITION_H */
@@ -0,0 +1,284 @@
+// File: vm.c
+// Author: Joshua Krueger
+// Created: 2026_10_17
+
+// Pattern virtual machine.  A program is a string of bytecode (see vm.h) that
+// draws a frame from the start each time it's run, and returns the frame's
+// hold, the same as a pattern function.  Adding a pattern that way needs no
+// new code, only a new program, which the emulator can load from a file as it
+// starts (--vm, see emuAsm.c), or build into a const table for the PIC's
+// flash (--assemble).  The heavy lifting is left to the pattern support
+// functions (Shift(), FadeChannel(), ColorAll(), GetRandomColor()), so
+// the interpreter only has the pattern logic to get through.
+//
+// A program's RAM is its registers (a state block, like any pattern's) and a
+// few locals here.  The emulator (built with gcc) dispatches each op straight
+// to the next, through a table of label addresses.  XC8 can't take the
+// address of a label, so the PIC makes do with a switch.  Register numbers
+// are masked and pixel and channel numbers checked, so a bad program can only
+// draw a bad frame.
+
+// Includes
+#include "vm.h"
+#include "patternSupport.h"
+#include <stdlib.h>  // NULL
+
+// Defines
+#if defined(EMULATE) && defined(__GNUC__)
+  #define VM_THREADED
+#endif
+
+#ifdef VM_THREADED
+  #define OP(opcode) op_##opcode
+  #define NEXT goto *dispatch[*pc++ & 0x1F]
+#else
+  #define OP(opcode) case opcode
+  #define NEXT break
+#endif
+
+// Operands.
+#define A(at) ((at)[0] >> 4)
+#define B(at) ((at)[0] & 0x0F)
+#define IMM(at) ((vmRegister_t) ((at)[0] | ((at)[1] << 8)))
+#define ADDR(at) ((unsigned int) (at)[0] | ((unsigned int) (at)[1] << 8))
+#define REG(n) r[(n) & 0x0F]
+
+
+// Run program on galaxy for a frame, with its registers in state, and return
+// the frame's hold (us).  A program that takes too many jumps gets the frame
+// as it stands, with no hold, and one without a state block (see VM_PATTERNS
+// in pattern.h) draws nothing.
+long int VmRun(galaxyData_t *galaxy, void *state, const unsigned char *program,
+               unsigned char initial, outputMapping_e *map) {
+
+  // Vars
+  vmRegister_t *r;
+  const unsigned char *pc = program;
+  unsigned int jumps = 0;
+  int pixel, channel;
+  color_t color;
+#ifdef VM_THREADED
+  static const void *dispatch[32] = {
+    &&op_VM_END, &&op_VM_HOLD, &&op_VM_HOLDI, &&op_VM_MOVI, &&op_VM_MOV,
+    &&op_VM_ADD, &&op_VM_ADDI, &&op_VM_SUB, &&op_VM_MUL, &&op_VM_MOD,
+    &&op_VM_NEG, &&op_VM_RAND, &&op_VM_JMP, &&op_VM_JZ, &&op_VM_JNZ,
+    &&op_VM_JLT, &&op_VM_JINIT, &&op_VM_MAP, &&op_VM_SIZE, &&op_VM_ARM,
+    &&op_VM_GET, &&op_VM_PUT, &&op_VM_PIXEL, &&op_VM_FADE, &&op_VM_SHIFT,
+    &&op_VM_FILL, &&op_VM_COLOR, &&op_VM_HSV, &&op_bad, &&op_bad, &&op_bad,
+    &&op_bad
+  };
+#endif
+
+  if (state == NULL) {
+    return 0;
+  }
+  r = ((vmState_t *) state)->r;
+
+#ifdef VM_THREADED
+  NEXT;
+#else
+  FOREVER {
+    switch (*pc++) {
+#endif
+
+      OP(VM_END):
+        return 0;
+
+      OP(VM_HOLD):
+        return (REG(pc[0]) > 0) ? REG(pc[0]) * VM_HOLD_UNIT : 0;
+
+      OP(VM_HOLDI):
+        return (IMM(pc) > 0) ? IMM(pc) * VM_HOLD_UNIT : 0;
+
+      OP(VM_MOVI):
+        REG(pc[0]) = IMM(pc + 1);
+        pc += 3;
+        NEXT;
+
+      OP(VM_MOV):
+        r[A(pc)] = r[B(pc)];
+        pc++;
+        NEXT;
+
+      OP(VM_ADD):
+        r[A(pc)] = (vmRegister_t) (r[A(pc)] + r[B(pc)]);
+        pc++;
+        NEXT;
+
+      OP(VM_ADDI):
+        REG(pc[0]) = (vmRegister_t) (REG(pc[0]) + IMM(pc + 1));
+        pc += 3;
+        NEXT;
+
+      OP(VM_SUB):
+        r[A(pc)] = (vmRegister_t) (r[A(pc)] - r[B(pc)]);
+        pc++;
+        NEXT;
+
+      OP(VM_MUL):
+        r[A(pc)] = (vmRegister_t) (r[A(pc)] * r[B(pc)]);
+        pc++;
+        NEXT;
+
+      OP(VM_MOD):
+        r[A(pc)] = r[B(pc)] ? (vmRegister_t) (r[A(pc)] % r[B(pc)]) : 0;
+        pc++;
+        NEXT;
+
+      OP(VM_NEG):
+        REG(pc[0]) = (vmRegister_t) -REG(pc[0]);
+        pc++;
+        NEXT;
+
+      OP(VM_RAND):
+        if (r[B(pc)] > 0) {
+          r[A(pc)] = (vmRegister_t) (PatternRand() % r[B(pc)]);
+        } else {
+          r[A(pc)] = (vmRegister_t) (PatternRand() & 0x7FFF);
+        }
+        pc++;
+        NEXT;
+
+      OP(VM_JMP):
+        if (++jumps > VM_MAX_JUMPS) {
+          return 0;
+        }
+        pc = program + ADDR(pc);
+        NEXT;
+
+      OP(VM_JZ):
+        if (REG(pc[0]) == 0) {
+          if (++jumps > VM_MAX_JUMPS) {
+            return 0;
+          }
+          pc = program + ADDR(pc + 1);
+        } else {
+          pc += 3;
+        }
+        NEXT;
+
+      OP(VM_JNZ):
+        if (REG(pc[0]) != 0) {
+          if (++jumps > VM_MAX_JUMPS) {
+            return 0;
+          }
+          pc = program + ADDR(pc + 1);
+        } else {
+          pc += 3;
+        }
+        NEXT;
+
+      OP(VM_JLT):
+        if (r[A(pc)] < r[B(pc)]) {
+          if (++jumps > VM_MAX_JUMPS) {
+            return 0;
+          }
+          pc = program + ADDR(pc + 1);
+        } else {
+          pc += 3;
+        }
+        NEXT;
+
+      OP(VM_JINIT):
+        if (initial) {
+          if (++jumps > VM_MAX_JUMPS) {
+            return 0;
+          }
+          pc = program + ADDR(pc);
+        } else {
+          pc += 2;
+        }
+        NEXT;
+
+      OP(VM_MAP):
+        *map = (pc[0] == MAP_MIRROR) ? MAP_MIRROR : MAP_FULL;
+        pc++;
+        NEXT;
+
+      OP(VM_SIZE):
+        REG(pc[0]) = (vmRegister_t) galaxy->size;
+        pc++;
+        NEXT;
+
+      OP(VM_ARM):
+        REG(pc[0]) = (vmRegister_t) ARM_SIZE(galaxy);
+        pc++;
+        NEXT;
+
+      OP(VM_GET):
+        pixel = r[B(pc)];
+        channel = REG(pc[1]);
+        if ((pixel >= 0) && (pixel < galaxy->size) &&
+            (channel >= 0) && (channel < CHANNEL_COUNT)) {
+          r[A(pc)] = galaxy->pixels[pixel]->chan[channel];
+        }
+        pc += 2;
+        NEXT;
+
+      OP(VM_PUT):
+        pixel = r[A(pc)];
+        channel = r[B(pc)];
+        if ((pixel >= 0) && (pixel < galaxy->size) &&
+            (channel >= 0) && (channel < CHANNEL_COUNT)) {
+          galaxy->pixels[pixel]->chan[channel] = (unsigned char) REG(pc[1]);
+        }
+        pc += 2;
+        NEXT;
+
+      OP(VM_PIXEL):
+        pixel = r[A(pc)];
+        if ((pixel >= 0) && (pixel < galaxy->size)) {
+          galaxy->pixels[pixel]->r = (unsigned char) REG(B(pc));
+          galaxy->pixels[pixel]->g = (unsigned char) REG(B(pc) + 1);
+          galaxy->pixels[pixel]->b = (unsigned char) REG(B(pc) + 2);
+        }
+        pc++;
+        NEXT;
+
+      OP(VM_FADE):
+        channel = r[A(pc)];
+        if ((channel >= 0) && (channel < CHANNEL_COUNT)) {
+          FadeChannel(galaxy, channel, r[B(pc)], pc[1]);
+        }
+        pc += 2;
+        NEXT;
+
+      OP(VM_SHIFT):
+        Shift(galaxy, REG(pc[0]) ? SHIFT_NEGATIVE : SHIFT_POSITIVE, *map);
+        pc++;
+        NEXT;
+
+      OP(VM_FILL):
+        color.r = (unsigned char) REG(pc[0]);
+        color.g = (unsigned char) REG(pc[0] + 1);
+        color.b = (unsigned char) REG(pc[0] + 2);
+        ColorAll(galaxy, color);
+        pc++;
+        NEXT;
+
+      OP(VM_COLOR):
+        color = GetRandomColor(r[B(pc)]);
+        REG(A(pc)) = color.r;
+        REG(A(pc) + 1) = color.g;
+        REG(A(pc) + 2) = color.b;
+        pc++;
+        NEXT;
+
+      OP(VM_HSV):
+        color = HsvToRgb((unsigned char) ((unsigned int) r[B(pc)] >> 8), 255, 255);
+        REG(A(pc)) = color.r;
+        REG(A(pc) + 1) = color.g;
+        REG(A(pc) + 2) = color.b;
+        pc++;
+        NEXT;
+
+#ifdef VM_THREADED
+      op_bad:
+        return 0;
+#else
+      default:
+        return 0;
+    }
+  }
+#endif
+}
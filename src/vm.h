@@ -0,0 +1,73 @@
+// File:   vm.h
+// Author: Joshua Krueger
+// Created on October 17, 2026
+
+// Pattern virtual machine.  Patterns written as bytecode (see emuAsm.c for the
+// assembly language), run by an interpreter instead of compiled in.
+
+#ifndef VM_H
+#define	VM_H
+
+  #include "galaxyConfig.h"
+  #include "display.h"
+
+  // Registers.  16 bit, signed, on every target.
+  #define VM_REGISTERS 16
+  typedef short vmRegister_t;
+
+  // Holds are counted in these (us), so the longest fits a register.
+  #define VM_HOLD_UNIT 100L
+
+  // Jumps a frame may take before it's cut short, in case a program never
+  // gets to its hold.
+  #define VM_MAX_JUMPS 30000U
+
+  // Opcodes.  Each is a byte, followed by its operands.  a, b and c are
+  // registers, a pair to a byte (a in the high 4 bits) and c in a byte of its
+  // own, imm is a 16 bit value (low byte first), and addr is an offset into
+  // the program.  A color is 3 registers in a row (red, green, blue) named by
+  // the first.  Programs run from the start every frame, up to a hold, and the
+  // registers last from one frame to the next.
+  #define VM_END 0x00    // -                Frame done.  No hold.
+  #define VM_HOLD 0x01   // a                Frame done.  Hold a units.
+  #define VM_HOLDI 0x02  // imm              Frame done.  Hold imm units.
+  #define VM_MOVI 0x03   // a imm            a = imm
+  #define VM_MOV 0x04    // ab               a = b
+  #define VM_ADD 0x05    // ab               a += b
+  #define VM_ADDI 0x06   // a imm            a += imm
+  #define VM_SUB 0x07    // ab               a -= b
+  #define VM_MUL 0x08    // ab               a *= b
+  #define VM_MOD 0x09    // ab               a %= b (0 if b is 0)
+  #define VM_NEG 0x0A    // a                a = -a
+  #define VM_RAND 0x0B   // ab               a = PatternRand() % b (0 - 32767
+                         //                  if b isn't over 0)
+  #define VM_JMP 0x0C    // addr             Jump.
+  #define VM_JZ 0x0D     // a addr           Jump if a is 0.
+  #define VM_JNZ 0x0E    // a addr           Jump if a isn't 0.
+  #define VM_JLT 0x0F    // ab addr          Jump if a < b.
+  #define VM_JINIT 0x10  // addr             Jump on the pattern's first frame.
+  #define VM_MAP 0x11    // imm (a byte)     Output mapping (outputMapping_e).
+  #define VM_SIZE 0x12   // a                a = pixels in the galaxy.
+  #define VM_ARM 0x13    // a                a = pixels in an arm.
+  #define VM_GET 0x14    // ab c             a = channel c of pixel b.
+  #define VM_PUT 0x15    // ab c             Channel b of pixel a = c.
+  #define VM_PIXEL 0x16  // ab               Pixel a = color b.
+  #define VM_FADE 0x17   // ab imm (a byte)  FadeChannel(a, b, mode imm).
+  #define VM_SHIFT 0x18  // a                Shift(direction a), as mapped.
+  #define VM_FILL 0x19   // a                ColorAll(color a).
+  #define VM_COLOR 0x1A  // ab               Color a = GetRandomColor(mode b).
+  #define VM_HSV 0x1B    // ab               Color a = HsvToRgb(hue b, full
+                         //                  saturation and value).  b is 8.8,
+                         //                  so hues can step by fractions.
+  #define VM_OPCODES 0x1C
+
+  // A program's state block.
+  typedef struct {
+    vmRegister_t r[VM_REGISTERS];
+  } vmState_t;
+
+  // Prototypes
+  long int VmRun(galaxyData_t *galaxy, void *state, const unsigned char *program,
+                 unsigned char initial, outputMapping_e *map);
+
+#endif	/* VM_H */